@@ -84,6 +84,12 @@ void start_threads(void);
  */
 const char* get_thread_label(void);
 
+/**
+ * @brief Gets the interned id of the current thread's label, see log_label.h.
+ * @return The id, LOG_LABEL_UNKNOWN if the thread has no label.
+ */
+uint16_t get_thread_label_id(void);
+
 /**
  * @brief Sets the label of the current thread.
  * @param label The label to set.
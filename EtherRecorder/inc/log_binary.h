@@ -0,0 +1,147 @@
+/**
+* @file log_binary.h
+* @brief Compact binary log file format, written by the logger and read back
+* by the etherlog-decode tool.
+*
+* A file is a stream of records, each starting with a type byte. Every time the
+* logger opens a file it writes a header carrying the clock reference needed to
+* turn raw timestamp ticks back into wall-clock time. Thread labels and format
+* strings are interned: each is defined once per file, the first time it is
+* used there, and entries refer to it by id. Entries hold either the message
+* text or, for deferred entries, the format id and the captured arguments.
+*
+* Integers are written as LEB128 varints, timestamps as 8 little-endian bytes.
+* Captured arguments are in the writer's native layout, so the header records
+* the sizes that vary between platforms and the reader refuses a mismatch.
+*/
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "logger.h"
+#include "log_label.h"
+#include "log_writer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_BINARY_MAGIC "ETHLOG"
+#define LOG_BINARY_VERSION 1
+#define LOG_BINARY_MAX_LABELS LOG_LABEL_MAX // Label ids are the logger's own, 0 is "UNKNOWN"
+#define LOG_BINARY_MAX_FORMATS 4096 // Entries with formats beyond this are written as text
+
+typedef enum LogBinaryRecordType {
+    LOG_BINARY_RECORD_HEADER = 0x7F,
+    LOG_BINARY_RECORD_LABEL = 1,    // Defines a label id
+    LOG_BINARY_RECORD_FORMAT = 2,   // Defines a format id
+    LOG_BINARY_RECORD_TEXT = 3,     // Entry with its message text
+    LOG_BINARY_RECORD_DEFERRED = 4  // Entry with a format id and captured arguments
+} LogBinaryRecordType;
+
+/**
+ * @brief Written at the start of every file the logger opens.
+ */
+typedef struct LogBinaryHeader_T {
+    int64_t qpc_frequency;          // Timestamp ticks per second
+    int64_t qpc_reference;          // Ticks at filetime_reference
+    uint64_t filetime_reference;    // 100ns intervals since 1601-01-01 UTC
+    uint32_t timestamp_granularity; // Fractions of a second shown, a power of ten
+    uint8_t index_width;            // Leading zeros on the index
+    uint8_t long_size;              // Sizes of the captured argument types that vary
+    uint8_t pointer_size;
+    uint8_t long_double_size;
+} LogBinaryHeader_T;
+
+/**
+ * @brief Which ids have been defined in one open file.
+ */
+typedef struct LogBinaryFile_T {
+    uint8_t labels_defined[LOG_BINARY_MAX_LABELS / 8];
+    uint8_t formats_defined[LOG_BINARY_MAX_FORMATS / 8];
+} LogBinaryFile_T;
+
+/**
+ * @brief State for reading a binary log file back.
+ */
+typedef struct LogBinaryReader_T {
+    FILE *file;
+    LogBinaryHeader_T header;
+    bool has_header;
+    char *labels[LOG_BINARY_MAX_LABELS];
+    char *formats[LOG_BINARY_MAX_FORMATS];
+} LogBinaryReader_T;
+
+/**
+ * @brief Fills in the platform-dependent sizes of a header.
+ * @param header The header to complete; the clock and layout fields are the caller's.
+ */
+void log_binary_init_header(LogBinaryHeader_T *header);
+
+/**
+ * @brief Writes a header to a newly opened file and forgets its definitions.
+ *
+ * The writer functions share intern tables and must be serialised by the caller.
+ *
+ * @param writer The open log file's writer.
+ * @param state The file's definition state.
+ * @param header The header to write.
+ * @return true on success.
+ */
+bool log_binary_write_header(LogWriter_T *writer, LogBinaryFile_T *state, const LogBinaryHeader_T *header);
+
+/**
+ * @brief Writes an entry, preceded by any label or format definitions it needs.
+ * @param writer The open log file's writer.
+ * @param state The file's definition state.
+ * @param entry The entry, text or deferred.
+ * @param index The index assigned at publication.
+ * @return true on success.
+ */
+bool log_binary_write_entry(LogWriter_T *writer, LogBinaryFile_T *state, const LogEntry_T *entry, uint64_t index);
+
+/**
+ * @brief Starts reading a binary log file.
+ * @param reader The reader to initialise.
+ * @param file The file, opened in binary mode.
+ */
+void log_binary_reader_init(LogBinaryReader_T *reader, FILE *file);
+
+/**
+ * @brief Reads the next entry, processing any headers and definitions before it.
+ *
+ * Deferred entries come back with entry->format pointing at the reader's copy
+ * of the format, ready for log_format_render; their captured arguments have
+ * been checked against it with log_format_validate.
+ *
+ * @param reader The reader.
+ * @param index Receives the entry's index.
+ * @param entry Receives the entry.
+ * @return 1 for an entry, 0 at the end of the file or of the data in a
+ *         preallocated one, -1 if the file is corrupt
+ *         or was written on an incompatible platform.
+ */
+int log_binary_read_entry(LogBinaryReader_T *reader, uint64_t *index, LogEntry_T *entry);
+
+/**
+ * @brief Returns the label an entry read back refers to.
+ * @param reader The reader.
+ * @param label_id The entry's label_id.
+ * @return The label, or "UNKNOWN".
+ */
+const char *log_binary_reader_label(const LogBinaryReader_T *reader, uint16_t label_id);
+
+/**
+ * @brief Releases the reader's interned strings. The file is left open.
+ * @param reader The reader.
+ */
+void log_binary_reader_close(LogBinaryReader_T *reader);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_BINARY_H
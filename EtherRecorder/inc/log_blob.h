@@ -0,0 +1,115 @@
+/**
+* @file log_blob.h
+* @brief Slots for binary data carried by log entries, for logger_log_hex.
+*
+* An entry holds at most LOG_MSG_BUFFER_SIZE bytes, so binary data to be
+* dumped travels beside it: the producer copies the bytes into a free slot and
+* the entry carries the slot's reference, so a whole receive buffer costs one
+* copy and one enqueue. The logger thread renders the dump and frees the slot.
+*
+* The slots are allocated from the heap when the logger starts. Producers
+* claim a slot with a compare-and-swap, starting from a rotating position so
+* they seldom contend; only the logger thread frees them. When every slot is
+* in use the dump is dropped and counted, the entry's message is still logged.
+*/
+#ifndef LOG_BLOB_H
+#define LOG_BLOB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_BLOB_DEFAULT_SLOTS 16
+#define LOG_BLOB_DEFAULT_BYTES 8192
+
+/**
+ * @brief One slot.
+ */
+typedef struct LogBlob_T {
+    PlatformAtomic64_T busy;
+    uint32_t length;
+    uint32_t row_start;  // Position in the first row of the dump of the first byte
+    uint8_t *data;
+} LogBlob_T;
+
+/**
+ * @brief The slots.
+ */
+typedef struct LogBlobPool_T {
+    LogBlob_T *slots;    // NULL until log_blob_init succeeds
+    size_t count;
+    size_t slot_bytes;
+    uint8_t *data;
+    PlatformAtomic64_T next;     // Where the next claim starts looking
+    PlatformAtomic64_T stored;   // Blobs stored
+    PlatformAtomic64_T bytes;    // Bytes in them
+    PlatformAtomic64_T dropped;  // Blobs that found no free slot
+} LogBlobPool_T;
+
+/**
+ * @brief Counts kept by the pool.
+ */
+typedef struct LogBlobStats_T {
+    uint64_t stored;
+    uint64_t bytes;
+    uint64_t dropped;
+} LogBlobStats_T;
+
+/**
+ * @brief Allocates the slots.
+ * @param pool The pool.
+ * @param count The number of slots.
+ * @param slot_bytes The most each holds; longer data is split across slots.
+ * @return false if they could not be allocated, in which case every store fails.
+ */
+bool log_blob_init(LogBlobPool_T *pool, size_t count, size_t slot_bytes);
+
+/**
+ * @brief Copies data into a free slot. Safe to call from any thread.
+ * @param pool The pool.
+ * @param data The bytes.
+ * @param length How many, at most slot_bytes.
+ * @param row_start Position in the first row of the dump of the first byte.
+ * @return The slot's reference, 0 if none was free.
+ */
+uint32_t log_blob_store(LogBlobPool_T *pool, const void *data, size_t length, size_t row_start);
+
+/**
+ * @brief Returns the slot a reference names.
+ * @param pool The pool.
+ * @param reference As returned by log_blob_store.
+ * @return The slot, or NULL for 0 or a reference out of range.
+ */
+const LogBlob_T *log_blob_get(const LogBlobPool_T *pool, uint32_t reference);
+
+/**
+ * @brief Frees a slot once its dump has been rendered, or its entry dropped.
+ * @param pool The pool.
+ * @param reference As returned by log_blob_store; 0 is ignored.
+ */
+void log_blob_release(LogBlobPool_T *pool, uint32_t reference);
+
+/**
+ * @brief Reads the pool's counts. Safe to call from any thread.
+ * @param pool The pool.
+ * @param stats Receives the counts.
+ */
+void log_blob_get_stats(LogBlobPool_T *pool, LogBlobStats_T *stats);
+
+/**
+ * @brief Frees the slots. No entry may still refer to one.
+ * @param pool The pool.
+ */
+void log_blob_free(LogBlobPool_T *pool);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_BLOB_H
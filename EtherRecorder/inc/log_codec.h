@@ -0,0 +1,120 @@
+/**
+* @file log_codec.h
+* @brief Fast block compression for closed log segments.
+*
+* The codec is a byte-oriented LZ77 in the style of LZ4: each sequence is a
+* token giving a literal run and a match length, the literals, and a 16-bit
+* offset back to the match. It trades ratio for speed, which suits log text
+* with its repeated prefixes and formats.
+*
+* A compressed file is a header, a series of independently compressed blocks
+* of LOG_CODEC_BLOCK_SIZE bytes of input, and a footer index of where each
+* block starts, so a reader can seek to any offset in the original and
+* decompress only the blocks covering it.
+*
+*   header:  "ELZ1", u32 block size
+*   block:   u32 stored size (top bit set if stored uncompressed), u32 raw size, data
+*   index:   u64 file offset of each block
+*   trailer: u64 index offset, u64 raw size, u32 block count, "ELZX"
+*
+* All integers are little-endian.
+*/
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_CODEC_BLOCK_SIZE (64 * 1024)
+#define LOG_CODEC_BOUND(n) ((n) + (n) / 255 + 16) // Worst case compressed size
+#define LOG_CODEC_SUFFIX ".elz"                  // Appended to the name of a compressed file
+
+/**
+ * @brief Compresses one block.
+ * @param source The input.
+ * @param source_length Bytes of input, at most LOG_CODEC_BLOCK_SIZE.
+ * @param destination Receives the compressed block.
+ * @param capacity The size of @p destination.
+ * @return The compressed size, or 0 if it did not fit in @p capacity.
+ */
+size_t log_codec_compress_block(const unsigned char *source, size_t source_length,
+                                unsigned char *destination, size_t capacity);
+
+/**
+ * @brief Decompresses one block.
+ * @param source The compressed block.
+ * @param source_length Its size.
+ * @param destination Receives the output.
+ * @param capacity The size of @p destination.
+ * @return The decompressed size, or -1 if the block is corrupt or too big for @p destination.
+ */
+long log_codec_decompress_block(const unsigned char *source, size_t source_length,
+                                unsigned char *destination, size_t capacity);
+
+/**
+ * @brief Compresses a whole file.
+ * @param source_name The file to compress.
+ * @param destination_name The compressed file to create.
+ * @param raw_bytes Receives the size of the input.
+ * @param compressed_bytes Receives the size of the output.
+ * @return true on success. On failure the destination is removed.
+ */
+bool log_codec_compress_file(const char *source_name, const char *destination_name,
+                             uint64_t *raw_bytes, uint64_t *compressed_bytes);
+
+/**
+ * @brief State for reading a compressed file.
+ */
+typedef struct LogCodecReader_T {
+    FILE *file;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint64_t raw_size;
+    uint64_t *block_offsets; // From the footer index
+    unsigned char *compressed;
+    unsigned char *block;    // The most recently decompressed block
+    uint32_t cached_block;   // Its number, or UINT32_MAX
+    size_t cached_length;
+} LogCodecReader_T;
+
+/**
+ * @brief Checks whether an open file starts like a compressed file. The position is restored.
+ * @param file The file.
+ */
+bool log_codec_is_compressed(FILE *file);
+
+/**
+ * @brief Opens a compressed file for reading, loading its index.
+ * @param reader The reader.
+ * @param file The file, opened in binary mode. The reader does not close it.
+ * @return true on success.
+ */
+bool log_codec_reader_open(LogCodecReader_T *reader, FILE *file);
+
+/**
+ * @brief Reads part of the original file, decompressing only the blocks it covers.
+ * @param reader The reader.
+ * @param offset Offset in the original file.
+ * @param buffer Receives the bytes.
+ * @param length Bytes wanted.
+ * @return Bytes read, short at the end of the file, or -1 if the file is corrupt.
+ */
+long log_codec_read(LogCodecReader_T *reader, uint64_t offset, void *buffer, size_t length);
+
+/**
+ * @brief Releases the reader.
+ * @param reader The reader.
+ */
+void log_codec_reader_close(LogCodecReader_T *reader);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_CODEC_H
@@ -0,0 +1,64 @@
+/**
+* @file log_compress.h
+* @brief Background compression of closed log segments.
+*
+* When the logger moves on to a new segment it hands the name of the one it
+* closed to this worker and carries on; the hand-off is a copy into a short
+* queue and never waits for compression. The worker runs at low priority,
+* compresses each segment with log_codec into name.elz, and deletes the
+* original once the compressed copy is complete. If the queue is full the
+* segment is simply left uncompressed.
+*/
+#ifndef LOG_COMPRESS_H
+#define LOG_COMPRESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_COMPRESS_QUEUE_SIZE 16 // Segments waiting for the worker
+
+/**
+ * @brief What the worker has done so far.
+ */
+typedef struct LogCompressStats_T {
+    uint64_t segments;         // Segments compressed
+    uint64_t raw_bytes;        // Their size before
+    uint64_t compressed_bytes; // And after
+    uint64_t backlog;          // Segments queued or in progress
+    uint64_t skipped;          // Segments left uncompressed because the queue was full or compression failed
+} LogCompressStats_T;
+
+/**
+ * @brief Starts the worker thread.
+ * @return true if it is running.
+ */
+bool log_compress_start(void);
+
+/**
+ * @brief Queues a closed segment for compression. Never waits on the worker.
+ * @param segment_name The segment's file name.
+ * @return true if it was queued.
+ */
+bool log_compress_submit(const char *segment_name);
+
+/**
+ * @brief Stops the worker once the segment in hand is done. Anything still
+ * queued is left uncompressed.
+ */
+void log_compress_stop(void);
+
+/**
+ * @brief Reads the worker's counters.
+ * @param stats Receives them.
+ */
+void log_compress_get_stats(LogCompressStats_T *stats);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_COMPRESS_H
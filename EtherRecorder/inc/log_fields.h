@@ -0,0 +1,124 @@
+/**
+* @file log_fields.h
+* @brief Typed key-value fields attached to log entries.
+*
+* logger_log_kv takes a fixed message and a list of fields built with the
+* LOG_KV_* macros, e.g.
+*
+*   logger_log_kv(LOG_INFO, "Received data", LOG_KV_INT("bytes", n), LOG_KV_INT("port", port));
+*
+* The producer only copies the fields into the entry, after the message's
+* terminator, in the packed form below; nothing is formatted. The logger
+* thread turns them into " key=value" text for text sinks and into members of
+* the line's object for JSON sinks (log_json.h).
+*
+* Packed form of each field, in the writer's byte order:
+*   u8 type, u8 key length, key bytes,
+*   then an 8-byte value, a 1-byte bool, or for strings a u16 length and the bytes.
+*
+* Fields that do not fit in the entry after the message are dropped, the rest
+* are kept whole.
+*/
+#ifndef LOG_FIELDS_H
+#define LOG_FIELDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_FIELD_KEY_MAX 63 // Longer keys are cut short
+
+typedef enum LogFieldType {
+    LOG_FIELD_INT = 1,
+    LOG_FIELD_UINT,
+    LOG_FIELD_DOUBLE,
+    LOG_FIELD_BOOL,
+    LOG_FIELD_STRING
+} LogFieldType;
+
+/**
+ * @brief A field as the caller passes it.
+ */
+typedef struct LogField_T {
+    const char *key;
+    LogFieldType type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+        const char *s; // Copied into the entry, NULL is logged as an empty string
+    } value;
+} LogField_T;
+
+#define LOG_KV_INT(key, v)    ((LogField_T){ (key), LOG_FIELD_INT,    { .i = (int64_t)(v) } })
+#define LOG_KV_UINT(key, v)   ((LogField_T){ (key), LOG_FIELD_UINT,   { .u = (uint64_t)(v) } })
+#define LOG_KV_DOUBLE(key, v) ((LogField_T){ (key), LOG_FIELD_DOUBLE, { .d = (double)(v) } })
+#define LOG_KV_BOOL(key, v)   ((LogField_T){ (key), LOG_FIELD_BOOL,   { .b = (v) ? true : false } })
+#define LOG_KV_STR(key, v)    ((LogField_T){ (key), LOG_FIELD_STRING, { .s = (v) } })
+
+/**
+ * @brief A packed field read back.
+ */
+typedef struct LogFieldView_T {
+    const char *key;
+    size_t key_length;
+    LogFieldType type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+    } value;
+    const char *text;   // Strings only, not terminated
+    size_t text_length;
+} LogFieldView_T;
+
+/**
+ * @brief Packs fields.
+ * @param out Where to pack them.
+ * @param room Bytes available at @p out.
+ * @param fields The fields.
+ * @param count How many there are.
+ * @return Bytes used; fields that did not fit are left out.
+ */
+size_t log_fields_encode(char *out, size_t room, const LogField_T *fields, size_t count);
+
+/**
+ * @brief Reads the next packed field.
+ * @param cursor Position in the packed fields, advanced past the field.
+ * @param end End of the packed fields.
+ * @param field Receives the field; its pointers point into the packed bytes.
+ * @return false at the end, or if the rest is not a whole field.
+ */
+bool log_fields_next(const char **cursor, const char *end, LogFieldView_T *field);
+
+/**
+ * @brief Writes packed fields as text, " key=value" each, quoting strings
+ * that are empty or contain spaces, quotes or '='.
+ * @param out Where to write.
+ * @param room Bytes available at @p out; nothing is terminated.
+ * @param fields The packed fields.
+ * @param length Their size.
+ * @return Bytes written; a field that does not fit ends the text.
+ */
+size_t log_fields_append_text(char *out, size_t room, const char *fields, size_t length);
+
+/**
+ * @brief Writes an integer in decimal, as the field writers do.
+ * @param out Where to write, at least 21 bytes.
+ * @param value The value.
+ * @param negative Write a minus sign first.
+ * @return Bytes written.
+ */
+size_t log_fields_format_uint(char *out, uint64_t value, bool negative);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_FIELDS_H
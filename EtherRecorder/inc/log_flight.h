@@ -0,0 +1,159 @@
+/**
+* @file log_flight.h
+* @brief Crash flight recorder: recent log calls kept in a shared mapping.
+*
+* Every logger_log call at or above the recorder's level is recorded, whatever
+* the log level, before the level decides whether it is queued. Each thread
+* has a ring of fixed-size records in a file mapped shared, and overwrites its
+* oldest record; threads beyond LOG_FLIGHT_REGIONS - 1 share the last ring.
+* Records hold the format and captured arguments as log_format_capture leaves
+* them, with the format string copied in, so nothing is formatted to record
+* them; calls that do not fit are stored as text.
+*
+* The mapping lives in memory: on Linux the default file is in /dev/shm, so in
+* normal running nothing reaches a disk. Being a shared mapping, it outlives the
+* process however that ends. A fatal signal copies it to a crash file beside
+* the logs; a run that ended without closing the recorder, killed or hung, is
+* copied out at the next start. etherlog-salvage prints either.
+*
+* Layout, in the writer's native byte order and argument sizes:
+*   LogFlightHeader_T, padded to LOG_FLIGHT_ALIGN
+*   per region: LogFlightRegion_T, then slots records of LogFlightRecord_T
+*
+* A record's sequence is zero while it is being written and its position in
+* the ring plus one once complete, so a reader skips records torn by the crash.
+*/
+#ifndef LOG_FLIGHT_H
+#define LOG_FLIGHT_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logger.h"
+#include "log_binary.h"
+#include "log_label.h"
+#include "platform_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_FLIGHT_MAGIC "EFLIGHT"    // 8 bytes with the terminator
+#define LOG_FLIGHT_VERSION 1
+#define LOG_FLIGHT_REGIONS 32         // Rings, the last shared by threads beyond the rest
+#define LOG_FLIGHT_RECORD_SIZE 512
+#define LOG_FLIGHT_LABEL_SIZE 32
+#define LOG_FLIGHT_ALIGN 4096
+#define LOG_FLIGHT_OFF (LOG_FATAL + 1) // log_flight_level while nothing is recorded
+
+#define LOG_FLIGHT_DEFAULT_SLOTS 1024
+#define LOG_FLIGHT_DEFAULT_FILE "/dev/shm/EtherRecorder.flight" // Linux: tmpfs, so memory only
+#define LOG_FLIGHT_DEFAULT_FILE_NAME "flight_recorder.bin"      // Elsewhere: in the log directory
+
+typedef enum LogFlightState {
+    LOG_FLIGHT_RUNNING = 1, // Open, or the process died without a handler running
+    LOG_FLIGHT_CRASHED = 2, // The fatal signal handler ran
+    LOG_FLIGHT_CLOSED = 3   // Closed with the logger
+} LogFlightState;
+
+/**
+ * @brief Start of the mapping.
+ */
+typedef struct LogFlightHeader_T {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t regions;
+    uint32_t slots;                      // Records per region
+    uint64_t total_size;                 // Bytes in the mapping
+    LogBinaryHeader_T clock;             // Clock reference and argument sizes, as in binary log files
+    PlatformAtomic64_T state;            // LogFlightState
+    PlatformAtomic64_T signal;           // The fatal signal or exception code, once crashed
+    PlatformAtomic64_T regions_claimed;
+    int64_t process_id;
+    char labels[LOG_LABEL_MAX][LOG_FLIGHT_LABEL_SIZE]; // By label id, filled in as labels are first recorded
+} LogFlightHeader_T;
+
+/**
+ * @brief Start of one thread's ring.
+ */
+typedef struct LogFlightRegion_T {
+    PlatformAtomic64_T head; // Records ever started in the ring
+    char padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+} LogFlightRegion_T;
+
+/**
+ * @brief One recorded call.
+ */
+typedef struct LogFlightRecord_T {
+    PlatformAtomic64_T sequence; // Position in the ring plus one once written, 0 while being written
+    int64_t timestamp;           // Timestamp ticks
+    uint16_t label_id;
+    uint8_t level;
+    uint8_t deferred;            // data is the format, a terminator and the captured arguments
+    uint16_t format_length;      // Deferred: bytes of format before its terminator
+    uint16_t data_length;        // Bytes of data in use
+    char data[LOG_FLIGHT_RECORD_SIZE - 24]; // Otherwise the message text, terminated
+} LogFlightRecord_T;
+
+/* Offset of the first region, and the size of one, in a mapping with @p slots records per region. */
+#define LOG_FLIGHT_REGIONS_OFFSET (((sizeof(LogFlightHeader_T) + LOG_FLIGHT_ALIGN - 1) / LOG_FLIGHT_ALIGN) * LOG_FLIGHT_ALIGN)
+#define LOG_FLIGHT_REGION_SIZE(slots) (sizeof(LogFlightRegion_T) + (size_t)(slots) * sizeof(LogFlightRecord_T))
+
+/**
+ * @brief Calls at or above this level are recorded; LOG_FLIGHT_OFF when the recorder is closed.
+ */
+extern volatile int log_flight_level;
+
+/**
+ * @brief Copies the recorder left by an earlier run that did not close it. One
+ * still locked by the process recording into it is left alone.
+ * @param name The recorder's file.
+ * @param directory Where to put the copy, named flight_recorder.<pid>.crash after the run's process.
+ * @param saved_name Receives the copy's name.
+ * @param size The size of @p saved_name.
+ * @return true if there was one and it was copied.
+ */
+bool log_flight_save_previous(const char *name, const char *directory, char *saved_name, size_t size);
+
+/**
+ * @brief Creates the recorder and starts recording. The file is locked for as
+ * long as the process runs, and one another process holds is not touched.
+ * @param name The file to map.
+ * @param crash_name The file the fatal signal handler copies the mapping to.
+ * @param slots Records per thread.
+ * @param level The lowest level recorded.
+ * @param clock The clock reference for turning timestamps into times.
+ * @return true on success; false on failure, or if another process is recording into @p name.
+ */
+bool log_flight_open(const char *name, const char *crash_name, uint32_t slots, LogLevel level, const LogBinaryHeader_T *clock);
+
+/**
+ * @brief Records a call. Safe to call from any thread; wait-free.
+ * @param level The call's level.
+ * @param label_id The calling thread's label.
+ * @param format The format.
+ * @param args Its arguments, left unconsumed.
+ */
+void log_flight_record(LogLevel level, uint16_t label_id, const char *format, va_list args);
+
+/**
+ * @brief Marks the recorder crashed and copies it to the crash file. For the
+ * fatal signal handler only: it uses nothing unsafe there.
+ * @param signal The signal or exception code.
+ */
+void log_flight_crashed(int signal);
+
+/**
+ * @brief Stops recording, marks the recorder closed and removes its file.
+ * The mapping itself is kept until the process exits, as other threads may
+ * still be in log_flight_record, so the recorder cannot be opened again.
+ */
+void log_flight_close(void);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_FLIGHT_H
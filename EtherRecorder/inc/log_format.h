@@ -0,0 +1,84 @@
+/**
+* @file log_format.h
+* @brief Deferred formatting of log messages.
+*
+* Rather than running vsnprintf on the calling thread, a producer can capture
+* the format string pointer, a one byte type code per argument and the raw
+* argument bytes into the entry's message buffer. The logger thread renders
+* the text later. Format strings must outlive the entry, which string
+* literals at logger_log call sites always do; %s arguments are copied.
+*/
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_FORMAT_MAX_ARGS 16 // Formats taking more arguments are formatted immediately
+
+/**
+ * @brief The C type an argument was passed as, which is also how it is read back.
+ */
+typedef enum LogArgType {
+    LOG_ARG_INT,      // int and anything promoted to it (char, short)
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,     // size_t (%z)
+    LOG_ARG_INTMAX,   // intmax_t (%j)
+    LOG_ARG_PTRDIFF,  // ptrdiff_t (%t)
+    LOG_ARG_DOUBLE,   // double and float
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING    // Copied into the entry, not just the pointer
+} LogArgType;
+
+/**
+ * @brief Captures a format and its arguments into an entry without formatting.
+ *
+ * On success entry->format is set and entry->message holds the argument count,
+ * the type codes and the raw argument bytes, with entry->message_length bytes
+ * in use. Formats using %n, wide characters or more than LOG_FORMAT_MAX_ARGS
+ * arguments, or whose arguments do not fit, are refused and nothing useful is
+ * left in the entry.
+ *
+ * @param entry The entry to capture into; the header is left untouched.
+ * @param format The format string, which must stay valid until rendered.
+ * @param args The arguments. Consumed whether or not the capture succeeds.
+ * @return true if captured, false if the caller must format it now.
+ */
+bool log_format_capture(LogEntry_T *entry, const char *format, va_list args);
+
+/**
+ * @brief Checks a captured entry from outside this process, such as one read
+ * back from a file, before it is rendered.
+ *
+ * The argument count and type codes must fit in entry->message_length and be
+ * exactly what entry->format takes, each argument must fit after them, and
+ * every string must end inside it.
+ *
+ * @param entry The entry, with format, message and message_length set.
+ * @return true if log_format_render can read it safely.
+ */
+bool log_format_validate(const LogEntry_T *entry);
+
+/**
+ * @brief Renders a captured entry's message text.
+ * @param entry An entry filled in by log_format_capture.
+ * @param buffer Receives the text, always terminated.
+ * @param size The size of @p buffer.
+ * @return The number of characters written, excluding the terminator.
+ */
+size_t log_format_render(const LogEntry_T *entry, char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_FORMAT_H
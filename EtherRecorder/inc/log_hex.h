@@ -0,0 +1,55 @@
+/**
+* @file log_hex.h
+* @brief Hex dump rows for logged binary data.
+*
+* Bytes are turned into upper case hex sixteen at a time with SSE2 on x86-64
+* and NEON on ARM64: each byte is split into its two nibbles, each nibble
+* becomes '0' + n, plus 7 more where n is above 9, and the two are
+* interleaved, so there is no table lookup and no branch per byte. Elsewhere
+* a table of the sixteen digits does the same one byte at a time.
+*
+* A row shows LOG_HEX_ROW_BYTES bytes as LOG_HEX_ROW_BLOCKS blocks of
+* LOG_HEX_BLOCK_BYTES, e.g.
+*
+*   0011AABB ........ ........ ........
+*
+* with dots for the positions a row does not fill, so that rows of a stream
+* logged in pieces line up.
+*/
+#ifndef LOG_HEX_H
+#define LOG_HEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_HEX_BLOCK_BYTES 4
+#define LOG_HEX_ROW_BLOCKS 4
+#define LOG_HEX_ROW_BYTES (LOG_HEX_BLOCK_BYTES * LOG_HEX_ROW_BLOCKS)
+#define LOG_HEX_ROW_LENGTH (LOG_HEX_ROW_BLOCKS * (LOG_HEX_BLOCK_BYTES * 2 + 1) - 1) // Blocks and the spaces between
+
+/**
+ * @brief Writes bytes as upper case hex, two characters each.
+ * @param out Where to write, 2 * @p length bytes; nothing is terminated.
+ * @param data The bytes.
+ * @param length How many there are.
+ */
+void log_hex_encode(char *out, const uint8_t *data, size_t length);
+
+/**
+ * @brief Writes one row of a hex dump.
+ * @param out Where to write, LOG_HEX_ROW_LENGTH bytes; nothing is terminated.
+ * @param data The bytes in the row.
+ * @param start Position in the row of the first, the rest before it shown as dots.
+ * @param count How many there are; start + count is at most LOG_HEX_ROW_BYTES.
+ */
+void log_hex_row(char *out, const uint8_t *data, size_t start, size_t count);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_HEX_H
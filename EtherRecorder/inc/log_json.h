@@ -0,0 +1,52 @@
+/**
+* @file log_json.h
+* @brief JSON text for the JSON-lines log sink.
+*
+* Each entry becomes one line holding one object:
+*
+*   {"index":12,"ts":1760657074000134005,"level":"INFO","label":"CLIENT","msg":"Received data","bytes":76,"port":4100}
+*
+* ts is nanoseconds since the Unix epoch, and the entry's typed fields follow
+* msg as members of their own, numbers as numbers, so a shipper can take the
+* line as it is. Strings are escaped by hand into the caller's buffer; nothing
+* is allocated. Bytes of 0x80 and above are passed through, so text is only
+* valid JSON if it was valid UTF-8.
+*/
+#ifndef LOG_JSON_H
+#define LOG_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_JSON_ESCAPED_MAX 6 // Most bytes one input byte can become, as \u00XX
+
+/**
+ * @brief Escapes text for use inside a JSON string; the quotes are the caller's.
+ * @param out Where to write.
+ * @param room Bytes available at @p out; nothing is terminated.
+ * @param text The text.
+ * @param length Its length.
+ * @return Bytes written. Text that does not fit is cut at a character
+ * boundary, never inside an escape or a UTF-8 sequence.
+ */
+size_t log_json_escape(char *out, size_t room, const char *text, size_t length);
+
+/**
+ * @brief Writes packed fields (log_fields.h) as object members, ,"key":value each.
+ * @param out Where to write.
+ * @param room Bytes available at @p out; nothing is terminated.
+ * @param fields The packed fields.
+ * @param length Their size.
+ * @return Bytes written; a member that does not fit is left out whole.
+ */
+size_t log_json_append_fields(char *out, size_t room, const char *fields, size_t length);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_JSON_H
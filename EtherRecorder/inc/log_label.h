@@ -0,0 +1,40 @@
+/**
+* @file log_label.h
+* @brief Thread labels interned into small ids.
+*
+* A thread's label is interned once, when it is set, and entries carry only the
+* id. The logger routes on the id with a table lookup and turns it back into
+* text only when it writes the entry. Labels match without regard to case, as
+* the config keys naming them do. Id 0 is "UNKNOWN", for threads without a label.
+*/
+#ifndef LOG_LABEL_H
+#define LOG_LABEL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_LABEL_MAX 256   // Ids, including the reserved "UNKNOWN"
+#define LOG_LABEL_UNKNOWN 0
+
+/**
+ * @brief Returns the id for a label, adding it if new. Safe to call from any thread.
+ * @param label The label, truncated to THREAD_LABEL_SIZE - 1 characters.
+ * @return The id, or LOG_LABEL_UNKNOWN if @p label is NULL or the table is full.
+ */
+uint16_t log_label_intern(const char *label);
+
+/**
+ * @brief Returns the label for an id.
+ * @param id An id returned by log_label_intern.
+ * @return The label as first interned, or "UNKNOWN".
+ */
+const char *log_label_name(uint16_t id);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_LABEL_H
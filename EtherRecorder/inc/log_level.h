@@ -0,0 +1,80 @@
+/**
+* @file log_level.h
+* @brief Log levels per thread label.
+*
+* A label may have a level of its own, from <label>.log_level in [logger] or
+* the log_level.<label>=<level> command; labels without one follow the global
+* level. A labelled thread keeps its effective level in a thread-local, so the
+* check in _logger_log is one load and compare. Threads register that
+* thread-local when they take a label, and a change of level is written into
+* the thread-local of every registered thread it affects.
+*/
+#ifndef LOG_LEVEL_H
+#define LOG_LEVEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logger.h"
+#include "platform_atomic.h"
+#include "platform_threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_LEVEL_UNSET (-1)        // A label with no level of its own, or a thread not registered
+#define LOG_LEVEL_MAX_THREADS 128   // Threads that can be registered at once
+
+/**
+ * @brief The calling thread's effective level, LOG_LEVEL_UNSET until it is
+ * registered; below every level, so unregistered threads fall through to the
+ * global level. Written by other threads when levels change, so read it with
+ * platform_atomic_load_relaxed_64.
+ */
+extern THREAD_LOCAL PlatformAtomic64_T log_level_this_thread;
+
+/**
+ * @brief The level for threads without a label level of their own.
+ */
+extern PlatformAtomic64_T log_level_global;
+
+/**
+ * @brief Sets the global level and updates every thread following it.
+ * @param level The level.
+ */
+void log_level_set_global(LogLevel level);
+
+/**
+ * @brief Sets a label's own level and updates that label's threads.
+ * @param label The label.
+ * @param level The level, or LOG_LEVEL_UNSET to follow the global level again.
+ * @return false if the label could not be interned.
+ */
+bool log_level_set_label(const char *label, int level);
+
+/**
+ * @brief Returns a label's own level.
+ * @param label_id The label's id.
+ * @return The level, or LOG_LEVEL_UNSET.
+ */
+int log_level_get_label(uint16_t label_id);
+
+/**
+ * @brief Registers the calling thread's level under a label, or moves it to a
+ * new one, and sets it from that label.
+ * @param label_id The thread's label id.
+ */
+void log_level_register_thread(uint16_t label_id);
+
+/**
+ * @brief Removes the calling thread from the registry. Must be called before
+ * a registered thread exits, as its thread-local goes with it.
+ */
+void log_level_unregister_thread(void);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_LEVEL_H
@@ -0,0 +1,105 @@
+/**
+* @file log_metrics.h
+* @brief Counters the logger keeps on itself.
+*
+* Queue depths are sampled by the logger thread each time it drains, just
+* before it does, which is when they are deepest; the high water is the
+* deepest seen. Producers time one call to _logger_log in every
+* LOG_METRICS_SAMPLE_EVERY, from the entry's timestamp to the entry being
+* queued, into a histogram of power-of-two buckets of timestamp ticks. The
+* logger thread times every entry it publishes against the entry's timestamp
+* into a second histogram. Updates are single atomic adds, so they are always
+* on; the report is logger_report_metrics.
+*/
+#ifndef LOG_METRICS_H
+#define LOG_METRICS_H
+
+#include <stdint.h>
+
+#include "platform_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_METRICS_BUCKETS 40      // Bucket b holds values below 2^b ticks, the last everything else
+#define LOG_METRICS_SAMPLE_EVERY 16 // Producers time one enqueue in this many, a power of two
+
+/**
+ * @brief A histogram of durations in timestamp ticks.
+ */
+typedef struct LogHistogram_T {
+    PlatformAtomic64_T buckets[LOG_METRICS_BUCKETS];
+    PlatformAtomic64_T count;
+    PlatformAtomic64_T max;
+} LogHistogram_T;
+
+/**
+ * @brief Current and deepest sampled depth of a queue.
+ */
+typedef struct LogDepth_T {
+    uint64_t current;
+    uint64_t high_water;
+} LogDepth_T;
+
+/**
+ * @brief A snapshot of the counters.
+ */
+typedef struct LogMetrics_T {
+    LogDepth_T shared_queue;  // Entries in the shared queue
+    LogDepth_T thread_queue;  // Bytes in the fullest per-thread queue
+    LogDepth_T spill;         // Entries in the overflow buffer
+    uint64_t overflow_events; // Entries that found their queues full
+    uint64_t enqueue[LOG_METRICS_BUCKETS];
+    uint64_t enqueue_count;
+    uint64_t enqueue_max;
+    uint64_t publish_lag[LOG_METRICS_BUCKETS];
+    uint64_t publish_lag_count;
+    uint64_t publish_lag_max;
+} LogMetrics_T;
+
+/**
+ * @brief Records the queue depths found at the start of a drain. Logger thread only.
+ * @param shared_entries Entries waiting in the shared queue.
+ * @param thread_bytes Bytes waiting in the fullest per-thread queue.
+ * @param spill_entries Entries waiting in the overflow buffer.
+ */
+void log_metrics_record_depths(uint64_t shared_entries, uint64_t thread_bytes, uint64_t spill_entries);
+
+/**
+ * @brief Records the time one call took to queue an entry. Safe to call from any thread.
+ * @param ticks Timestamp ticks from the entry's timestamp to it being queued.
+ */
+void log_metrics_record_enqueue(int64_t ticks);
+
+/**
+ * @brief Records how long an entry waited to be published. Logger thread only.
+ * @param ticks Timestamp ticks from the entry's timestamp to its publication.
+ */
+void log_metrics_record_publish(int64_t ticks);
+
+/**
+ * @brief Counts an entry that found its queues full. Safe to call from any thread.
+ */
+void log_metrics_record_overflow(void);
+
+/**
+ * @brief Takes a snapshot of the counters. Safe to call from any thread.
+ * @param metrics Receives the snapshot.
+ */
+void log_metrics_get(LogMetrics_T *metrics);
+
+/**
+ * @brief Estimates a percentile from histogram buckets.
+ * @param buckets The buckets.
+ * @param count The values counted in them.
+ * @param fraction The percentile as a fraction, e.g. 0.99.
+ * @return The upper bound in ticks of the bucket holding the percentile, 0 if nothing was counted.
+ */
+uint64_t log_metrics_percentile(const uint64_t *buckets, uint64_t count, double fraction);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_METRICS_H
@@ -0,0 +1,111 @@
+/**
+* @file log_net.h
+* @brief Network log sink: log lines streamed to a collector over UDP or TCP.
+*
+* The sink is a LogSink_T (log_sink.h) whose writer thread is the sender:
+* the logger thread copies each rendered line into its ring and returns,
+* never touching the socket, and the sender packs the waiting lines into as
+* few datagrams or TCP writes as it can, up to batch_bytes each. A datagram
+* only ever holds whole lines, so a collector can split it on newlines.
+*
+* When the ring is full, because the collector is slow or unreachable, new
+* lines are dropped and counted, so the logger and the queues behind it never
+* back up. A TCP sink that loses its connection keeps what is queued and
+* reconnects every LOG_NET_RECONNECT_MS.
+*
+* Only the logger thread calls log_net_write and log_net_wake; the rest is
+* for whoever opens and closes the sink. The sender never logs, to stay out
+* of its own way.
+*/
+#ifndef LOG_NET_H
+#define LOG_NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_NET_UDP_BATCH 1400      // Default datagram payload, under a typical MTU
+#define LOG_NET_TCP_BATCH 65536     // Default TCP write
+#define LOG_NET_RECONNECT_MS 2000
+#define LOG_NET_CONNECT_TIMEOUT_S 1
+
+typedef enum LogNetProtocol {
+    LOG_NET_OFF,
+    LOG_NET_UDP,
+    LOG_NET_TCP
+} LogNetProtocol;
+
+/**
+ * @brief Counts kept by a sink.
+ */
+typedef struct LogNetStats_T {
+    LogSinkStats_T sink;     // Its writes are datagrams or TCP writes
+    uint64_t connects;       // Successful TCP connections
+    bool connected;
+} LogNetStats_T;
+
+/**
+ * @brief A network sink; what it holds is private to log_net.c, which keeps
+ * the socket headers out of everything that logs.
+ */
+typedef struct LogNetSink_T LogNetSink_T;
+
+/**
+ * @brief Reads a protocol name, "udp" or "tcp" in any case.
+ * @param name The name, or NULL.
+ * @return The protocol, LOG_NET_OFF if @p name is neither.
+ */
+LogNetProtocol log_net_protocol_from_string(const char *name);
+
+/**
+ * @brief Sets up a sink and starts its sender; connecting is left to the sender.
+ * @param protocol LOG_NET_UDP or LOG_NET_TCP.
+ * @param host The collector's host name or address.
+ * @param port The collector's port.
+ * @param batch_bytes Most bytes per datagram or write, 0 for the protocol's default.
+ * @param flush_interval_ms Longest a line waits before it is sent.
+ * @param queue_bytes Size of the ring, rounded up to a power of two.
+ * @return The sink, or NULL if it could not be started.
+ */
+LogNetSink_T *log_net_open(LogNetProtocol protocol, const char *host, int port,
+                           size_t batch_bytes, int flush_interval_ms, size_t queue_bytes);
+
+/**
+ * @brief Queues one line, newline included. Never waits.
+ * @param sink The sink.
+ * @param data The line.
+ * @param length Its length; lines over LOG_SINK_RECORD_MAX are cut short.
+ * @return false if the ring was full and the line was dropped.
+ */
+bool log_net_write(LogNetSink_T *sink, const char *data, size_t length);
+
+/**
+ * @brief Has the sender send what is queued now rather than at the next interval.
+ * @param sink The sink.
+ */
+void log_net_wake(LogNetSink_T *sink);
+
+/**
+ * @brief Reads the sink's counts. Safe from any thread.
+ * @param sink The sink.
+ * @param stats Receives the counts.
+ */
+void log_net_get_stats(LogNetSink_T *sink, LogNetStats_T *stats);
+
+/**
+ * @brief Sends what is queued, if it can, stops the sender and frees the sink.
+ * @param sink The sink, or NULL.
+ */
+void log_net_close(LogNetSink_T *sink);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_NET_H
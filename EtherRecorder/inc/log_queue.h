@@ -1,24 +1,56 @@
 /*
 * @file log_queue.h
 * @brief Contains the log queue functions.
+*
+* The log queue is a bounded multi-producer, single-consumer ring. Each slot
+* carries a sequence number; producers reserve a slot by advancing the head with
+* a compare-and-swap and publish it by releasing the slot's sequence, so two
+* producers can never write the same slot. Only the logger thread pops.
 */
 #ifndef LOG_QUEUE_H
 #define LOG_QUEUE_H
 
 #include "logger.h"
+#include "platform_atomic.h"
 
 
-#define LOG_QUEUE_SIZE 20000 // Size of the log queue
+// Threads normally log through their own queues (thread_log_queue.h), this one
+// only serves unlabelled threads and overflow, so it is kept small.
+#define LOG_QUEUE_SIZE 1024 // Size of the log queue, must be a power of two
+#define LOG_QUEUE_MASK (LOG_QUEUE_SIZE - 1)
+
+/**
+ * @brief A single slot in the log queue.
+ */
+typedef struct LogQueueSlot_T {
+    PlatformAtomic64_T sequence; // Position the slot is ready for
+    LogEntry_T entry;
+} LogQueueSlot_T;
 
 /**
  * @brief Structure representing a log queue.
+ *
+ * head and tail are monotonically increasing positions, each on its own cache
+ * line so producers and the consumer do not share a line.
  */
 typedef struct LogQueue_T {
-    long head;
-    long tail;
-    LogEntry_T entries[LOG_QUEUE_SIZE];
+    PlatformAtomic64_T head; // Next position to be reserved by a producer
+    char head_padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+    PlatformAtomic64_T tail; // Next position to be popped by the consumer
+    char tail_padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+    PlatformAtomic64_T full_count; // Pushes rejected because the queue was full
+    LogQueueSlot_T slots[LOG_QUEUE_SIZE];
 } LogQueue_T;
 
+/**
+ * @brief Snapshot of the queue counters.
+ */
+typedef struct LogQueueStats_T {
+    uint64_t enqueued;   // Entries successfully pushed
+    uint64_t dequeued;   // Entries popped by the consumer
+    uint64_t full_count; // Pushes rejected because the queue was full
+} LogQueueStats_T;
+
 extern LogQueue_T global_log_queue; // Declare the log queue
 
 /**
@@ -27,16 +59,41 @@ extern LogQueue_T global_log_queue; // Declare the log queue
  */
 void log_queue_init(LogQueue_T *queue);
 
-
+/**
+ * @brief Pushes a log entry onto the log queue. Safe to call from any thread.
+ * @param log_queue The log queue.
+ * @param entry The log entry to copy into the queue.
+ * @return true on success, false if the queue is full.
+ */
 bool log_queue_push(LogQueue_T *log_queue, const LogEntry_T *entry);
 
 /**
- * @brief Pops a log entry from the log queue.
+ * @brief Pops a log entry from the log queue. Only the logger thread may call this.
  * @param queue The log queue.
  * @param entry The log entry to populate.
- * @return 0 on success, -1 if the queue is empty.
+ * @return true on success, false if the queue is empty.
  */
 bool log_queue_pop(LogQueue_T *queue, LogEntry_T *entry);
 
+/**
+ * @brief Returns the oldest entry without removing it. Only the logger thread may call this.
+ * @param queue The log queue.
+ * @return The entry, valid until log_queue_consume, or NULL if the queue is empty.
+ */
+const LogEntry_T *log_queue_peek(LogQueue_T *queue);
+
+/**
+ * @brief Removes the entry returned by log_queue_peek.
+ * @param queue The log queue.
+ */
+void log_queue_consume(LogQueue_T *queue);
+
+/**
+ * @brief Reads the queue counters.
+ * @param queue The log queue.
+ * @param stats Receives the counters.
+ */
+void log_queue_get_stats(LogQueue_T *queue, LogQueueStats_T *stats);
+
 
 #endif // LOG_QUEUE_H
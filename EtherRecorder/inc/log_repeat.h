@@ -0,0 +1,63 @@
+/**
+* @file log_repeat.h
+* @brief Collapsing of identical consecutive log messages.
+*
+* When a thread label logs the same message at the same level several times in
+* a row, only the first is published. The rest are counted, and the count is
+* published as "last message repeated N times" when the label logs something
+* else, or once the count has been held for the report interval, so a message
+* that repeats for ever is still accounted for. Messages are compared as they
+* were queued, format and captured arguments for deferred entries, so nothing
+* is formatted just to compare it.
+*
+* Only the logger thread uses these, with logging_mutex held.
+*/
+#ifndef LOG_REPEAT_H
+#define LOG_REPEAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What to do with an entry.
+ */
+typedef enum LogRepeatResult {
+    LOG_REPEAT_PUBLISH,               // Publish the entry
+    LOG_REPEAT_PUBLISH_AFTER_SUMMARY, // Publish the summary, then the entry
+    LOG_REPEAT_HELD                   // A repeat, counted rather than published
+} LogRepeatResult;
+
+/**
+ * @brief Looks at an entry before it is published.
+ * @param entry The entry.
+ * @param summary Receives the count of the label's previous message when the
+ * result is LOG_REPEAT_PUBLISH_AFTER_SUMMARY.
+ * @return What to do with @p entry.
+ */
+LogRepeatResult log_repeat_check(const LogEntry_T *entry, LogEntry_T *summary);
+
+/**
+ * @brief Takes the count of one label whose repeats have been held since before @p cutoff.
+ * The label carries on collapsing the same message.
+ * @param cutoff Timestamp ticks; counts held since before it are due. INT64_MAX takes every count.
+ * @param summary Receives the count.
+ * @return true if @p summary was filled in; call again until false.
+ */
+bool log_repeat_take_due(int64_t cutoff, LogEntry_T *summary);
+
+/**
+ * @brief Returns the number of labels with repeats held back.
+ */
+int log_repeat_held(void);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_REPEAT_H
@@ -0,0 +1,71 @@
+/**
+* @file log_ring.h
+* @brief In-memory ring of the most recent log lines.
+*
+* A sink that keeps the last few hundred kilobytes of rendered lines in
+* memory, overwriting the oldest whole lines as new ones arrive, so a noisy
+* label can be routed here at DEBUG and only written out when someone asks
+* for it. Writing a line is a copy, so the ring has no writer thread of its
+* own; its buffer is its queue.
+*
+* Only the logger thread uses a ring, with logging_mutex held.
+*/
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A ring of lines.
+ */
+typedef struct LogRing_T {
+    char *data;
+    size_t size;              // A power of two
+    uint64_t head;            // Bytes ever written
+    uint64_t tail;            // Start of the oldest line kept
+    uint64_t lines;           // Lines written
+    uint64_t lines_overwritten;
+} LogRing_T;
+
+/**
+ * @brief Allocates a ring.
+ * @param ring The ring.
+ * @param bytes Its size, rounded up to a power of two.
+ * @return true if it was allocated.
+ */
+bool log_ring_init(LogRing_T *ring, size_t bytes);
+
+/**
+ * @brief Adds a line, newline included, overwriting the oldest lines to make room.
+ * @param ring The ring.
+ * @param data The line.
+ * @param length Its length; a line longer than the ring is not kept.
+ */
+void log_ring_write(LogRing_T *ring, const char *data, size_t length);
+
+/**
+ * @brief Copies out the newest lines that fit, oldest first.
+ * @param ring The ring.
+ * @param out Where to copy them.
+ * @param room Bytes available at @p out; nothing is terminated.
+ * @return Bytes copied.
+ */
+size_t log_ring_copy(const LogRing_T *ring, char *out, size_t room);
+
+/**
+ * @brief Releases a ring.
+ * @param ring The ring.
+ */
+void log_ring_free(LogRing_T *ring);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_RING_H
@@ -0,0 +1,92 @@
+/**
+* @file log_route.h
+* @brief Which sinks each entry goes to, by level and thread label.
+*
+* Rules are read from [logger] as route.1, route.2 and so on, each
+*
+*   route.N = <level> <label> <sinks>
+*
+* e.g. "route.2 = WARN * console,network" or "route.3 = DEBUG client* ring":
+* entries at <level> or above from a label matching <label>, "*" for any and
+* a trailing '*' for a prefix, go to each of <sinks>, any of file, console,
+* network and ring. An entry goes to every sink a matching rule names. With
+* no rules, every entry goes to the default sinks. A sink may also be given a
+* floor, console_level for the console, below which it takes nothing whatever
+* the rules say.
+*
+* Matching labels is done once per label, the first time an entry from it is
+* published; the result, a mask of sinks per level, is kept in a table
+* indexed by label id and level, so routing an entry is a single lookup.
+*
+* Only the logger thread uses these, with logging_mutex held.
+*/
+#ifndef LOG_ROUTE_H
+#define LOG_ROUTE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_ROUTE_MAX_RULES 16
+
+/**
+ * @brief The sinks, as bits of a mask.
+ */
+typedef enum LogSinkMask {
+    LOG_SINK_FILE    = 1 << 0, // The label's log file
+    LOG_SINK_CONSOLE = 1 << 1,
+    LOG_SINK_NETWORK = 1 << 2,
+    LOG_SINK_RING    = 1 << 3  // In memory, see log_ring.h
+} LogSinkMask;
+
+/**
+ * @brief Removes every rule and sets the sinks used when there are none.
+ * @param default_sinks A mask of LogSinkMask bits.
+ */
+void log_route_init(uint8_t default_sinks);
+
+/**
+ * @brief Changes the sinks used when there are no rules.
+ * @param default_sinks A mask of LogSinkMask bits.
+ */
+void log_route_set_default(uint8_t default_sinks);
+
+/**
+ * @brief Sets the lowest level some sinks take, whatever the rules say.
+ * @param sinks A mask of LogSinkMask bits.
+ * @param level The lowest level; LOG_TRACE for no floor.
+ */
+void log_route_set_floor(uint8_t sinks, LogLevel level);
+
+/**
+ * @brief Adds a rule.
+ * @param rule The rule's text, "<level> <label> <sinks>".
+ * @return false if the rule could not be read or there are too many.
+ */
+bool log_route_add(const char *rule);
+
+/**
+ * @brief Returns the sinks for an entry.
+ * @param level The entry's level.
+ * @param label_id The entry's label.
+ * @return A mask of LogSinkMask bits.
+ */
+uint8_t log_route_lookup(LogLevel level, uint16_t label_id);
+
+/**
+ * @brief Reports whether any rule names a sink.
+ * @param sink A LogSinkMask bit.
+ * @return true if a rule, or the default when there are none, includes it.
+ */
+bool log_route_uses(uint8_t sink);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_ROUTE_H
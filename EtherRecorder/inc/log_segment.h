@@ -0,0 +1,107 @@
+/**
+* @file log_segment.h
+* @brief Sequence-numbered segments of a log file.
+*
+* A configured log file such as logs/client.log is written as a series of
+* segments, logs/client.000001.log, logs/client.000002.log and so on, the
+* highest being the one in use. The logger counts the bytes it writes and moves
+* to the next segment once a segment is full; nothing is renamed, so a segment
+* is never overwritten. The next segment is opened ahead of time so the switch
+* itself is only a close, and the oldest segments are deleted to keep within
+* the configured limits. A closed segment may have been replaced by a
+* compressed copy, the same name with LOG_CODEC_SUFFIX appended; it is counted
+* and deleted in the same way.
+*
+* Only the logger thread uses these, with logging_mutex held.
+*/
+#ifndef LOG_SEGMENT_H
+#define LOG_SEGMENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "platform_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_SEGMENT_DIGITS 6 // Zero padding on the sequence number
+
+/**
+ * @brief The segments of one log file.
+ */
+typedef struct LogSegments_T {
+    char directory[MAX_PATH]; // Empty for the current directory
+    char stem[MAX_PATH];      // File name up to its extension
+    char extension[32];       // Including the dot, may be empty
+    uint32_t first;           // Oldest segment on disk
+    uint32_t current;         // Segment being written, 0 until the first open
+    FILE *next;               // Segment current + 1, opened ahead of time, or NULL
+    bool binary;              // Open in binary mode
+    bool read_write;          // Open for reading as well, as mapping a segment needs
+} LogSegments_T;
+
+/**
+ * @brief Sets up the segments of a log file. Nothing is opened.
+ * @param segments The segments.
+ * @param file_name The configured log file name.
+ * @param binary true to open the segments in binary mode.
+ */
+void log_segments_init(LogSegments_T *segments, const char *file_name, bool binary);
+
+/**
+ * @brief Builds the file name of a segment.
+ * @param segments The segments.
+ * @param sequence The segment's sequence number.
+ * @param buffer Receives the name.
+ * @param size The size of @p buffer.
+ */
+void log_segments_name(const LogSegments_T *segments, uint32_t sequence, char *buffer, size_t size);
+
+/**
+ * @brief Opens the newest segment for appending, looking for those left by
+ * earlier runs the first time it is called.
+ * @param segments The segments.
+ * @param purge true to delete the segments of earlier runs and start again at 1.
+ * @param existing_bytes Receives the size of the segment as opened.
+ * @return The stream, or NULL if it could not be opened.
+ */
+FILE *log_segments_open(LogSegments_T *segments, bool purge, uint64_t *existing_bytes);
+
+/**
+ * @brief Opens the segment after the current one so it is ready when needed.
+ * @param segments The segments.
+ * @return true if the next segment is open.
+ */
+bool log_segments_prepare_next(LogSegments_T *segments);
+
+/**
+ * @brief Moves on to the next segment, opening it now if it was not prepared.
+ * The caller closes the current stream first.
+ * @param segments The segments.
+ * @return The new segment's stream, or NULL if it could not be opened.
+ */
+FILE *log_segments_advance(LogSegments_T *segments);
+
+/**
+ * @brief Deletes the oldest segments until both limits are met. The current
+ * segment is always kept.
+ * @param segments The segments.
+ * @param max_segments The most segments to keep, 0 for no limit.
+ * @param max_total_bytes The most bytes to keep across all segments, 0 for no limit.
+ */
+void log_segments_prune(LogSegments_T *segments, uint32_t max_segments, uint64_t max_total_bytes);
+
+/**
+ * @brief Closes and deletes a prepared segment that was never used.
+ * @param segments The segments.
+ */
+void log_segments_close(LogSegments_T *segments);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_SEGMENT_H
@@ -0,0 +1,105 @@
+/**
+* @file log_sink.h
+* @brief A sink's own queue and writer thread.
+*
+* A sink that may be slow, a console or a network collector, is given a
+* bounded ring of rendered lines and a thread that writes them out, so it
+* only ever holds up its own output. The logger thread copies each line into
+* the ring and returns. The writer takes the waiting lines in batches of up
+* to batch_bytes, whole lines only, and hands each batch to the sink's write
+* function once batch_bytes are waiting or every flush_interval_ms, whichever
+* comes first, or at once when woken.
+*
+* The ring is lossy: when the sink falls behind and it fills, new lines are
+* dropped and counted rather than waited for, and the sink is told how many
+* were lost at the point in its output where they would have been. A sink
+* that is not ready, a collector not yet connected, leaves its lines queued
+* until it is.
+*
+* Only the logger thread calls log_sink_write and log_sink_wake. The write
+* functions run on the sink's own thread and must not log.
+*/
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_SINK_RECORD_MAX 8192 // Longest line queued, longer ones are cut short
+
+/**
+ * @brief What a sink does with its lines; both run on its writer thread.
+ */
+typedef struct LogSinkOps_T {
+    bool (*ready)(void *context); // May be NULL; false leaves the lines queued for later
+    bool (*write)(void *context, const char *data, size_t length); // Whole lines; false drops them
+    void (*skipped)(void *context, uint64_t lines); // May be NULL; lines dropped here as the ring was full
+} LogSinkOps_T;
+
+/**
+ * @brief Counts kept by a sink.
+ */
+typedef struct LogSinkStats_T {
+    uint64_t lines_queued;
+    uint64_t lines_dropped;  // Ring full, or lost with a failed write
+    uint64_t bytes_written;
+    uint64_t writes;         // Batches handed to the write function
+    uint64_t write_failures;
+    uint64_t queued_bytes;   // In the ring now
+} LogSinkStats_T;
+
+/**
+ * @brief A sink's queue and writer; what it holds is private to log_sink.c.
+ */
+typedef struct LogSink_T LogSink_T;
+
+/**
+ * @brief Sets up a sink's ring and starts its writer.
+ * @param ops The sink's functions, which must outlive it.
+ * @param context Passed to them.
+ * @param batch_bytes Most bytes per write; a longer line is written on its own.
+ * @param flush_interval_ms Longest a line waits before it is written.
+ * @param queue_bytes Size of the ring, rounded up to a power of two.
+ * @return The sink, or NULL if it could not be started.
+ */
+LogSink_T *log_sink_open(const LogSinkOps_T *ops, void *context, size_t batch_bytes,
+                         int flush_interval_ms, size_t queue_bytes);
+
+/**
+ * @brief Queues one line, newline included. Never waits.
+ * @param sink The sink.
+ * @param data The line.
+ * @param length Its length; lines over LOG_SINK_RECORD_MAX are cut short.
+ * @return false if the ring was full and the line was dropped.
+ */
+bool log_sink_write(LogSink_T *sink, const char *data, size_t length);
+
+/**
+ * @brief Has the writer write what is queued now rather than at the next interval.
+ * @param sink The sink.
+ */
+void log_sink_wake(LogSink_T *sink);
+
+/**
+ * @brief Reads the sink's counts. Safe from any thread.
+ * @param sink The sink.
+ * @param stats Receives the counts.
+ */
+void log_sink_get_stats(LogSink_T *sink, LogSinkStats_T *stats);
+
+/**
+ * @brief Writes what is queued, if the sink is ready, stops the writer and frees the sink.
+ * @param sink The sink, or NULL.
+ */
+void log_sink_close(LogSink_T *sink);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_SINK_H
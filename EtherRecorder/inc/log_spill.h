@@ -0,0 +1,99 @@
+/**
+* @file log_spill.h
+* @brief Overflow buffer for entries that find every log queue full.
+*
+* Used by the "spill" overflow policy. It is a bounded ring of whole entries,
+* allocated from the heap when the logger starts, so it can be made far larger
+* than the shared queue without costing anything under the other policies.
+* Producers append under a mutex, which only other spilling producers contend
+* for; the logger thread drains it without the lock, merged with the other
+* queues by thread_log_queue_drain.
+*/
+#ifndef LOG_SPILL_H
+#define LOG_SPILL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "logger.h"
+#include "platform_atomic.h"
+#include "platform_mutex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The overflow buffer. head and tail are entry positions that only ever
+ * increase; head is advanced under the mutex, tail only by the logger thread.
+ */
+typedef struct LogSpill_T {
+    PlatformAtomic64_T head;
+    char head_padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+    PlatformAtomic64_T tail;
+    char tail_padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+    PlatformMutex_T mutex;
+    LogEntry_T *entries; // NULL until log_spill_init succeeds
+    int64_t capacity;
+} LogSpill_T;
+
+extern LogSpill_T global_log_spill;
+
+/**
+ * @brief Allocates the buffer.
+ * @param spill The buffer.
+ * @param capacity The number of entries it can hold.
+ * @return false if it could not be allocated, in which case pushes fail.
+ */
+bool log_spill_init(LogSpill_T *spill, size_t capacity);
+
+/**
+ * @brief Appends an entry. Safe to call from any thread.
+ * @param spill The buffer.
+ * @param entry The entry to copy in.
+ * @return true on success, false if the buffer is full or was never allocated.
+ */
+bool log_spill_push(LogSpill_T *spill, const LogEntry_T *entry);
+
+/**
+ * @brief Checks whether the calling thread still has entries in the buffer
+ * waiting to be published.
+ *
+ * Until they are, the thread must keep spilling so its entries are published
+ * in the order they were logged.
+ *
+ * @param spill The buffer.
+ * @return true if the thread must keep spilling.
+ */
+bool log_spill_holding(LogSpill_T *spill);
+
+/**
+ * @brief Returns the number of entries waiting. Logger thread only.
+ * @param spill The buffer.
+ */
+size_t log_spill_pending(LogSpill_T *spill);
+
+/**
+ * @brief Returns the oldest entry without removing it. Logger thread only.
+ * @param spill The buffer.
+ * @return The entry, valid until log_spill_consume, or NULL if the buffer is empty.
+ */
+const LogEntry_T *log_spill_peek(LogSpill_T *spill);
+
+/**
+ * @brief Removes the entry returned by log_spill_peek.
+ * @param spill The buffer.
+ */
+void log_spill_consume(LogSpill_T *spill);
+
+/**
+ * @brief Releases the buffer. Nothing may be pushed concurrently.
+ * @param spill The buffer.
+ */
+void log_spill_free(LogSpill_T *spill);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_SPILL_H
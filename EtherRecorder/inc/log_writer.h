@@ -0,0 +1,159 @@
+/**
+* @file log_writer.h
+* @brief Buffered output for the log sinks.
+*
+* Each sink collects output in its own buffer and hands it to the stream in a
+* single write once the buffer fills or the logger decides it is time, rather
+* than flushing every line. Streams should be unbuffered so that one flush is
+* one system call. The logger serialises access with logging_mutex.
+*
+* A file sink can instead be mapped: the segment is preallocated and mapped,
+* writes are copied straight into it with no system call at all, and flushing
+* only asks the OS to write back, and drop, the pages behind the cursor.
+*
+* Or a file sink can hand its batches to an asynchronous queue (io_uring on
+* Linux). It then has two buffers: a flush queues the full one and carries on
+* filling the other, so formatting overlaps the disk write, and the logger
+* submits the writes queued by all its files in one call.
+*/
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "platform_aio.h"
+#include "platform_mmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_WRITER_MAP_SLACK (64 * 1024)       // Mapped past the rotation size, for the entry that crosses it
+#define LOG_WRITER_SYNC_BYTES (1024 * 1024)    // Mapped bytes written before a flush syncs and releases them
+
+struct LogWriter_T;
+
+/**
+ * @brief One of the two buffers of an asynchronous writer.
+ */
+typedef struct LogWriterSlot_T {
+    struct LogWriter_T *writer;
+    char *data;
+    size_t length;   // Bytes in flight from it, 0 when it is free to fill
+    uint64_t offset; // Where they go in the file
+} LogWriterSlot_T;
+
+/**
+ * @brief A sink's output buffer. A capacity of zero writes straight through.
+ */
+typedef struct LogWriter_T {
+    FILE *stream;
+    char *buffer;
+    size_t used;
+    size_t capacity;
+    uint64_t total; // Bytes accepted since the stream was set, the logger resets it on rotation
+    PlatformFileMap_T map; // Set while the stream is mapped; total is then the write offset
+    uint64_t synced;       // Mapped bytes already synced and released
+    PlatformAio_T *aio;        // Set when batches are queued on it rather than written by fwrite
+    int fd;                    // The stream's descriptor, for positioned writes; total is then the file offset
+    LogWriterSlot_T slots[2];  // With aio, buffer is one slot's data while the other may be in flight
+    int active;                // The slot being filled
+} LogWriter_T;
+
+/**
+ * @brief Sets up a writer for a stream.
+ * @param writer The writer.
+ * @param stream The destination, ideally unbuffered.
+ * @param capacity Bytes to collect before writing; 0 writes every call through.
+ * @return false if the buffer could not be allocated, in which case the writer writes through.
+ */
+bool log_writer_init(LogWriter_T *writer, FILE *stream, size_t capacity);
+
+/**
+ * @brief Appends bytes, writing the buffer out first if they do not fit.
+ * @param writer The writer.
+ * @param data The bytes to append.
+ * @param length The number of bytes.
+ * @return false if a write to the stream failed.
+ */
+bool log_writer_write(LogWriter_T *writer, const void *data, size_t length);
+
+/**
+ * @brief Writes out anything buffered in one call.
+ * @param writer The writer.
+ * @return false if the write failed; the buffered bytes are dropped either way.
+ */
+bool log_writer_flush(LogWriter_T *writer);
+
+/**
+ * @brief Maps the writer's file, preallocated to @p size bytes, and writes into
+ * the mapping from then on, starting at the current total.
+ * @param writer The writer.
+ * @param stream The file, opened for reading and writing.
+ * @param size Bytes to preallocate.
+ * @return false if the file could not be mapped, in which case the writer is unchanged.
+ */
+bool log_writer_map(LogWriter_T *writer, FILE *stream, size_t size);
+
+/**
+ * @brief Syncs and unmaps a mapped writer, cutting the file back to what was written.
+ * Does nothing if the writer is not mapped. The stream is left open.
+ * @param writer The writer.
+ */
+void log_writer_unmap(LogWriter_T *writer);
+
+/**
+ * @brief Sends the writer's batches through an asynchronous queue from now on,
+ * allocating its second buffer the first time. Call again after changing stream.
+ * @param writer The writer, which must have a buffer.
+ * @param aio The queue.
+ * @return false if the writer has no buffer or the stream cannot be written
+ *         asynchronously, in which case it carries on as it was.
+ */
+bool log_writer_set_async(LogWriter_T *writer, PlatformAio_T *aio);
+
+/**
+ * @brief Submits every write queued on @p aio in one call, then handles any
+ * that have finished. Never waits.
+ * @param aio The queue.
+ */
+void log_writer_submit(PlatformAio_T *aio);
+
+/**
+ * @brief Flushes the writer and, if it is asynchronous, waits for its writes
+ * to finish, as must be done before its stream is closed.
+ * @param writer The writer.
+ * @return false if a write failed.
+ */
+bool log_writer_settle(LogWriter_T *writer);
+
+/**
+ * @brief Writes out the buffered bytes straight to the stream's descriptor,
+ * for the fatal signal handler: no locks, no allocation, no stdio. Mapped
+ * writers need nothing, their bytes are already in the file; asynchronous
+ * ones are left alone.
+ * @param writer The writer.
+ */
+void log_writer_write_out_raw(LogWriter_T *writer);
+
+/**
+ * @brief Handles a completed asynchronous write; the callback for platform_aio_reap.
+ * @param context The writer's slot.
+ * @param result Bytes written, or a negative error.
+ */
+void log_writer_complete(void *context, long result);
+
+/**
+ * @brief Settles the writer and releases its buffers. The stream is left open.
+ * @param writer The writer.
+ */
+void log_writer_free(LogWriter_T *writer);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // LOG_WRITER_H
@@ -7,9 +7,13 @@
 
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <windows.h>
 
+#include "log_fields.h"
+#include "platform_atomic.h"
+
 
 
 #define LOG_MSG_BUFFER_SIZE 1024 // Buffer size for log messages
@@ -36,6 +40,18 @@ typedef enum LogLevel {
     LOG_FATAL     /**< Fatal level: Errors causing premature program termination */
 } LogLevel;
 
+/*
+ * Calls to logger_log below LOG_COMPILE_MIN_LEVEL compile to nothing, arguments
+ * included, as the level in nearly every call is a constant. Set it when
+ * building, e.g. -DLOG_COMPILE_MIN_LEVEL=LOG_INFO (make release_stripped does);
+ * by default nothing is stripped. Runtime levels still apply to what is left.
+ */
+#ifndef LOG_COMPILE_MIN_LEVEL
+#define LOG_COMPILE_MIN_LEVEL LOG_TRACE
+#endif
+
+#define LOG_COMPILED_IN(level) ((level) >= LOG_COMPILE_MIN_LEVEL)
+
 /**
  * @brief Logs a message with the specified log level.
  *
@@ -54,7 +70,9 @@ void _logger_log(LogLevel level, const char* format, ...);
 
 #define logger_log(level, fmt, ...)                                \
     do {                                                           \
-        if ((level) == LOG_TRACE || g_trace_all) {                 \
+        if (!LOG_COMPILED_IN(level)) {                             \
+            /* Stripped at compile time */                         \
+        } else if ((level) == LOG_TRACE || g_trace_all) {          \
             _logger_log_helper(level, "[%s:%d] " fmt, __FILE__, __LINE__, __VA_ARGS__); \
         } else {                                                   \
             _logger_log_helper(level, fmt, __VA_ARGS__);           \
@@ -66,9 +84,110 @@ void _logger_log(LogLevel level, const char* format, ...);
  * file/line info.
  */
 #define logger_log(level, fmt, ...) \
-        _logger_log(level, fmt, ##__VA_ARGS__)
+    do { \
+        if (LOG_COMPILED_IN(level)) \
+            _logger_log(level, fmt, ##__VA_ARGS__); \
+    } while (0)
 #endif
 
+/**
+ * @brief Logs a fixed message with typed fields; see log_fields.h.
+ * @param level The log level.
+ * @param message The message, not a format.
+ * @param fields The fields.
+ * @param count How many there are.
+ */
+void _logger_log_fields(LogLevel level, const char* message, const LogField_T* fields, size_t count);
+
+/*
+ * Structured logging: a fixed message and fields built with LOG_KV_INT,
+ * LOG_KV_UINT, LOG_KV_DOUBLE, LOG_KV_BOOL and LOG_KV_STR. Text sinks show the
+ * fields as " key=value" after the message, JSON sinks as members.
+ */
+#define logger_log_kv(level, message, ...) \
+    do { \
+        if (LOG_COMPILED_IN(level)) { \
+            const LogField_T log_fields_[] = { __VA_ARGS__ }; \
+            _logger_log_fields((level), (message), log_fields_, sizeof(log_fields_) / sizeof(log_fields_[0])); \
+        } \
+    } while (0)
+
+/**
+ * @brief Logs a message followed by a hex dump of binary data; see log_blob.h.
+ * @param level The log level.
+ * @param data The bytes, copied before the call returns.
+ * @param length How many there are.
+ * @param row_start Position in the dump's first row of the first byte, so a
+ * stream logged in pieces lines up from one call to the next; 0 for most.
+ * @param format The format string for the message.
+ * @param ... The arguments for the format string.
+ */
+void _logger_log_hex(LogLevel level, const void* data, size_t length, size_t row_start, const char* format, ...);
+
+/*
+ * The message, then the bytes as rows of hex, see log_hex.h. The caller pays
+ * for one copy of the bytes and one entry; the logger thread renders the rows.
+ */
+#define logger_log_hex(level, data, length, row_start, fmt, ...) \
+    do { \
+        if (LOG_COMPILED_IN(level)) \
+            _logger_log_hex((level), (data), (length), (row_start), fmt, ##__VA_ARGS__); \
+    } while (0)
+
+/**
+ * @brief State of one logger_log_every_ms call site.
+ */
+typedef struct LogRateLimit_T {
+    PlatformAtomic64_T next_due;   // Timestamp ticks at which the site may log again
+    PlatformAtomic64_T suppressed; // Calls skipped since it last logged
+} LogRateLimit_T;
+
+/**
+ * @brief Decides whether a rate limited call site may log now.
+ * @param limit The call site's state.
+ * @param interval_ms The least time between messages.
+ * @return -1 to skip the message, otherwise the number skipped since the last one.
+ */
+int64_t logger_rate_limit(LogRateLimit_T *limit, int interval_ms);
+
+/*
+ * Rate limited logging for lines in loops. Each expansion has its own state,
+ * shared by every thread passing through that call site:
+ *   logger_log_every_n  - the 1st, (n+1)th, (2n+1)th... call
+ *   logger_log_every_ms - at most one call per interval, noting how many were skipped
+ *   logger_log_once     - the first call only
+ * An n of 1 or less, like an interval_ms of 0 or less, lets every call through.
+ */
+#define logger_log_every_n(n, level, fmt, ...) \
+    do { \
+        static PlatformAtomic64_T log_every_n_calls_ = 0; \
+        if (LOG_COMPILED_IN(level) && \
+            ((n) <= 1 || platform_atomic_fetch_add_64(&log_every_n_calls_, 1) % (n) == 0)) \
+            logger_log(level, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#define logger_log_every_ms(interval_ms, level, fmt, ...) \
+    do { \
+        static LogRateLimit_T log_rate_limit_ = { 0, 0 }; \
+        int64_t log_skipped_; \
+        if (LOG_COMPILED_IN(level) && \
+            (log_skipped_ = logger_rate_limit(&log_rate_limit_, (interval_ms))) >= 0) { \
+            if (log_skipped_ == 0) \
+                logger_log(level, fmt, ##__VA_ARGS__); \
+            else \
+                logger_log(level, fmt " (%lld more like this skipped)", ##__VA_ARGS__, (long long)log_skipped_); \
+        } \
+    } while (0)
+
+#define logger_log_once(level, fmt, ...) \
+    do { \
+        static PlatformAtomic64_T log_once_done_ = 0; \
+        if (LOG_COMPILED_IN(level) && \
+            platform_atomic_load_relaxed_64(&log_once_done_) == 0 && \
+            platform_atomic_exchange_64(&log_once_done_, 1) == 0) \
+            logger_log(level, fmt, ##__VA_ARGS__); \
+    } while (0)
+
 /**
  * @enum LogOutput
  * @brief Defines the possible output destinations for logs.
@@ -81,16 +200,28 @@ typedef enum LogOutput {
 
 /**
  * @brief Structure representing a log entry.
+ *
+ * Entries carry no index; it is assigned when the entry is published so that
+ * producers do not share a counter, and so the index follows output order.
  */
 
 typedef struct LogEntry_T {
-    uint64_t index;
     LogLevel level;
     LARGE_INTEGER timestamp; // Use LARGE_INTEGER for high-resolution timestamp
-    char message[LOG_MSG_BUFFER_SIZE];
-    char thread_label[THREAD_LABEL_SIZE]; // Add thread label field
+    uint16_t label_id;       // Interned thread label, see log_label.h
+    uint16_t fields_length;  // Bytes of packed fields after the message terminator, see log_fields.h
+    uint32_t blob;           // Slot holding bytes to dump after the message, 0 for none, see log_blob.h
+    const char *format;      // Set when formatting is deferred, see log_format.h
+    uint32_t message_length; // Bytes in message, excluding the terminator
+    char message[LOG_MSG_BUFFER_SIZE]; // Must stay last, queues store only the used part
 } LogEntry_T;
 
+/* Bytes of an entry actually in use, i.e. up to and including the message terminator and any fields. */
+#define LOG_ENTRY_SIZE(entry) (offsetof(LogEntry_T, message) + (entry)->message_length + 1 + (entry)->fields_length)
+
+/* Start of an entry's packed fields. */
+#define LOG_ENTRY_FIELDS(entry) ((entry)->message + (entry)->message_length + 1)
+
 /**
  * @brief Initialises the logger.
  */
@@ -115,11 +246,75 @@ void set_thread_log_file_from_config(const char *thread_name);
  */
 const char* log_level_to_string(LogLevel level);
 
+/**
+ * @brief Reads a log level name, in any case.
+ *
+ * @param level_str The name, or NULL.
+ * @param default_level Returned if @p level_str is not a level.
+ * @return The log level.
+ */
+LogLevel log_level_from_string(const char* level_str, LogLevel default_level);
+
 /**
  * @brief Logs a message now to file and console, avoiding the queue.
  */
 void log_now(const LogEntry_T *entry);
 
+/**
+ * @brief Writes out buffered log output if the configured flush interval has passed.
+ * Called by the logger thread each time it has drained the queues.
+ * @return Milliseconds until buffered output falls due, or -1 if nothing is buffered,
+ *         so the logger knows how long it may sleep.
+ */
+int logger_flush_if_due(void);
+
+/**
+ * @brief Marks the calling thread as the logger thread, which drains the
+ * queues. Its own entries are never held back by the overflow policy.
+ */
+void logger_set_as_logger_thread(void);
+
+/**
+ * @brief Logs how many entries the overflow policy has dropped, per level,
+ * since the last report. Logger thread only.
+ * @param now Report straight away rather than waiting for overflow_report_ms to pass.
+ */
+void logger_report_dropped(bool now);
+
+/**
+ * @brief Publishes the counts of repeated messages that have been held back
+ * for repeat_report_ms, when collapse_repeats is on. Called by the logger
+ * thread, and by logger_close for whatever is left.
+ * @param now Publish every count held, however recent.
+ */
+void logger_report_repeats(bool now);
+
+/**
+ * @brief Counts the entries dropped because the log queues were full, at every level, since init.
+ * Safe to call from any thread.
+ * @return The count.
+ */
+uint64_t logger_get_dropped(void);
+
+/**
+ * @brief Logs the logger's own counters: queue depths and high water marks,
+ * overflow and drops, enqueue latency and publish lag percentiles, and the
+ * entries and bytes written to each sink. See log_metrics.h.
+ * @param direct Publish the report straight to the sinks rather than queue it,
+ * for when the logger thread is no longer draining.
+ */
+void logger_report_metrics(bool direct);
+
+/**
+ * @brief Writes the lines held in the in-memory ring, oldest first, to a file
+ * in the log directory.
+ * @param file_name The file's bare name, replaced if it exists; names with a
+ * path separator, a drive colon or ".." are refused.
+ * @return false if the name was refused, there is no ring (ring_bytes is not
+ * set) or the file could not be written.
+ */
+bool logger_dump_ring(const char *file_name);
+
 /**
  * @brief Closes the logger and releases any resources.
  */
@@ -0,0 +1,119 @@
+/**
+* @file platform_aio.h
+* @brief Platform-specific asynchronous file writes.
+*
+* On Linux this is an io_uring, driven through the raw system calls so there
+* is nothing extra to link: writes are queued in the shared submission ring and
+* any number of them, to any number of files, go to the kernel in one
+* io_uring_enter. Elsewhere platform_aio_init fails and callers keep to
+* ordinary writes.
+*
+* Writes are positioned, so those in flight together may complete in any order.
+*/
+#ifndef PLATFORM_AIO_H
+#define PLATFORM_AIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Called for each completed write.
+ * @param context The context given to platform_aio_write.
+ * @param result Bytes written, or a negative error.
+ */
+typedef void (*PlatformAioDone_T)(void *context, long result);
+
+/**
+ * @brief An asynchronous write queue. Only one thread may use it.
+ */
+typedef struct PlatformAio_T {
+    int ring_fd;            // -1 when not set up
+    unsigned entries;
+    unsigned queued;        // Written to the ring, not yet submitted
+    unsigned in_flight;     // Submitted, not yet reaped
+    void *sq_ring;          // The rings and submission entries, shared with the kernel
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    void *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail;
+    unsigned *sq_head;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    void *cqes;
+} PlatformAio_T;
+
+/**
+ * @brief Sets up a queue.
+ * @param aio The queue.
+ * @param entries Writes that can be queued at once, a power of two.
+ * @return 0 on success, non-zero if asynchronous writes are not available.
+ */
+int platform_aio_init(PlatformAio_T *aio, unsigned entries);
+
+/**
+ * @brief Gets the descriptor to write an open file through, making sure
+ * positioned writes land where they are aimed (append mode would ignore them).
+ * @param file The file.
+ * @return The descriptor, or -1 on failure.
+ */
+int platform_aio_file(FILE *file);
+
+/**
+ * @brief Queues a write, without submitting it. If the queue is full, what is
+ * already queued is submitted first.
+ * @param aio The queue.
+ * @param fd The descriptor from platform_aio_file.
+ * @param data The bytes, which must stay put until the write completes.
+ * @param length Number of bytes.
+ * @param offset Where in the file they go.
+ * @param context Handed to the completion callback.
+ * @return true if queued.
+ */
+bool platform_aio_write(PlatformAio_T *aio, int fd, const void *data, size_t length, uint64_t offset, void *context);
+
+/**
+ * @brief Submits everything queued in one call.
+ * @param aio The queue.
+ * @param wait_for Completions to wait for before returning, 0 not to wait.
+ * @return 0 on success, non-zero on failure.
+ */
+int platform_aio_submit(PlatformAio_T *aio, unsigned wait_for);
+
+/**
+ * @brief Hands every completed write to @p done. Never waits.
+ * @param aio The queue.
+ * @param done The callback.
+ * @return The number of completions handled.
+ */
+unsigned platform_aio_reap(PlatformAio_T *aio, PlatformAioDone_T done);
+
+/**
+ * @brief Writes at a position straight away, for when a write cannot be queued
+ * or completed short.
+ * @return Bytes written, or -1 on failure.
+ */
+long platform_aio_write_now(int fd, const void *data, size_t length, uint64_t offset);
+
+/**
+ * @brief Tears down a queue. Anything still in flight is waited for first.
+ * @param aio The queue.
+ * @param done Called for those last completions.
+ */
+void platform_aio_close(PlatformAio_T *aio, PlatformAioDone_T done);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // PLATFORM_AIO_H
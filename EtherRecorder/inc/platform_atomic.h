@@ -0,0 +1,179 @@
+/**
+* @file platform_atomic.h
+* @brief Platform-specific atomic operations.
+*
+* MSVC in C mode does not provide <stdatomic.h> without experimental flags, so on
+* Windows the operations map onto the Interlocked family (full barriers, which are
+* at least as strong as the acquire/release ordering requested). Everywhere else
+* the C11 atomics are used with explicit memory orders.
+*/
+#ifndef PLATFORM_ATOMIC_H
+#define PLATFORM_ATOMIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else // !_WIN32
+    #include <stdatomic.h>
+#endif // _WIN32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size used to pad hot shared counters onto their own cache line. */
+#define PLATFORM_CACHE_LINE_SIZE 64
+
+#ifdef _WIN32
+typedef volatile LONG64 PlatformAtomic64_T;
+#else // !_WIN32
+typedef _Atomic int64_t PlatformAtomic64_T;
+#endif // _WIN32
+
+/**
+ * @brief Initialises an atomic without any ordering guarantees.
+ * @param atomic The atomic to initialise.
+ * @param value The initial value.
+ */
+static inline void platform_atomic_init_64(PlatformAtomic64_T* atomic, int64_t value) {
+#ifdef _WIN32
+    *atomic = value;
+#else
+    atomic_init(atomic, value);
+#endif
+}
+
+/**
+ * @brief Loads an atomic with acquire ordering.
+ * @param atomic The atomic to read.
+ * @return The current value.
+ */
+static inline int64_t platform_atomic_load_64(PlatformAtomic64_T* atomic) {
+#ifdef _WIN32
+    return InterlockedCompareExchange64(atomic, 0, 0);
+#else
+    return atomic_load_explicit(atomic, memory_order_acquire);
+#endif
+}
+
+/**
+ * @brief Loads an atomic without ordering. Only for values the caller itself
+ * writes, or ones where a slightly stale value does no harm, such as a log level.
+ * @param atomic The atomic to read.
+ * @return The current value.
+ */
+static inline int64_t platform_atomic_load_relaxed_64(PlatformAtomic64_T* atomic) {
+#ifdef _WIN32
+    return *atomic; // An aligned 64-bit read cannot tear
+#else
+    return atomic_load_explicit(atomic, memory_order_relaxed);
+#endif
+}
+
+/**
+ * @brief Loads an atomic with full ordering: it cannot be satisfied before a
+ * platform_atomic_exchange_64 ahead of it, so the pair needs no fence between them.
+ * @param atomic The atomic to read.
+ * @return The current value.
+ */
+static inline int64_t platform_atomic_load_seq_cst_64(PlatformAtomic64_T* atomic) {
+#ifdef _WIN32
+    return *atomic; // The Interlocked exchange ahead of it is already a full barrier
+#else
+    return atomic_load_explicit(atomic, memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief Stores to an atomic with release ordering.
+ * @param atomic The atomic to write.
+ * @param value The value to store.
+ */
+static inline void platform_atomic_store_64(PlatformAtomic64_T* atomic, int64_t value) {
+#ifdef _WIN32
+    InterlockedExchange64(atomic, value);
+#else
+    atomic_store_explicit(atomic, value, memory_order_release);
+#endif
+}
+
+/**
+ * @brief Compare-and-swap with acquire/release ordering.
+ * @param atomic The atomic to update.
+ * @param expected In: the value expected. Out: the value observed on failure.
+ * @param desired The value to store if @p atomic equals @p expected.
+ * @return true if the swap took place.
+ */
+static inline bool platform_atomic_cas_64(PlatformAtomic64_T* atomic, int64_t* expected, int64_t desired) {
+#ifdef _WIN32
+    LONG64 observed = InterlockedCompareExchange64(atomic, desired, *expected);
+    if (observed == *expected) {
+        return true;
+    }
+    *expected = observed;
+    return false;
+#else
+    return atomic_compare_exchange_weak_explicit(atomic, expected, desired,
+                                                 memory_order_acq_rel, memory_order_acquire);
+#endif
+}
+
+/**
+ * @brief Atomically adds to an atomic.
+ * @param atomic The atomic to update.
+ * @param value The amount to add.
+ * @return The value held before the addition.
+ */
+static inline int64_t platform_atomic_fetch_add_64(PlatformAtomic64_T* atomic, int64_t value) {
+#ifdef _WIN32
+    return InterlockedExchangeAdd64(atomic, value);
+#else
+    return atomic_fetch_add_explicit(atomic, value, memory_order_acq_rel);
+#endif
+}
+
+/**
+ * @brief Atomically replaces the value of an atomic, with full ordering.
+ * @param atomic The atomic to update.
+ * @param value The value to store.
+ * @return The value held before.
+ */
+static inline int64_t platform_atomic_exchange_64(PlatformAtomic64_T* atomic, int64_t value) {
+#ifdef _WIN32
+    return InterlockedExchange64(atomic, value);
+#else
+    return atomic_exchange_explicit(atomic, value, memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief Full memory fence: no load after it can be satisfied before a store ahead of it.
+ */
+static inline void platform_atomic_fence(void) {
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    atomic_thread_fence(memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief Hints to the processor that the caller is spinning.
+ */
+static inline void platform_cpu_relax(void) {
+#if defined(_WIN32)
+    YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // PLATFORM_ATOMIC_H
@@ -0,0 +1,85 @@
+/**
+* @file platform_mmap.h
+* @brief Platform-specific memory mapping of open files.
+*
+* A file is grown to its full size up front and mapped shared, so writing to it
+* is a copy into memory. The pages belong to the operating system's file cache,
+* so what has been copied survives the process dying; syncing only decides when
+* it reaches the disk.
+*/
+#ifndef PLATFORM_MMAP_H
+#define PLATFORM_MMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif // _WIN32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A mapped file.
+ */
+typedef struct PlatformFileMap_T {
+    unsigned char *address; // NULL when nothing is mapped
+    size_t size;
+    FILE *file;             // Stays open, and owned by the caller
+#ifdef _WIN32
+    HANDLE mapping;
+#endif // _WIN32
+} PlatformFileMap_T;
+
+/**
+ * @brief Preallocates a file to @p size bytes and maps all of it for writing.
+ * @param map Receives the mapping.
+ * @param file The file, opened for both reading and writing.
+ * @param size Bytes to allocate and map. A larger file is mapped whole.
+ * @return 0 on success, non-zero on failure.
+ */
+int platform_file_map(PlatformFileMap_T *map, FILE *file, size_t size);
+
+/**
+ * @brief Starts writing part of the mapping back to the file without waiting
+ * for it, optionally letting go of the pages afterwards.
+ * @param map The mapping.
+ * @param offset Start of the range; rounded down to a page.
+ * @param length Bytes in the range.
+ * @param release true if the range will not be touched again, so its memory can be reclaimed.
+ * @return 0 on success, non-zero on failure.
+ */
+int platform_file_map_sync(PlatformFileMap_T *map, size_t offset, size_t length, bool release);
+
+/**
+ * @brief Unmaps the file and cuts it back to the bytes actually written.
+ * @param map The mapping.
+ * @param length Bytes to keep.
+ * @return 0 on success, non-zero on failure.
+ */
+int platform_file_unmap(PlatformFileMap_T *map, size_t length);
+
+/**
+ * @brief Locks a whole file for this process alone, without waiting. The lock
+ * is held until the file is closed or the process exits, crash or not.
+ * @param file The file, open for reading or writing.
+ * @return true if locked; false if another process holds the lock.
+ */
+bool platform_file_lock(FILE *file);
+
+/**
+ * @brief Cuts a file, or extends it with zeros, to @p length bytes.
+ * @param file The file, open for writing.
+ * @param length Its new size.
+ * @return 0 on success, non-zero on failure.
+ */
+int platform_file_truncate(FILE *file, size_t length);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // PLATFORM_MMAP_H
@@ -23,6 +23,10 @@ extern "C" {
 #define PLATFORM_COND_STORAGE_SIZE 64
 #endif
 
+#ifndef PLATFORM_EVENT_STORAGE_SIZE
+#define PLATFORM_EVENT_STORAGE_SIZE 128
+#endif
+
 /**
 * @brief Opaque type for a mutex.
 *
@@ -41,6 +45,16 @@ typedef struct PlatformCondition {
     unsigned char opaque[PLATFORM_COND_STORAGE_SIZE];
 } PlatformCondition_T;
 
+/**
+* @brief Opaque type for an auto-reset event.
+*
+* Signalling wakes one waiter, or the next one to wait if none is waiting;
+* either way the event is then clear again.
+*/
+typedef struct PlatformEvent {
+    unsigned char opaque[PLATFORM_EVENT_STORAGE_SIZE];
+} PlatformEvent_T;
+
 /**
 * @brief Initialises the given mutex.
 *
@@ -106,6 +120,39 @@ int platform_cond_signal(PlatformCondition_T* cond);
 */
 int platform_cond_destroy(PlatformCondition_T* cond);
 
+/**
+* @brief Initialises the given event, clear.
+*
+* @param event Pointer to a PlatformEvent_T variable.
+* @return int 0 on success, -1 on failure.
+*/
+int platform_event_init(PlatformEvent_T* event);
+
+/**
+* @brief Signals the given event.
+*
+* @param event Pointer to the event.
+* @return int 0 on success, -1 on failure.
+*/
+int platform_event_signal(PlatformEvent_T* event);
+
+/**
+* @brief Waits for the given event to be signalled, clearing it.
+*
+* @param event Pointer to the event.
+* @param timeout_ms The longest to wait, in milliseconds.
+* @return int 0 if signalled, 1 on timeout, -1 on failure.
+*/
+int platform_event_wait(PlatformEvent_T* event, unsigned int timeout_ms);
+
+/**
+* @brief Destroys the given event.
+*
+* @param event Pointer to the event.
+* @return int 0 on success, -1 on failure.
+*/
+int platform_event_destroy(PlatformEvent_T* event);
+
 #ifdef __cplusplus
 }
 #endif
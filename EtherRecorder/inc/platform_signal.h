@@ -0,0 +1,86 @@
+/**
+* @file platform_signal.h
+* @brief Platform-specific handling of fatal signals and exceptions.
+*
+* The handler runs on the thread that faulted, with the process in whatever
+* state the fault left it, so it may only use what is safe in a signal
+* handler: the raw descriptor functions below, and memory it already holds.
+* Once it returns, the signal takes its default course and the process ends.
+*/
+#ifndef PLATFORM_SIGNAL_H
+#define PLATFORM_SIGNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Called once on a fatal signal.
+ * @param signal The signal number, or on Windows the exception code.
+ */
+typedef void (*PlatformFatalHandler_T)(int signal);
+
+/**
+ * @brief Installs a handler for crashes: SIGSEGV, SIGBUS, SIGILL, SIGFPE and
+ * SIGABRT, or on Windows unhandled exceptions and abort(). It covers every
+ * thread, but a stack overflow only reaches it on a thread with stack set aside
+ * for it: the calling thread, and any that call platform_fatal_thread_init.
+ * @param handler The handler.
+ * @return true if it was installed.
+ */
+bool platform_fatal_handler_install(PlatformFatalHandler_T handler);
+
+/**
+ * @brief Sets aside stack for the handler on the calling thread, so that a
+ * stack overflow there still reaches it. Call at the start of each thread.
+ * @return true if it was set aside.
+ */
+bool platform_fatal_thread_init(void);
+
+/**
+ * @brief Gives back what platform_fatal_thread_init set aside. Call as the thread ends.
+ */
+void platform_fatal_thread_exit(void);
+
+/**
+ * @brief Creates or truncates a file for writing. Safe in the handler.
+ * @param name The file name.
+ * @return The descriptor, or -1.
+ */
+int platform_fatal_open(const char *name);
+
+/**
+ * @brief Writes all of a buffer, retrying short writes. Safe in the handler.
+ * @param fd The descriptor.
+ * @param data The bytes.
+ * @param length Their number.
+ * @return true if everything was written.
+ */
+bool platform_fatal_write(int fd, const void *data, size_t length);
+
+/**
+ * @brief Closes a descriptor. Safe in the handler.
+ * @param fd The descriptor.
+ */
+void platform_fatal_close(int fd);
+
+/**
+ * @brief Returns the descriptor under a stream without touching its lock.
+ * @param stream The stream.
+ */
+int platform_fatal_fileno(FILE *stream);
+
+/**
+ * @brief Returns the id of the running process.
+ */
+long platform_process_id(void);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // PLATFORM_SIGNAL_H
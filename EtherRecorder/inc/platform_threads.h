@@ -54,6 +54,14 @@ int platform_thread_create(PlatformThread_T *thread, ThreadFunc_T func, void *ar
  */
 int platform_thread_join(PlatformThread_T thread, void **retval);
 
+/**
+ * @brief Lowers the scheduling priority of the calling thread, for background
+ * work that must not compete with the threads it serves.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int platform_thread_set_low_priority(void);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -124,6 +124,22 @@ void strip_directory_path(const char* full_file_path, char* directory_path, size
  */
 int create_directories(const char* path);
 
+/**
+ * @brief Called by platform_list_directory for each file found.
+ * @param name The file name, without the directory.
+ * @param context The context passed to platform_list_directory.
+ */
+typedef void (*PlatformDirectoryFunc_T)(const char* name, void* context);
+
+/**
+ * @brief Lists the regular files in a directory.
+ * @param directory The directory, or "" for the current directory.
+ * @param callback Called for each file.
+ * @param context Passed to @p callback.
+ * @return 0 on success, -1 if the directory could not be read.
+ */
+int platform_list_directory(const char* directory, PlatformDirectoryFunc_T callback, void* context);
+
 /**
  * @brief Initialises the console (e.g. disables Quick Edit mode on Windows).
  */
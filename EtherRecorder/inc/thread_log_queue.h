@@ -0,0 +1,133 @@
+/**
+* @file thread_log_queue.h
+* @brief Per-thread single-producer, single-consumer log queues.
+*
+* Every thread that sets a label gets its own wait-free ring, so producers never
+* share a cache line with each other. The rings hold variable-length records:
+* a producer reserves room for a full entry, formats straight into it and
+* commits only the bytes the message used. The logger thread drains all of them
+* in place, together with the shared log queue, merging on timestamp so the
+* output stays in order.
+*/
+#ifndef THREAD_LOG_QUEUE_H
+#define THREAD_LOG_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "logger.h"
+#include "log_queue.h"
+#include "log_spill.h"
+#include "platform_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_THREAD_LOG_QUEUES 32      // Maximum number of concurrently attached threads
+#define THREAD_LOG_QUEUE_BYTES (256 * 1024) // Ring size per thread, must be a power of two
+#define THREAD_LOG_QUEUE_MASK (THREAD_LOG_QUEUE_BYTES - 1)
+
+/**
+ * @brief Called by the merge for each entry, in timestamp order.
+ * @param entry The entry to publish.
+ */
+typedef void (*LogPublishFunc_T)(const LogEntry_T *entry);
+
+/**
+ * @brief Gives the calling thread its own log queue, if it does not have one already.
+ * @return true if the thread has a queue, false if none could be allocated.
+ */
+bool thread_log_queue_attach(void);
+
+/**
+ * @brief Releases the calling thread's log queue once the logger has drained it.
+ */
+void thread_log_queue_detach(void);
+
+/**
+ * @brief Reserves room for a full-length entry in the calling thread's own queue. Wait-free.
+ *
+ * The caller fills in the entry, including message_length, then calls
+ * thread_log_queue_commit. Nothing is visible to the logger until then.
+ *
+ * @return The entry to fill in, or NULL if the thread has no queue or it is full.
+ */
+LogEntry_T *thread_log_queue_reserve(void);
+
+/**
+ * @brief Publishes the entry returned by thread_log_queue_reserve, keeping only
+ * the bytes up to its message terminator, and wakes the logger if it is parked.
+ * @param entry The reserved entry.
+ */
+void thread_log_queue_commit(LogEntry_T *entry);
+
+/**
+ * @brief Checks whether the calling thread still has entries it spilled to the
+ * shared queue waiting to be published.
+ *
+ * Until they are, the thread must keep using the shared queue so its entries
+ * are published in the order they were logged.
+ *
+ * @param shared_queue The shared log queue.
+ * @return true if the thread must keep spilling.
+ */
+bool thread_log_queue_spilling(LogQueue_T *shared_queue);
+
+/**
+ * @brief Records that the calling thread has just pushed an entry to the shared queue.
+ * @param shared_queue The shared log queue.
+ */
+void thread_log_queue_spilled(LogQueue_T *shared_queue);
+
+/**
+ * @brief Wakes the logger thread if it is parked. Called after publishing an entry
+ * anywhere but the thread's own queue, whose commit wakes the logger itself.
+ */
+void thread_log_queue_ring(void);
+
+/**
+ * @brief Parks the logger thread until a producer publishes something or the
+ * timeout passes. Returns straight away if anything is already waiting.
+ * Logger thread only.
+ *
+ * @param shared_queue The shared log queue, which is checked as well.
+ * @param spill The overflow buffer, checked as well, or NULL.
+ * @param timeout_ms The longest to park for.
+ */
+void thread_log_queue_wait(LogQueue_T *shared_queue, LogSpill_T *spill, unsigned int timeout_ms);
+
+/**
+ * @brief Drains the per-thread queues, @p shared_queue and @p spill in timestamp order.
+ *
+ * Only entries already visible when the call starts are merged, so it returns
+ * even while producers keep logging. Logger thread only.
+ *
+ * @param shared_queue The multi-producer queue used by threads without their own queue.
+ * @param spill The overflow buffer, or NULL.
+ * @param publish Called for each entry.
+ * @return The number of entries published.
+ */
+size_t thread_log_queue_drain(LogQueue_T *shared_queue, LogSpill_T *spill, LogPublishFunc_T publish);
+
+/**
+ * @brief Calls @p visit for every entry still waiting in the per-thread queues,
+ * @p shared_queue and @p spill, in timestamp order, without removing any.
+ *
+ * For a fatal signal handler: it takes no lock and allocates nothing, and the
+ * logger thread may be draining at the same time, so an entry it was
+ * publishing as the process died may be visited as well. Entries a producer
+ * had not finished are skipped.
+ *
+ * @param shared_queue The multi-producer queue used by threads without their own queue.
+ * @param spill The overflow buffer, or NULL.
+ * @param visit Called for each entry.
+ * @return The number of entries visited.
+ */
+size_t thread_log_queue_walk(LogQueue_T *shared_queue, LogSpill_T *spill, LogPublishFunc_T visit);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // THREAD_LOG_QUEUE_H
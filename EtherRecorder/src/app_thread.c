@@ -5,8 +5,14 @@
 #include <stdio.h>
 
 #include "platform_utils.h"
+#include "platform_atomic.h"
 #include "platform_threads.h"
+#include "platform_signal.h"
+#include "log_compress.h"
+#include "log_label.h"
+#include "log_level.h"
 #include "log_queue.h"
+#include "thread_log_queue.h"
 #include "logger.h"
 #include "client_manager.h"
 #include "server_manager.h"
@@ -18,7 +24,12 @@ extern bool shutdown_signalled(void);
 
 #define NUM_THREADS (sizeof(all_threads) / sizeof(all_threads[0]))
 
+#define LOGGER_SPIN_MIN      64    // Polls before parking when logging is sparse
+#define LOGGER_SPIN_MAX      4096  // Polls before parking during a sustained burst
+#define LOGGER_IDLE_WAIT_MS  1000  // Longest park when nothing is buffered
+
 THREAD_LOCAL static const char *thread_label = NULL;
+THREAD_LOCAL static uint16_t thread_label_id = LOG_LABEL_UNKNOWN;
 
 extern AppThreadArgs_T send_thread_args;
 extern AppThreadArgs_T receive_thread_args;
@@ -35,16 +46,27 @@ typedef enum WaitResult {
 } WaitResult;
 
 void* app_thread(AppThreadArgs_T* thread_args) {
+    // So that a stack overflow on this thread still reaches the crash handler
+    platform_fatal_thread_init();
+
+    bool initialised = true;
     if (thread_args->init_func) {
         if ((WaitResult)thread_args->init_func(thread_args) != APP_WAIT_SUCCESS) {
             printf("[%s] Initialisation failed, exiting thread\n", thread_args->label);
-            return NULL;
+            initialised = false;
         }
     }
-    thread_args->func(thread_args);
-    if (thread_args->exit_func)
-        thread_args->exit_func(thread_args);
-    
+    if (initialised) {
+        thread_args->func(thread_args);
+        if (thread_args->exit_func)
+            thread_args->exit_func(thread_args);
+    }
+
+    // On every path, as a failed init may already have set the label. Anything
+    // still queued is published by the logger before the queue is reused.
+    thread_log_queue_detach();
+    log_level_unregister_thread();
+    platform_fatal_thread_exit();
     return NULL;
 }
 
@@ -59,12 +81,21 @@ void create_app_thread(AppThreadArgs_T *thread) {
 
 void set_thread_label(const char *label) {
     thread_label = label;
+    thread_label_id = log_label_intern(label);
+    // The thread's level follows its label from now on
+    log_level_register_thread(thread_label_id);
+    // A labelled thread logs through its own queue from now on
+    thread_log_queue_attach();
 }
 
 const char* get_thread_label() {
     return thread_label;
 }
 
+uint16_t get_thread_label_id(void) {
+    return thread_label_id;
+}
+
 void wait_for_all_other_threads_to_complete(void);
 
 void* pre_create_stub(void* arg) {
@@ -151,9 +182,57 @@ void* init_wait_for_logger(void* arg) {
     return (void*)APP_WAIT_SUCCESS;
 }
 
+/**
+ * @brief Publishes everything currently in the log queues, oldest first. Logger thread only.
+ * @return The number of entries published.
+ */
+static size_t drain_log_queue(void) {
+    size_t total = 0;
+    size_t published;
+    while ((published = thread_log_queue_drain(&global_log_queue, &global_log_spill, log_now)) > 0) {
+        total += published;
+    }
+    return total;
+}
+
+/**
+ * @brief Logs the log queue totals and rates since the logger thread started.
+ * @param started Timestamp taken when the logger thread started.
+ */
+static void report_log_queue_throughput(const LARGE_INTEGER* started) {
+    LogQueueStats_T stats;
+    LARGE_INTEGER now, frequency;
+    log_queue_get_stats(&global_log_queue, &stats);
+    get_high_resolution_timestamp(&now);
+    QueryPerformanceFrequency(&frequency);
+
+    double seconds = (double)(now.QuadPart - started->QuadPart) / (double)frequency.QuadPart;
+    if (seconds <= 0.0) {
+        seconds = 1.0;
+    }
+    logger_log(LOG_INFO, "Log queue: %llu enqueued (%.0f/s), %llu dequeued (%.0f/s), %llu rejected when full",
+        (unsigned long long)stats.enqueued, stats.enqueued / seconds,
+        (unsigned long long)stats.dequeued, stats.dequeued / seconds,
+        (unsigned long long)stats.full_count);
+
+    LogCompressStats_T compress_stats;
+    log_compress_get_stats(&compress_stats);
+    if (compress_stats.segments || compress_stats.backlog || compress_stats.skipped) {
+        double ratio = compress_stats.compressed_bytes ?
+            (double)compress_stats.raw_bytes / (double)compress_stats.compressed_bytes : 0.0;
+        logger_log(LOG_INFO, "Log compression: %llu segments, %llu bytes to %llu (%.1f:1), %llu in the backlog, %llu skipped",
+            (unsigned long long)compress_stats.segments,
+            (unsigned long long)compress_stats.raw_bytes,
+            (unsigned long long)compress_stats.compressed_bytes, ratio,
+            (unsigned long long)compress_stats.backlog,
+            (unsigned long long)compress_stats.skipped);
+    }
+}
+
 void* logger_thread_function(void* arg) {
     AppThreadArgs_T* thread_info = (AppThreadArgs_T*)arg;
     set_thread_label(thread_info->label);
+    logger_set_as_logger_thread();
     logger_log(LOG_INFO, "Logger thread started");
 
     EnterCriticalSection(&logger_thread_mutex_in_app_thread);
@@ -161,26 +240,52 @@ void* logger_thread_function(void* arg) {
     WakeAllConditionVariable(&logger_thread_condition);
     LeaveCriticalSection(&logger_thread_mutex_in_app_thread);
 
-    LogEntry_T entry;
-    bool running = true;
+    LARGE_INTEGER started;
+    get_high_resolution_timestamp(&started);
 
-    while (running) {
-        while (log_queue_pop(&global_log_queue, &entry)) {
-            if (*entry.thread_label == '\0')
-                printf("Logger thread processing log from: NULL\n");
-            log_now(&entry);
-        }
+    unsigned int spin_limit = LOGGER_SPIN_MIN;
 
-        sleep_ms(1);
+    for (;;) {
+        drain_log_queue();
+        logger_report_dropped(false);
+        logger_report_repeats(false);
+        int due_ms = logger_flush_if_due();
 
         if (shutdown_signalled()) {
-            running = false;
+            break;
+        }
+
+        // Poll briefly in case a burst is under way, then park until a producer rings.
+        // The spin adapts: longer while entries keep arriving mid-spin, shorter when they don't.
+        bool found = false;
+        for (unsigned int spin = 0; spin < spin_limit; spin++) {
+            platform_cpu_relax();
+            if (drain_log_queue() > 0) {
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            if (spin_limit < LOGGER_SPIN_MAX) {
+                spin_limit *= 2;
+            }
+            continue;
         }
+        if (spin_limit > LOGGER_SPIN_MIN) {
+            spin_limit /= 2;
+        }
+
+        thread_log_queue_wait(&global_log_queue, &global_log_spill, due_ms >= 0 ? (unsigned int)due_ms : LOGGER_IDLE_WAIT_MS);
     }
 
     wait_for_all_other_threads_to_complete();
-    
+
+    report_log_queue_throughput(&started);
+    drain_log_queue();
+    logger_report_dropped(true);
     logger_log(LOG_INFO, "Logger thread shutting down.");
+    drain_log_queue();
+    logger_report_repeats(true);
     return NULL;
 }
 
@@ -296,6 +401,10 @@ void wait_for_all_other_threads_to_complete(void)
         }
         threadHandles[j++] = all_threads[i]->thread_id;
     }
+    if (j == 0) {
+        drain_log_queue(); // Every other thread suppressed, as bench-logger runs it
+        return;
+    }
 
     DWORD waitResult = WaitForMultipleObjects(j, threadHandles, TRUE, INFINITE);
 
@@ -307,12 +416,7 @@ void wait_for_all_other_threads_to_complete(void)
         logger_log(LOG_INFO, "Logger has seen all other threads complete");
     }
 
-    LogEntry_T entry;
-    while (log_queue_pop(&global_log_queue, &entry)) {
-        if (*entry.thread_label == '\0')
-            printf("Logger thread processing log from: NULL\n");
-        log_now(&entry);
-    }
+    drain_log_queue();
 }
 
 void check_for_suppression(void) {
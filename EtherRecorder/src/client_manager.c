@@ -7,6 +7,7 @@
 #include "common_socket.h"
 #include "app_thread.h"
 #include "logger.h"
+#include "log_hex.h"
 #include "platform_utils.h"
 #include "app_config.h"
 
@@ -22,89 +23,27 @@ extern bool shutdown_signalled(void);
 #define BUFFER_SIZE               8192
 #define SOCKET_ERROR_BUFFER_SIZE  256
 #define BLOCKING_TIMEOUT_SEC 10  // Blocking timeout in seconds
+#define RECEIVE_LOG_EVERY_N 100     // Per-packet debug lines logged once in this many
+#define IDLE_LOG_INTERVAL_MS 60000  // Least time between repeated timeout lines
 
 static bool suppress_client_send_data = true;
 
-typedef struct {
-    int cols;   // Number of columns (each column holds 4 bytes)
-    int start;  // How many bytes (of the current row) have already been filled
-} config_t;
-
-/* Assume this config is read from a configuration file earlier. */
-static config_t config = { .cols = 4, .start = 0 };
-
-#define BLOCK_SIZE 4                      // Each column holds 4 bytes.
-#define BLOCK_CHAR_COUNT (BLOCK_SIZE * 2) // 4 bytes → 8 characters.
-#define COL_WIDTH (BLOCK_CHAR_COUNT + 1)  // Plus one space separator.
-
-/* 
- * Initializes the output row with the placeholder pattern.
- * Each byte is expected to be rendered as two characters, so we fill each
- * column with "........" (8 dots) followed by a space.
- */
-static void init_row(char *row, int cols) {
-    int total_chars = cols * COL_WIDTH;
-    for (int col = 0; col < cols; col++) {
-        int base = col * COL_WIDTH;
-        for (int i = 0; i < BLOCK_CHAR_COUNT; i++) {
-            row[base + i] = '.';
-        }
-        row[base + BLOCK_CHAR_COUNT] = ' ';  // trailing space for the column.
-    }
-    row[cols * COL_WIDTH] = '\0';
-}
+// Position in a hex dump row of the next byte received, so rows follow the stream across batches
+static size_t hex_row_start = 0;
 
 /*
- * For each call, we “profile” an output row – prefilled with dots – then overlay the new
- * bytes into their proper positions. The position in the row (in bytes) is determined by
- * config.start. When a row is complete, or when the new data is exhausted, we log the row.
- *
- * The mapping is as follows:
- *   Each row has a capacity of (config.cols * BLOCK_SIZE) bytes.
- *   For a byte to be placed at position 'pos' (0-based) within the row:
- *     - The column index is pos / BLOCK_SIZE.
- *     - The offset within that column is pos % BLOCK_SIZE.
- *     - The character position in the row is:
- *           col * COL_WIDTH + (offset * 2)
- *     (Each byte occupies two characters.)
+ * Logs a batch of received data: a line with its size, then the bytes as
+ * rows of hex, see log_hex.h. The bytes are copied once into the logger's
+ * hex dump slots and the rows are rendered by the logger thread, so a batch
+ * costs this thread one entry however large it is. Each row holds
+ * LOG_HEX_ROW_BYTES bytes; a batch that ends part way through a row leaves
+ * the next batch to start from where it stopped, with dots before.
  */
 static void log_buffered_data(uint8_t *buffer, int *buffered_length, int batch_bytes) {
-    int total = *buffered_length;
-    int index = 0;
-    int row_capacity = config.cols * BLOCK_SIZE;  // Number of bytes per output row.
-    const char hex_chars[] = "0123456789ABCDEF";
-    char row[256];  // Assume this is enough for our configured number of columns.
-    
-    logger_log(LOG_INFO, "%d bytes received: top", batch_bytes);
-    
-    /* Process the new bytes, possibly spanning multiple rows. */
-    while (index < total) {
-        init_row(row, config.cols);
-        int avail = row_capacity - config.start;      // How many bytes can we fill in this row.
-        int to_place = (total - index < avail) ? (total - index) : avail;
-        
-        /* Place new bytes into the profiled row. */
-        for (int i = 0; i < to_place; i++) {
-            int pos = config.start + i;  // Byte position within the row.
-            int col = pos / BLOCK_SIZE;
-            int offset = pos % BLOCK_SIZE;
-            int dest_index = col * COL_WIDTH + offset * 2;
-            uint8_t byte = buffer[index + i];
-            row[dest_index]     = hex_chars[byte >> 4];
-            row[dest_index + 1] = hex_chars[byte & 0x0F];
-        }
-        
-        config.start += to_place;
-        if (config.start >= row_capacity) {
-            config.start = 0;  // Start a fresh row on the next iteration.
-        }
-        index += to_place;
-        
-        logger_log(LOG_INFO, "%s", row);
-    }
-    
+    size_t total = (size_t)*buffered_length;
+    logger_log_hex(LOG_INFO, buffer, total, hex_row_start, "%d bytes received", batch_bytes);
+    hex_row_start = (hex_row_start + total) % LOG_HEX_ROW_BYTES;
     *buffered_length = 0;
-    logger_log(LOG_INFO, "%d bytes received: bottom", batch_bytes);
 }
 
 /**
@@ -183,7 +122,7 @@ static bool handle_data_reception(SOCKET sock, char* buffer, int* buffered_lengt
     if (buffer_available < 0) {
         logger_log(LOG_ERROR, "Buffer underflow detected! Available bytes: %d", buffer_available);
     } else {
-        logger_log(LOG_DEBUG, "buffer available =- %d", buffer_available);
+        logger_log_every_n(RECEIVE_LOG_EVERY_N, LOG_DEBUG, "buffer available =- %d", buffer_available);
     }
     int bytes = recv(sock, buffer + *buffered_length, BUFFER_SIZE - *buffered_length, 0);
     if (bytes <= 0) {
@@ -194,7 +133,7 @@ static bool handle_data_reception(SOCKET sock, char* buffer, int* buffered_lengt
     }
     *buffered_length += bytes;
     *batch_bytes += bytes;
-    logger_log(LOG_DEBUG, "Received %d bytes", bytes);
+    logger_log_every_n(RECEIVE_LOG_EVERY_N, LOG_DEBUG, "Received %d bytes", bytes);
     return true;
 }
 
@@ -264,7 +203,7 @@ void* client_receive_thread(void* arg) {
                 batch_bytes = 0;
             }
         } else if (ret == 0) {
-            logger_log(LOG_DEBUG, "Timeout: No data received within %d seconds", BLOCKING_TIMEOUT_SEC);
+            logger_log_every_ms(IDLE_LOG_INTERVAL_MS, LOG_DEBUG, "Timeout: No data received within %d seconds", BLOCKING_TIMEOUT_SEC);
         } else {
             logger_log(LOG_ERROR, "Select error in receive thread. Exiting loop.");
             break;
@@ -313,11 +252,11 @@ void* client_send_thread(void* arg) {
                 comm_args->connection_closed = true;
                 break;
             } else {
-                logger_log(LOG_INFO, "Periodic send: sent %d bytes", sent);
+                logger_log_kv(LOG_INFO, "Periodic send", LOG_KV_INT("bytes", sent));
             }
             sleep_ms(client_info->send_interval_ms);
         } else if (ret == 0) {
-            logger_log(LOG_DEBUG, "Timeout: No write availability within %d seconds", BLOCKING_TIMEOUT_SEC);
+            logger_log_every_ms(IDLE_LOG_INTERVAL_MS, LOG_DEBUG, "Timeout: No write availability within %d seconds", BLOCKING_TIMEOUT_SEC);
         } else {
             logger_log(LOG_ERROR, "Select error in send thread. Exiting loop.");
             break;
@@ -364,7 +303,8 @@ void* clientMainThread(void* arg) {
     client_info->send_interval_ms = get_config_int("network", "client.send_interval_ms", client_info->send_interval_ms);
     client_info->send_test_data = get_config_bool("network", "client.send_test_data", false);
     suppress_client_send_data = get_config_bool("debug", "suppress_client_send_data", false);
-    logger_log(LOG_INFO, "Client Manager will attempt to connect to Server: %s, port: %d", client_info->server_hostname, client_info->port);
+    logger_log_kv(LOG_INFO, "Client Manager will attempt to connect to server",
+        LOG_KV_STR("host", client_info->server_hostname), LOG_KV_INT("port", client_info->port));
 
     int port = client_info->port;
     bool is_tcp = client_info->is_tcp;
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 
 #include "logger.h"
+#include "log_level.h"
 #include "platform_utils.h"
 
 
@@ -91,6 +92,53 @@ static void process_log_level_command(const char* value)
     }
 }
 
+/**
+ * @brief Process a log level command for one thread label.
+ *
+ * Sets the label's own level, overriding the global one for its threads, or
+ * with "default" hands them back to the global level.
+ *
+ * @param label The thread label, as in log_level.CLIENT=debug.
+ * @param value The string representing the log level.
+ */
+static void process_label_log_level_command(const char* label, const char* value)
+{
+    if (str_cmp_nocase(value, "default") == 0) {
+        if (log_level_set_label(label, LOG_LEVEL_UNSET)) {
+            logger_log(LOG_INFO, "Log level for %s now follows the global level", label);
+        }
+        return;
+    }
+
+    size_t table_size = sizeof(log_level_table) / sizeof(log_level_table[0]);
+    for (size_t i = 0; i < table_size; i++) {
+        if (str_cmp_nocase(value, log_level_table[i].name) == 0) {
+            if (log_level_set_label(label, (int)log_level_table[i].level)) {
+                logger_log(LOG_INFO, "Log level for %s changed to %s", label, log_level_table[i].name);
+            } else {
+                logger_log(LOG_WARN, "Too many thread labels to set a log level for %s", label);
+            }
+            return;
+        }
+    }
+    logger_log(LOG_WARN, "Unknown log level: %s", value);
+}
+
+/**
+ * @brief Writes the logger's in-memory ring of recent lines to a file in the
+ * log directory.
+ *
+ * @param file_name The file's bare name, as in log_dump_ring=recent.log.
+ */
+static void process_dump_ring_command(const char* file_name)
+{
+    if (logger_dump_ring(file_name)) {
+        logger_log(LOG_INFO, "Recent log lines written to %s in the log directory", file_name);
+    } else {
+        logger_log(LOG_WARN, "Could not write recent log lines to %s (is it a bare file name, and is ring_bytes set?)", file_name);
+    }
+}
+
 /**
  * @brief Process a command string.
  *
@@ -99,7 +147,11 @@ static void process_log_level_command(const char* value)
  *
  *     "   log_level  =   debug  "
  *
- * will be correctly interpreted. Other commands TBD ...
+ * will be correctly interpreted. "log_level.<label> = <level>" sets the level for
+ * one thread label, "default" returning it to the global level. "log_stats" logs
+ * the logger's own counters. "log_dump_ring[=<file>]" writes the lines held by
+ * the ring sink to a file in the log directory, log_ring.log by default; it
+ * must be a bare file name. Other commands TBD ...
  *
  * @param command The command string.
  */
@@ -126,10 +178,32 @@ void process_command(const char* command)
             process_log_level_command(right);
             return;
         }
+
+        if (str_cmp_nocase(left, "log_dump_ring") == 0 && *right) {
+            process_dump_ring_command(right);
+            return;
+        }
+
+        /* log_level.<label> sets one label's level */
+        char* dot = strchr(left, '.');
+        if (dot != NULL) {
+            *dot = '\0';
+            if (str_cmp_nocase(left, "log_level") == 0 && dot[1] != '\0') {
+                process_label_log_level_command(trim_whitespace(dot + 1), right);
+                return;
+            }
+            *dot = '.';
+        }
     }
 
     /* Process other commands */
-    if (strcmp(trimmed, "SOME_COMMAND") == 0) {
+    if (str_cmp_nocase(trimmed, "log_stats") == 0) {
+        logger_report_metrics(false);
+    }
+    else if (str_cmp_nocase(trimmed, "log_dump_ring") == 0) {
+        process_dump_ring_command("log_ring.log");
+    }
+    else if (strcmp(trimmed, "SOME_COMMAND") == 0) {
         logger_log(LOG_INFO, "Processing SOME_COMMAND");
         /* Execute the specific action for SOME_COMMAND */
     }
@@ -251,6 +251,7 @@ PlatformSocketError connect_with_timeout(SOCKET sock, struct sockaddr_in *server
 
 // Define an arbitrary buffer size for TCP stream accumulation.
 #define BUFFER_SIZE   65536
+#define RECEIVE_LOG_EVERY_N 100 // Per-read debug lines logged once in this many
 
 // Dummy logger definitions.
 #define LOG_ERROR 1
@@ -346,7 +347,7 @@ int process_tcp_stream(SOCKET sock, void *out_buffer, int out_buffer_size) {
             logger_log(LOG_ERROR, "recv error or connection closed (received %d bytes)", bytes_received);
             return -1;
         }
-        logger_log(LOG_DEBUG, "Received %d bytes", bytes_received);
+        logger_log_every_n(RECEIVE_LOG_EVERY_N, LOG_DEBUG, "Received %d bytes", bytes_received);
         buffered_length += bytes_received;
 
         // Process the buffer for complete packets.
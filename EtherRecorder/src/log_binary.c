@@ -0,0 +1,397 @@
+/**
+ * @file log_binary.c
+ * @brief Writes and reads the binary log file format.
+ */
+
+#include "log_binary.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_format.h"
+#include "log_label.h"
+#include "log_writer.h"
+
+#define VARINT_MAX_BYTES 10
+#define RECORD_HEADER_MAX_BYTES (1 + VARINT_MAX_BYTES + 8 + 1 + VARINT_MAX_BYTES * 3)
+#define HEADER_BYTES (1 + 6 + 1 + 8 + 8 + 8 + 4 + 4)
+
+// Format intern table, shared by every file. Open addressing, slots hold id + 1 so zero is empty.
+// Labels need no table of their own, entries already carry the process-wide label id.
+static const char *format_strings[LOG_BINARY_MAX_FORMATS];
+static uint16_t format_slots[LOG_BINARY_MAX_FORMATS * 2];
+static uint32_t format_count = 0;
+
+/**
+ * @brief Appends a LEB128 varint.
+ * @return The number of bytes written.
+ */
+static size_t put_varint(unsigned char *out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char)value;
+    return length;
+}
+
+/**
+ * @brief Appends @p bytes bytes of @p value, least significant first.
+ */
+static size_t put_le(unsigned char *out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+    return bytes;
+}
+
+static bool is_defined(const uint8_t *bits, uint32_t id) {
+    return (bits[id >> 3] >> (id & 7)) & 1;
+}
+
+static void set_defined(uint8_t *bits, uint32_t id) {
+    bits[id >> 3] |= (uint8_t)(1u << (id & 7));
+}
+
+/**
+ * @brief Returns the id for a format, adding it if new.
+ * @return The id, or -1 if the table is full.
+ */
+static int32_t intern_format(const char *format) {
+    // Formats are string literals, so the pointer is the identity
+    uintptr_t key = (uintptr_t)format;
+    size_t mask = sizeof(format_slots) / sizeof(format_slots[0]) - 1;
+    size_t slot = ((key >> 3) ^ (key >> 13)) & mask;
+
+    while (format_slots[slot]) {
+        uint32_t id = format_slots[slot] - 1u;
+        if (format_strings[id] == format) {
+            return (int32_t)id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (format_count >= LOG_BINARY_MAX_FORMATS) {
+        return -1;
+    }
+    format_strings[format_count] = format;
+    format_slots[slot] = (uint16_t)(format_count + 1);
+    return (int32_t)format_count++;
+}
+
+/**
+ * @brief Writes a label or format definition.
+ */
+static bool write_definition(LogWriter_T *writer, LogBinaryRecordType type, uint32_t id, const char *text) {
+    unsigned char record[1 + VARINT_MAX_BYTES * 2];
+    size_t text_length = strlen(text);
+    size_t length = 0;
+
+    record[length++] = (unsigned char)type;
+    length += put_varint(record + length, id);
+    length += put_varint(record + length, text_length);
+
+    return log_writer_write(writer, record, length) &&
+           log_writer_write(writer, text, text_length);
+}
+
+/**
+ * @copydoc log_binary_init_header
+ */
+void log_binary_init_header(LogBinaryHeader_T *header) {
+    header->long_size = (uint8_t)sizeof(long);
+    header->pointer_size = (uint8_t)sizeof(void *);
+    header->long_double_size = (uint8_t)sizeof(long double);
+}
+
+/**
+ * @copydoc log_binary_write_header
+ */
+bool log_binary_write_header(LogWriter_T *writer, LogBinaryFile_T *state, const LogBinaryHeader_T *header) {
+    unsigned char record[HEADER_BYTES];
+    size_t length = 0;
+
+    memset(state, 0, sizeof(*state));
+
+    record[length++] = LOG_BINARY_RECORD_HEADER;
+    memcpy(record + length, LOG_BINARY_MAGIC, 6);
+    length += 6;
+    record[length++] = LOG_BINARY_VERSION;
+    length += put_le(record + length, (uint64_t)header->qpc_frequency, 8);
+    length += put_le(record + length, (uint64_t)header->qpc_reference, 8);
+    length += put_le(record + length, header->filetime_reference, 8);
+    length += put_le(record + length, header->timestamp_granularity, 4);
+    record[length++] = header->index_width;
+    record[length++] = header->long_size;
+    record[length++] = header->pointer_size;
+    record[length++] = header->long_double_size;
+
+    return log_writer_write(writer, record, length);
+}
+
+/**
+ * @copydoc log_binary_write_entry
+ */
+bool log_binary_write_entry(LogWriter_T *writer, LogBinaryFile_T *state, const LogEntry_T *entry, uint64_t index) {
+    uint32_t label_id = entry->label_id;
+    if (label_id && !is_defined(state->labels_defined, label_id)) {
+        if (!write_definition(writer, LOG_BINARY_RECORD_LABEL, label_id, log_label_name(entry->label_id))) {
+            return false;
+        }
+        set_defined(state->labels_defined, label_id);
+    }
+
+    const char *payload = entry->message;
+    size_t payload_length = entry->message_length;
+    int32_t format_id = -1;
+    char text[LOG_MSG_BUFFER_SIZE];
+
+    if (entry->format) {
+        format_id = intern_format(entry->format);
+        if (format_id < 0) {
+            // Out of format ids, keep the text instead
+            payload_length = log_format_render(entry, text, sizeof(text));
+            payload = text;
+        } else if (!is_defined(state->formats_defined, (uint32_t)format_id)) {
+            if (!write_definition(writer, LOG_BINARY_RECORD_FORMAT, (uint32_t)format_id, entry->format)) {
+                return false;
+            }
+            set_defined(state->formats_defined, (uint32_t)format_id);
+        }
+    }
+
+    unsigned char record[RECORD_HEADER_MAX_BYTES];
+    size_t length = 0;
+
+    record[length++] = (unsigned char)((format_id < 0) ? LOG_BINARY_RECORD_TEXT : LOG_BINARY_RECORD_DEFERRED);
+    length += put_varint(record + length, index);
+    length += put_le(record + length, (uint64_t)entry->timestamp.QuadPart, 8);
+    record[length++] = (unsigned char)entry->level;
+    length += put_varint(record + length, label_id);
+    if (format_id >= 0) {
+        length += put_varint(record + length, (uint64_t)format_id);
+    }
+    length += put_varint(record + length, payload_length);
+
+    return log_writer_write(writer, record, length) &&
+           log_writer_write(writer, payload, payload_length);
+}
+
+/**
+ * @brief Reads a varint.
+ * @return false at the end of the file or on an overlong encoding.
+ */
+static bool get_varint(FILE *file, uint64_t *value) {
+    *value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) {
+            return false;
+        }
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reads @p bytes little-endian bytes.
+ */
+static bool get_le(FILE *file, uint64_t *value, size_t bytes) {
+    unsigned char raw[8];
+    if (fread(raw, 1, bytes, file) != bytes) {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        *value |= (uint64_t)raw[i] << (8 * i);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a length-prefixed string into a new allocation.
+ */
+static char *get_string(FILE *file) {
+    uint64_t length;
+    if (!get_varint(file, &length) || length >= LOG_MSG_BUFFER_SIZE) {
+        return NULL;
+    }
+    char *text = (char *)malloc((size_t)length + 1);
+    if (!text) {
+        return NULL;
+    }
+    if (fread(text, 1, (size_t)length, file) != length) {
+        free(text);
+        return NULL;
+    }
+    text[length] = '\0';
+    return text;
+}
+
+/**
+ * @brief Drops every interned string.
+ */
+static void reader_forget(LogBinaryReader_T *reader) {
+    for (size_t i = 0; i < LOG_BINARY_MAX_LABELS; i++) {
+        free(reader->labels[i]);
+        reader->labels[i] = NULL;
+    }
+    for (size_t i = 0; i < LOG_BINARY_MAX_FORMATS; i++) {
+        free(reader->formats[i]);
+        reader->formats[i] = NULL;
+    }
+}
+
+/**
+ * @brief Reads the rest of a header record.
+ */
+static bool read_header(LogBinaryReader_T *reader) {
+    unsigned char magic[7];
+    uint64_t frequency, reference, filetime, granularity;
+    unsigned char layout[4];
+
+    if (fread(magic, 1, sizeof(magic), reader->file) != sizeof(magic) ||
+        memcmp(magic, LOG_BINARY_MAGIC, 6) != 0 || magic[6] != LOG_BINARY_VERSION ||
+        !get_le(reader->file, &frequency, 8) ||
+        !get_le(reader->file, &reference, 8) ||
+        !get_le(reader->file, &filetime, 8) ||
+        !get_le(reader->file, &granularity, 4) ||
+        fread(layout, 1, sizeof(layout), reader->file) != sizeof(layout)) {
+        return false;
+    }
+
+    LogBinaryHeader_T header;
+    header.qpc_frequency = (int64_t)frequency;
+    header.qpc_reference = (int64_t)reference;
+    header.filetime_reference = filetime;
+    header.timestamp_granularity = (uint32_t)granularity;
+    header.index_width = layout[0];
+    header.long_size = layout[1];
+    header.pointer_size = layout[2];
+    header.long_double_size = layout[3];
+
+    // Reopening a file within one run repeats the header, and ids carry on
+    bool same_run = reader->has_header &&
+                    reader->header.qpc_reference == header.qpc_reference &&
+                    reader->header.filetime_reference == header.filetime_reference;
+    if (!same_run) {
+        reader_forget(reader);
+    }
+    reader->header = header;
+    reader->has_header = true;
+    return header.qpc_frequency > 0;
+}
+
+/**
+ * @copydoc log_binary_reader_init
+ */
+void log_binary_reader_init(LogBinaryReader_T *reader, FILE *file) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = file;
+}
+
+/**
+ * @copydoc log_binary_read_entry
+ */
+int log_binary_read_entry(LogBinaryReader_T *reader, uint64_t *index, LogEntry_T *entry) {
+    for (;;) {
+        int type = fgetc(reader->file);
+        if (type == EOF || type == 0) {
+            // A zero is the unused tail of a mapped segment the logger never got to close
+            return 0;
+        }
+
+        if (type == LOG_BINARY_RECORD_HEADER) {
+            if (!read_header(reader)) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (!reader->has_header) {
+            return -1;
+        }
+
+        if (type == LOG_BINARY_RECORD_LABEL || type == LOG_BINARY_RECORD_FORMAT) {
+            uint64_t id;
+            size_t limit = (type == LOG_BINARY_RECORD_LABEL) ? LOG_BINARY_MAX_LABELS : LOG_BINARY_MAX_FORMATS;
+            char **table = (type == LOG_BINARY_RECORD_LABEL) ? reader->labels : reader->formats;
+            if (!get_varint(reader->file, &id) || id >= limit) {
+                return -1;
+            }
+            char *text = get_string(reader->file);
+            if (!text) {
+                return -1;
+            }
+            free(table[id]);
+            table[id] = text;
+            continue;
+        }
+
+        if (type != LOG_BINARY_RECORD_TEXT && type != LOG_BINARY_RECORD_DEFERRED) {
+            return -1;
+        }
+
+        uint64_t timestamp, label_id, format_id = 0, payload_length;
+        int level = EOF;
+        if (!get_varint(reader->file, index) ||
+            !get_le(reader->file, &timestamp, 8) ||
+            (level = fgetc(reader->file)) == EOF ||
+            !get_varint(reader->file, &label_id) || label_id >= LOG_BINARY_MAX_LABELS ||
+            (type == LOG_BINARY_RECORD_DEFERRED &&
+             (!get_varint(reader->file, &format_id) || format_id >= LOG_BINARY_MAX_FORMATS)) ||
+            !get_varint(reader->file, &payload_length) || payload_length >= sizeof(entry->message) ||
+            fread(entry->message, 1, (size_t)payload_length, reader->file) != payload_length) {
+            return -1;
+        }
+
+        if (label_id && !reader->labels[label_id]) {
+            return -1;
+        }
+
+        entry->level = (LogLevel)level;
+        entry->timestamp.QuadPart = (int64_t)timestamp;
+        entry->label_id = (uint16_t)label_id;
+        entry->message_length = (uint32_t)payload_length;
+        entry->message[payload_length] = '\0';
+        entry->fields_length = 0; // Fields are written as text
+        entry->blob = 0;          // Dumps are written as their rows
+        entry->format = NULL;
+
+        if (type == LOG_BINARY_RECORD_DEFERRED) {
+            // Captured arguments can only be read back with the writer's type sizes
+            if (!reader->formats[format_id] ||
+                reader->header.long_size != sizeof(long) ||
+                reader->header.pointer_size != sizeof(void *) ||
+                reader->header.long_double_size != sizeof(long double)) {
+                return -1;
+            }
+            entry->format = reader->formats[format_id];
+            if (!log_format_validate(entry)) {
+                return -1;
+            }
+        }
+        return 1;
+    }
+}
+
+/**
+ * @copydoc log_binary_reader_label
+ */
+const char *log_binary_reader_label(const LogBinaryReader_T *reader, uint16_t label_id) {
+    if (label_id == 0 || label_id >= LOG_BINARY_MAX_LABELS || !reader->labels[label_id]) {
+        return "UNKNOWN";
+    }
+    return reader->labels[label_id];
+}
+
+/**
+ * @copydoc log_binary_reader_close
+ */
+void log_binary_reader_close(LogBinaryReader_T *reader) {
+    reader_forget(reader);
+    reader->has_header = false;
+}
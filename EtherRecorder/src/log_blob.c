@@ -0,0 +1,105 @@
+/**
+ * @file log_blob.c
+ * @brief Slots for binary data carried by log entries.
+ */
+
+#include "log_blob.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @copydoc log_blob_init
+ */
+bool log_blob_init(LogBlobPool_T *pool, size_t count, size_t slot_bytes) {
+    memset(pool, 0, sizeof(*pool));
+    if (!count || !slot_bytes) {
+        return false;
+    }
+    LogBlob_T *slots = (LogBlob_T *)calloc(count, sizeof(*slots));
+    uint8_t *data = (uint8_t *)malloc(count * slot_bytes);
+    if (!slots || !data) {
+        free(slots);
+        free(data);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        platform_atomic_init_64(&slots[i].busy, 0);
+        slots[i].data = data + i * slot_bytes;
+    }
+    pool->count = count;
+    pool->slot_bytes = slot_bytes;
+    pool->data = data;
+    platform_atomic_init_64(&pool->next, 0);
+    platform_atomic_init_64(&pool->stored, 0);
+    platform_atomic_init_64(&pool->bytes, 0);
+    platform_atomic_init_64(&pool->dropped, 0);
+    pool->slots = slots;
+    return true;
+}
+
+/**
+ * @copydoc log_blob_store
+ */
+uint32_t log_blob_store(LogBlobPool_T *pool, const void *data, size_t length, size_t row_start) {
+    if (!pool->slots || length > pool->slot_bytes) {
+        platform_atomic_fetch_add_64(&pool->dropped, 1);
+        return 0;
+    }
+    size_t first = (size_t)platform_atomic_fetch_add_64(&pool->next, 1);
+    for (size_t i = 0; i < pool->count; i++) {
+        size_t index = (first + i) % pool->count;
+        LogBlob_T *slot = &pool->slots[index];
+        int64_t expected = 0;
+        if (platform_atomic_load_relaxed_64(&slot->busy) == 0 && platform_atomic_cas_64(&slot->busy, &expected, 1)) {
+            memcpy(slot->data, data, length);
+            slot->length = (uint32_t)length;
+            slot->row_start = (uint32_t)row_start;
+            platform_atomic_fetch_add_64(&pool->stored, 1);
+            platform_atomic_fetch_add_64(&pool->bytes, (int64_t)length);
+            return (uint32_t)index + 1; // Seen by the logger thread once the entry carrying it is queued
+        }
+    }
+    platform_atomic_fetch_add_64(&pool->dropped, 1);
+    return 0;
+}
+
+/**
+ * @copydoc log_blob_get
+ */
+const LogBlob_T *log_blob_get(const LogBlobPool_T *pool, uint32_t reference) {
+    if (!pool->slots || reference == 0 || reference > pool->count) {
+        return NULL;
+    }
+    return &pool->slots[reference - 1];
+}
+
+/**
+ * @copydoc log_blob_release
+ */
+void log_blob_release(LogBlobPool_T *pool, uint32_t reference) {
+    if (!pool->slots || reference == 0 || reference > pool->count) {
+        return;
+    }
+    platform_atomic_store_64(&pool->slots[reference - 1].busy, 0);
+}
+
+/**
+ * @copydoc log_blob_get_stats
+ */
+void log_blob_get_stats(LogBlobPool_T *pool, LogBlobStats_T *stats) {
+    stats->stored = (uint64_t)platform_atomic_load_64(&pool->stored);
+    stats->bytes = (uint64_t)platform_atomic_load_64(&pool->bytes);
+    stats->dropped = (uint64_t)platform_atomic_load_64(&pool->dropped);
+}
+
+/**
+ * @copydoc log_blob_free
+ */
+void log_blob_free(LogBlobPool_T *pool) {
+    free(pool->slots);
+    free(pool->data);
+    pool->slots = NULL;
+    pool->data = NULL;
+    pool->count = 0;
+}
@@ -0,0 +1,441 @@
+/**
+ * @file log_codec.c
+ * @brief Fast block compression for closed log segments.
+ */
+
+#include "log_codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_MATCH 4
+#define HASH_BITS 13
+#define LAST_LITERALS 5  // A block always ends with at least this many literals
+#define MATCH_SAFE 12    // No match starts this close to the end of a block
+#define MAX_OFFSET 65535
+#define STORED_RAW 0x80000000u // Stored size flag: the block did not compress
+
+#define FILE_MAGIC "ELZ1"
+#define INDEX_MAGIC "ELZX"
+#define FILE_HEADER_BYTES 8
+#define BLOCK_HEADER_BYTES 8
+#define TRAILER_BYTES 24
+#define MAX_BLOCK_SIZE (16 * 1024 * 1024) // Sanity limit when reading
+
+static uint32_t read32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void put_le(unsigned char *out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_le(const unsigned char *in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static int seek_to(FILE *file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+/**
+ * @brief Writes the bytes of a length beyond what fits in a token nibble.
+ */
+static unsigned char *put_length(unsigned char *out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (unsigned char)length;
+    return out;
+}
+
+/**
+ * @brief Writes one sequence: literals, then a match unless @p match_length is 0.
+ * @return The new output position, or NULL if it would not fit.
+ */
+static unsigned char *put_sequence(unsigned char *out, const unsigned char *end,
+                                   const unsigned char *literals, size_t literal_length,
+                                   size_t offset, size_t match_length) {
+    if ((size_t)(end - out) < 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1) {
+        return NULL;
+    }
+
+    unsigned char *token = out++;
+    if (literal_length >= 15) {
+        *token = 15 << 4;
+        out = put_length(out, literal_length - 15);
+    } else {
+        *token = (unsigned char)(literal_length << 4);
+    }
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    if (match_length == 0) {
+        return out; // The last sequence has no match
+    }
+
+    *out++ = (unsigned char)offset;
+    *out++ = (unsigned char)(offset >> 8);
+    size_t extra = match_length - MIN_MATCH;
+    if (extra >= 15) {
+        *token |= 15;
+        out = put_length(out, extra - 15);
+    } else {
+        *token |= (unsigned char)extra;
+    }
+    return out;
+}
+
+/**
+ * @copydoc log_codec_compress_block
+ */
+size_t log_codec_compress_block(const unsigned char *source, size_t source_length,
+                                unsigned char *destination, size_t capacity) {
+    int32_t table[1 << HASH_BITS];
+    memset(table, 0xFF, sizeof(table)); // -1, no position yet
+
+    unsigned char *out = destination;
+    const unsigned char *end = destination + capacity;
+    size_t position = 0;
+    size_t anchor = 0;
+    size_t match_limit = (source_length > MATCH_SAFE) ? source_length - MATCH_SAFE : 0;
+
+    while (position < match_limit) {
+        uint32_t sequence = read32(source + position);
+        uint32_t hash = hash4(sequence);
+        int32_t candidate = table[hash];
+        table[hash] = (int32_t)position;
+
+        if (candidate < 0 || position - (size_t)candidate > MAX_OFFSET ||
+            read32(source + candidate) != sequence) {
+            position++;
+            continue;
+        }
+
+        size_t match_length = MIN_MATCH;
+        size_t longest = source_length - LAST_LITERALS - position;
+        while (match_length < longest && source[candidate + match_length] == source[position + match_length]) {
+            match_length++;
+        }
+
+        out = put_sequence(out, end, source + anchor, position - anchor, position - (size_t)candidate, match_length);
+        if (!out) {
+            return 0;
+        }
+        position += match_length;
+        anchor = position;
+    }
+
+    out = put_sequence(out, end, source + anchor, source_length - anchor, 0, 0);
+    return out ? (size_t)(out - destination) : 0;
+}
+
+/**
+ * @brief Reads the bytes of a length beyond its token nibble.
+ * @return false if the input runs out.
+ */
+static bool get_length(const unsigned char *source, size_t source_length, size_t *position, size_t *length) {
+    unsigned char byte;
+    do {
+        if (*position >= source_length) {
+            return false;
+        }
+        byte = source[(*position)++];
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * @copydoc log_codec_decompress_block
+ */
+long log_codec_decompress_block(const unsigned char *source, size_t source_length,
+                                unsigned char *destination, size_t capacity) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < source_length) {
+        unsigned char token = source[in++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !get_length(source, source_length, &in, &literal_length)) {
+            return -1;
+        }
+        if (literal_length > source_length - in || literal_length > capacity - out) {
+            return -1;
+        }
+        memcpy(destination + out, source + in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == source_length) {
+            break; // The last sequence has no match
+        }
+
+        if (source_length - in < 2) {
+            return -1;
+        }
+        size_t offset = source[in] | ((size_t)source[in + 1] << 8);
+        in += 2;
+        if (offset == 0 || offset > out) {
+            return -1;
+        }
+
+        size_t match_length = token & 15;
+        if (match_length == 15 && !get_length(source, source_length, &in, &match_length)) {
+            return -1;
+        }
+        match_length += MIN_MATCH;
+        if (match_length > capacity - out) {
+            return -1;
+        }
+        // Byte by byte, the match may overlap what it is copying to
+        const unsigned char *match = destination + out - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            destination[out + i] = match[i];
+        }
+        out += match_length;
+    }
+    return (long)out;
+}
+
+/**
+ * @copydoc log_codec_compress_file
+ */
+bool log_codec_compress_file(const char *source_name, const char *destination_name,
+                             uint64_t *raw_bytes, uint64_t *compressed_bytes) {
+    *raw_bytes = 0;
+    *compressed_bytes = 0;
+
+    FILE *source = fopen(source_name, "rb");
+    if (!source) {
+        return false;
+    }
+    FILE *destination = fopen(destination_name, "wb");
+    if (!destination) {
+        fclose(source);
+        return false;
+    }
+
+    unsigned char *raw = (unsigned char *)malloc(LOG_CODEC_BLOCK_SIZE);
+    unsigned char *packed = (unsigned char *)malloc(LOG_CODEC_BOUND(LOG_CODEC_BLOCK_SIZE));
+    uint64_t *offsets = NULL;
+    uint32_t block_count = 0;
+    uint32_t offsets_capacity = 0;
+    uint64_t position = 0;
+    bool ok = raw && packed;
+
+    unsigned char header[FILE_HEADER_BYTES];
+    memcpy(header, FILE_MAGIC, 4);
+    put_le(header + 4, LOG_CODEC_BLOCK_SIZE, 4);
+    ok = ok && fwrite(header, 1, sizeof(header), destination) == sizeof(header);
+    position += sizeof(header);
+
+    size_t length;
+    while (ok && (length = fread(raw, 1, LOG_CODEC_BLOCK_SIZE, source)) > 0) {
+        if (block_count == offsets_capacity) {
+            offsets_capacity = offsets_capacity ? offsets_capacity * 2 : 64;
+            uint64_t *grown = (uint64_t *)realloc(offsets, offsets_capacity * sizeof(uint64_t));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            offsets = grown;
+        }
+        offsets[block_count++] = position;
+
+        size_t stored = log_codec_compress_block(raw, length, packed, LOG_CODEC_BOUND(LOG_CODEC_BLOCK_SIZE));
+        const unsigned char *data = packed;
+        uint32_t flags = 0;
+        if (stored == 0 || stored >= length) {
+            stored = length; // Incompressible, keep it as it is
+            data = raw;
+            flags = STORED_RAW;
+        }
+
+        unsigned char block_header[BLOCK_HEADER_BYTES];
+        put_le(block_header, (uint32_t)stored | flags, 4);
+        put_le(block_header + 4, (uint32_t)length, 4);
+        ok = fwrite(block_header, 1, sizeof(block_header), destination) == sizeof(block_header) &&
+             fwrite(data, 1, stored, destination) == stored;
+        position += sizeof(block_header) + stored;
+        *raw_bytes += length;
+    }
+    ok = ok && !ferror(source);
+
+    uint64_t index_offset = position;
+    for (uint32_t i = 0; ok && i < block_count; i++) {
+        unsigned char entry[8];
+        put_le(entry, offsets[i], 8);
+        ok = fwrite(entry, 1, sizeof(entry), destination) == sizeof(entry);
+        position += sizeof(entry);
+    }
+
+    unsigned char trailer[TRAILER_BYTES];
+    put_le(trailer, index_offset, 8);
+    put_le(trailer + 8, *raw_bytes, 8);
+    put_le(trailer + 16, block_count, 4);
+    memcpy(trailer + 20, INDEX_MAGIC, 4);
+    ok = ok && fwrite(trailer, 1, sizeof(trailer), destination) == sizeof(trailer);
+    position += sizeof(trailer);
+
+    free(offsets);
+    free(packed);
+    free(raw);
+    fclose(source);
+    if (fclose(destination) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(destination_name);
+        return false;
+    }
+    *compressed_bytes = position;
+    return true;
+}
+
+/**
+ * @copydoc log_codec_is_compressed
+ */
+bool log_codec_is_compressed(FILE *file) {
+    char magic[4];
+    long start = ftell(file);
+    bool compressed = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, FILE_MAGIC, 4) == 0;
+    fseek(file, start, SEEK_SET);
+    return compressed;
+}
+
+/**
+ * @copydoc log_codec_reader_open
+ */
+bool log_codec_reader_open(LogCodecReader_T *reader, FILE *file) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = file;
+    reader->cached_block = UINT32_MAX;
+
+    unsigned char header[FILE_HEADER_BYTES];
+    unsigned char trailer[TRAILER_BYTES];
+    if (seek_to(file, 0) != 0 || fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, FILE_MAGIC, 4) != 0 ||
+        fseek(file, -TRAILER_BYTES, SEEK_END) != 0 || fread(trailer, 1, sizeof(trailer), file) != sizeof(trailer) ||
+        memcmp(trailer + 20, INDEX_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    reader->block_size = (uint32_t)get_le(header + 4, 4);
+    uint64_t index_offset = get_le(trailer, 8);
+    reader->raw_size = get_le(trailer + 8, 8);
+    reader->block_count = (uint32_t)get_le(trailer + 16, 4);
+    if (reader->block_size == 0 || reader->block_size > MAX_BLOCK_SIZE ||
+        reader->raw_size > (uint64_t)reader->block_count * reader->block_size) {
+        return false;
+    }
+
+    reader->block_offsets = (uint64_t *)malloc(((size_t)reader->block_count + 1) * sizeof(uint64_t));
+    reader->compressed = (unsigned char *)malloc(LOG_CODEC_BOUND(reader->block_size));
+    reader->block = (unsigned char *)malloc(reader->block_size);
+    if (!reader->block_offsets || !reader->compressed || !reader->block || seek_to(file, index_offset) != 0) {
+        log_codec_reader_close(reader);
+        return false;
+    }
+    for (uint32_t i = 0; i < reader->block_count; i++) {
+        unsigned char entry[8];
+        if (fread(entry, 1, sizeof(entry), file) != sizeof(entry)) {
+            log_codec_reader_close(reader);
+            return false;
+        }
+        reader->block_offsets[i] = get_le(entry, 8);
+    }
+    return true;
+}
+
+/**
+ * @brief Makes @p block the cached block, reading and decompressing it if need be.
+ */
+static bool load_block(LogCodecReader_T *reader, uint32_t block) {
+    if (reader->cached_block == block) {
+        return true;
+    }
+    reader->cached_block = UINT32_MAX;
+
+    unsigned char block_header[BLOCK_HEADER_BYTES];
+    if (seek_to(reader->file, reader->block_offsets[block]) != 0 ||
+        fread(block_header, 1, sizeof(block_header), reader->file) != sizeof(block_header)) {
+        return false;
+    }
+    uint32_t stored = (uint32_t)get_le(block_header, 4);
+    uint32_t length = (uint32_t)get_le(block_header + 4, 4);
+    bool raw = (stored & STORED_RAW) != 0;
+    stored &= ~STORED_RAW;
+    if (length > reader->block_size || stored > LOG_CODEC_BOUND(reader->block_size)) {
+        return false;
+    }
+
+    if (raw) {
+        if (stored != length || fread(reader->block, 1, length, reader->file) != length) {
+            return false;
+        }
+    } else if (fread(reader->compressed, 1, stored, reader->file) != stored ||
+               log_codec_decompress_block(reader->compressed, stored, reader->block, reader->block_size) != (long)length) {
+        return false;
+    }
+
+    reader->cached_block = block;
+    reader->cached_length = length;
+    return true;
+}
+
+/**
+ * @copydoc log_codec_read
+ */
+long log_codec_read(LogCodecReader_T *reader, uint64_t offset, void *buffer, size_t length) {
+    unsigned char *out = (unsigned char *)buffer;
+    size_t copied = 0;
+
+    while (copied < length && offset < reader->raw_size) {
+        uint32_t block = (uint32_t)(offset / reader->block_size);
+        if (block >= reader->block_count || !load_block(reader, block)) {
+            return -1;
+        }
+        size_t within = (size_t)(offset % reader->block_size);
+        if (within >= reader->cached_length) {
+            return -1;
+        }
+        size_t available = reader->cached_length - within;
+        size_t wanted = length - copied;
+        size_t count = (available < wanted) ? available : wanted;
+        memcpy(out + copied, reader->block + within, count);
+        copied += count;
+        offset += count;
+    }
+    return (long)copied;
+}
+
+/**
+ * @copydoc log_codec_reader_close
+ */
+void log_codec_reader_close(LogCodecReader_T *reader) {
+    free(reader->block_offsets);
+    free(reader->compressed);
+    free(reader->block);
+    reader->block_offsets = NULL;
+    reader->compressed = NULL;
+    reader->block = NULL;
+}
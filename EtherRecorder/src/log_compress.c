@@ -0,0 +1,183 @@
+/**
+ * @file log_compress.c
+ * @brief Background compression of closed log segments.
+ */
+
+#include "log_compress.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log_codec.h"
+#include "platform_mutex.h"
+#include "platform_threads.h"
+#include "platform_utils.h"
+
+#define LOG_COMPRESS_IDLE_WAIT_MS 1000
+
+static PlatformThread_T compress_thread;
+static PlatformMutex_T compress_mutex;
+static PlatformEvent_T compress_event;
+static bool compress_running = false;
+static bool compress_stopping = false;
+
+// Guarded by compress_mutex
+static char compress_queue[LOG_COMPRESS_QUEUE_SIZE][MAX_PATH];
+static unsigned int compress_head = 0; // Next to take
+static unsigned int compress_count = 0;
+static bool compress_busy = false;     // A segment is being compressed
+static LogCompressStats_T compress_stats;
+
+/**
+ * @brief Compresses one segment, replacing it with the compressed copy.
+ */
+static void compress_segment(const char *segment_name) {
+    char temporary_name[MAX_PATH];
+    char compressed_name[MAX_PATH];
+    snprintf(temporary_name, sizeof(temporary_name), "%s%s.tmp", segment_name, LOG_CODEC_SUFFIX);
+    snprintf(compressed_name, sizeof(compressed_name), "%s%s", segment_name, LOG_CODEC_SUFFIX);
+
+    uint64_t raw_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    bool ok = log_codec_compress_file(segment_name, temporary_name, &raw_bytes, &compressed_bytes);
+
+    // Only ever swap in a complete file; rename will not replace one on Windows
+    if (ok) {
+        remove(compressed_name);
+        ok = rename(temporary_name, compressed_name) == 0;
+        if (!ok) {
+            remove(temporary_name);
+        }
+    }
+    if (ok && remove(segment_name) != 0) {
+        // Pruned while we worked on it, so the copy should go too
+        remove(compressed_name);
+        ok = false;
+    }
+
+    platform_mutex_lock(&compress_mutex);
+    if (ok) {
+        compress_stats.segments++;
+        compress_stats.raw_bytes += raw_bytes;
+        compress_stats.compressed_bytes += compressed_bytes;
+    } else {
+        compress_stats.skipped++;
+    }
+    platform_mutex_unlock(&compress_mutex);
+}
+
+/**
+ * @brief The worker: takes segment names off the queue until told to stop.
+ */
+static void *compress_thread_function(void *arg) {
+    (void)arg;
+    platform_thread_set_low_priority();
+
+    for (;;) {
+        char segment_name[MAX_PATH];
+
+        platform_mutex_lock(&compress_mutex);
+        compress_busy = false;
+        if (compress_stopping) {
+            platform_mutex_unlock(&compress_mutex);
+            break;
+        }
+        bool have_segment = compress_count > 0;
+        if (have_segment) {
+            memcpy(segment_name, compress_queue[compress_head], sizeof(segment_name));
+            compress_head = (compress_head + 1) % LOG_COMPRESS_QUEUE_SIZE;
+            compress_count--;
+            compress_busy = true;
+        }
+        platform_mutex_unlock(&compress_mutex);
+
+        if (have_segment) {
+            compress_segment(segment_name);
+        } else {
+            platform_event_wait(&compress_event, LOG_COMPRESS_IDLE_WAIT_MS);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @copydoc log_compress_start
+ */
+bool log_compress_start(void) {
+    if (compress_running) {
+        return true;
+    }
+    if (platform_mutex_init(&compress_mutex) != 0) {
+        return false;
+    }
+    if (platform_event_init(&compress_event) != 0) {
+        platform_mutex_destroy(&compress_mutex);
+        return false;
+    }
+    compress_stopping = false;
+    if (platform_thread_create(&compress_thread, compress_thread_function, NULL) != 0) {
+        platform_event_destroy(&compress_event);
+        platform_mutex_destroy(&compress_mutex);
+        return false;
+    }
+    compress_running = true;
+    return true;
+}
+
+/**
+ * @copydoc log_compress_submit
+ */
+bool log_compress_submit(const char *segment_name) {
+    if (!compress_running) {
+        return false;
+    }
+
+    platform_mutex_lock(&compress_mutex);
+    bool queued = compress_count < LOG_COMPRESS_QUEUE_SIZE;
+    if (queued) {
+        unsigned int tail = (compress_head + compress_count) % LOG_COMPRESS_QUEUE_SIZE;
+        snprintf(compress_queue[tail], MAX_PATH, "%s", segment_name);
+        compress_count++;
+    } else {
+        compress_stats.skipped++;
+    }
+    platform_mutex_unlock(&compress_mutex);
+
+    if (queued) {
+        platform_event_signal(&compress_event);
+    }
+    return queued;
+}
+
+/**
+ * @copydoc log_compress_stop
+ */
+void log_compress_stop(void) {
+    if (!compress_running) {
+        return;
+    }
+    platform_mutex_lock(&compress_mutex);
+    compress_stopping = true;
+    platform_mutex_unlock(&compress_mutex);
+    platform_event_signal(&compress_event);
+
+    platform_thread_join(compress_thread, NULL);
+    compress_running = false;
+    platform_event_destroy(&compress_event);
+    platform_mutex_destroy(&compress_mutex);
+}
+
+/**
+ * @copydoc log_compress_get_stats
+ */
+void log_compress_get_stats(LogCompressStats_T *stats) {
+    if (!compress_running) {
+        *stats = compress_stats;
+        stats->backlog = 0;
+        return;
+    }
+    platform_mutex_lock(&compress_mutex);
+    *stats = compress_stats;
+    stats->backlog = compress_count + (compress_busy ? 1 : 0);
+    platform_mutex_unlock(&compress_mutex);
+}
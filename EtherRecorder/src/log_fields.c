@@ -0,0 +1,209 @@
+/**
+ * @file log_fields.c
+ * @brief Typed key-value fields attached to log entries.
+ */
+
+#include "log_fields.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Bytes a field's value takes when packed, strings excepted.
+ */
+static size_t value_size(LogFieldType type) {
+    return (type == LOG_FIELD_BOOL) ? 1 : 8;
+}
+
+/**
+ * @copydoc log_fields_encode
+ */
+size_t log_fields_encode(char *out, size_t room, const LogField_T *fields, size_t count) {
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        const LogField_T *field = &fields[i];
+        const char *key = field->key ? field->key : "";
+        size_t key_length = strlen(key);
+        if (key_length > LOG_FIELD_KEY_MAX) {
+            key_length = LOG_FIELD_KEY_MAX;
+        }
+
+        const char *text = NULL;
+        size_t text_length = 0;
+        size_t size = 2 + key_length;
+        if (field->type == LOG_FIELD_STRING) {
+            text = field->value.s ? field->value.s : "";
+            text_length = strlen(text);
+            if (text_length > UINT16_MAX) {
+                text_length = UINT16_MAX;
+            }
+            size += sizeof(uint16_t) + text_length;
+        } else if (field->type >= LOG_FIELD_INT && field->type <= LOG_FIELD_BOOL) {
+            size += value_size(field->type);
+        } else {
+            continue; // Not a field type
+        }
+        if (size > room - used) {
+            continue; // A smaller one further on may still fit
+        }
+
+        char *p = out + used;
+        *p++ = (char)field->type;
+        *p++ = (char)key_length;
+        memcpy(p, key, key_length);
+        p += key_length;
+        if (field->type == LOG_FIELD_STRING) {
+            uint16_t length16 = (uint16_t)text_length;
+            memcpy(p, &length16, sizeof(length16));
+            memcpy(p + sizeof(length16), text, text_length);
+        } else if (field->type == LOG_FIELD_BOOL) {
+            *p = field->value.b ? 1 : 0;
+        } else {
+            memcpy(p, &field->value, 8); // i, u and d share the union's first 8 bytes
+        }
+        used += size;
+    }
+    return used;
+}
+
+/**
+ * @copydoc log_fields_next
+ */
+bool log_fields_next(const char **cursor, const char *end, LogFieldView_T *field) {
+    const char *p = *cursor;
+    if (end - p < 2) {
+        return false;
+    }
+    field->type = (LogFieldType)(unsigned char)p[0];
+    field->key_length = (unsigned char)p[1];
+    field->key = p + 2;
+    p += 2 + field->key_length;
+    if (p > end) {
+        return false;
+    }
+
+    if (field->type == LOG_FIELD_STRING) {
+        uint16_t length16;
+        if ((size_t)(end - p) < sizeof(length16)) {
+            return false;
+        }
+        memcpy(&length16, p, sizeof(length16));
+        p += sizeof(length16);
+        if ((size_t)(end - p) < length16) {
+            return false;
+        }
+        field->text = p;
+        field->text_length = length16;
+        p += length16;
+    } else if (field->type >= LOG_FIELD_INT && field->type <= LOG_FIELD_BOOL) {
+        size_t size = value_size(field->type);
+        if ((size_t)(end - p) < size) {
+            return false;
+        }
+        if (field->type == LOG_FIELD_BOOL) {
+            field->value.b = (*p != 0);
+        } else {
+            memcpy(&field->value, p, 8);
+        }
+        field->text = NULL;
+        field->text_length = 0;
+        p += size;
+    } else {
+        return false;
+    }
+    *cursor = p;
+    return true;
+}
+
+/**
+ * @copydoc log_fields_format_uint
+ */
+size_t log_fields_format_uint(char *out, uint64_t value, bool negative) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    size_t length = 0;
+    if (negative) {
+        out[length++] = '-';
+    }
+    while (count) {
+        out[length++] = digits[--count];
+    }
+    return length;
+}
+
+/**
+ * @brief Whether a string value needs quotes to be read back as one value.
+ */
+static bool needs_quotes(const char *text, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == ' ' || text[i] == '"' || text[i] == '=') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @copydoc log_fields_append_text
+ */
+size_t log_fields_append_text(char *out, size_t room, const char *fields, size_t length) {
+    const char *cursor = fields;
+    const char *end = fields + length;
+    LogFieldView_T field;
+    size_t used = 0;
+
+    while (log_fields_next(&cursor, end, &field)) {
+        char value[64];
+        const char *text = value;
+        size_t text_length;
+        bool quoted = false;
+
+        switch (field.type) {
+        case LOG_FIELD_INT:
+            text_length = log_fields_format_uint(value,
+                field.value.i < 0 ? 0 - (uint64_t)field.value.i : (uint64_t)field.value.i, field.value.i < 0);
+            break;
+        case LOG_FIELD_UINT:
+            text_length = log_fields_format_uint(value, field.value.u, false);
+            break;
+        case LOG_FIELD_DOUBLE: {
+            int written = snprintf(value, sizeof(value), "%g", field.value.d);
+            text_length = (written > 0 && (size_t)written < sizeof(value)) ? (size_t)written : 0;
+            break;
+        }
+        case LOG_FIELD_BOOL:
+            text = field.value.b ? "true" : "false";
+            text_length = strlen(text);
+            break;
+        default:
+            text = field.text;
+            text_length = field.text_length;
+            quoted = needs_quotes(text, text_length);
+            break;
+        }
+
+        size_t size = 2 + field.key_length + text_length + (quoted ? 2 : 0);
+        if (size > room - used) {
+            break;
+        }
+        char *p = out + used;
+        *p++ = ' ';
+        memcpy(p, field.key, field.key_length);
+        p += field.key_length;
+        *p++ = '=';
+        if (quoted) *p++ = '"';
+        memcpy(p, text, text_length);
+        p += text_length;
+        if (quoted) *p++ = '"';
+        used += size;
+    }
+    return used;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file log_flight.c
+ * @brief Crash flight recorder: recent log calls kept in a shared mapping.
+ */
+
+#include "log_flight.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log_format.h"
+#include "platform_mmap.h"
+#include "platform_signal.h"
+#include "platform_threads.h"
+#include "platform_utils.h"
+
+volatile int log_flight_level = LOG_FLIGHT_OFF;
+
+static PlatformFileMap_T flight_map;
+static LogFlightHeader_T *flight_header = NULL;
+static uint32_t flight_slots = 0;
+static char flight_name[MAX_PATH];
+static char flight_crash_name[MAX_PATH]; // Built up front, the signal handler cannot format
+
+static THREAD_LOCAL LogFlightRegion_T *this_thread_region = NULL;
+
+/**
+ * @brief Returns a region of the mapping.
+ */
+static LogFlightRegion_T *region_at(int64_t region) {
+    return (LogFlightRegion_T *)(flight_map.address + LOG_FLIGHT_REGIONS_OFFSET +
+        (size_t)region * LOG_FLIGHT_REGION_SIZE(flight_slots));
+}
+
+/**
+ * @brief Returns the record at a position in a region's ring.
+ */
+static LogFlightRecord_T *record_at(LogFlightRegion_T *region, int64_t position) {
+    LogFlightRecord_T *records = (LogFlightRecord_T *)(region + 1);
+    return &records[(uint64_t)position % flight_slots];
+}
+
+/**
+ * @brief Gives the calling thread a region of its own, or the shared last one once they run out.
+ */
+static LogFlightRegion_T *claim_region(void) {
+    int64_t region = platform_atomic_fetch_add_64(&flight_header->regions_claimed, 1);
+    if (region >= LOG_FLIGHT_REGIONS - 1) {
+        region = LOG_FLIGHT_REGIONS - 1;
+    }
+    return region_at(region);
+}
+
+/**
+ * @copydoc log_flight_save_previous
+ */
+bool log_flight_save_previous(const char *name, const char *directory, char *saved_name, size_t size) {
+    FILE *previous = fopen(name, "rb");
+    if (!previous) {
+        return false;
+    }
+    // A recorder that is still locked belongs to a process still running
+    if (!platform_file_lock(previous)) {
+        fclose(previous);
+        return false;
+    }
+
+    LogFlightHeader_T header;
+    bool unclosed = fread(&header, sizeof(header), 1, previous) == 1 &&
+        memcmp(header.magic, LOG_FLIGHT_MAGIC, sizeof(header.magic)) == 0 &&
+        header.state != LOG_FLIGHT_CLOSED;
+    FILE *copy = NULL;
+    if (unclosed) {
+        if (directory && *directory) {
+            create_directories(directory);
+            snprintf(saved_name, size, "%s%cflight_recorder.%lld.crash", directory, PATH_SEPARATOR, (long long)header.process_id);
+        } else {
+            snprintf(saved_name, size, "flight_recorder.%lld.crash", (long long)header.process_id);
+        }
+        copy = fopen(saved_name, "wb");
+    }
+
+    bool saved = false;
+    if (copy) {
+        char buffer[64 * 1024];
+        size_t length;
+        rewind(previous);
+        saved = true;
+        while ((length = fread(buffer, 1, sizeof(buffer), previous)) > 0) {
+            if (fwrite(buffer, 1, length, copy) != length) {
+                saved = false;
+                break;
+            }
+        }
+        saved = (fclose(copy) == 0) && saved;
+    }
+    fclose(previous);
+    return saved;
+}
+
+/**
+ * @copydoc log_flight_open
+ */
+bool log_flight_open(const char *name, const char *crash_name, uint32_t slots, LogLevel level, const LogBinaryHeader_T *clock) {
+    if (flight_header || slots == 0) {
+        return false;
+    }
+    size_t size = LOG_FLIGHT_REGIONS_OFFSET + LOG_FLIGHT_REGIONS * LOG_FLIGHT_REGION_SIZE(slots);
+
+    // Created if need be but not emptied until locked, as another process may be recording into it
+    FILE *file = fopen(name, "ab");
+    if (file) {
+        fclose(file);
+    }
+    file = fopen(name, "r+b");
+    if (!file) {
+        return false;
+    }
+    if (!platform_file_lock(file)) {
+        fclose(file);
+        return false;
+    }
+    if (platform_file_truncate(file, 0) != 0 || platform_file_map(&flight_map, file, size) != 0) {
+        fclose(file);
+        remove(name);
+        return false;
+    }
+
+    // The file was empty, so everything not set here is already zero
+    flight_slots = slots;
+    flight_header = (LogFlightHeader_T *)flight_map.address;
+    memcpy(flight_header->magic, LOG_FLIGHT_MAGIC, sizeof(flight_header->magic));
+    flight_header->version = LOG_FLIGHT_VERSION;
+    flight_header->record_size = (uint32_t)sizeof(LogFlightRecord_T);
+    flight_header->regions = LOG_FLIGHT_REGIONS;
+    flight_header->slots = slots;
+    flight_header->total_size = size;
+    flight_header->clock = *clock;
+    flight_header->process_id = platform_process_id();
+    platform_atomic_store_64(&flight_header->state, LOG_FLIGHT_RUNNING);
+
+    snprintf(flight_name, sizeof(flight_name), "%s", name);
+    snprintf(flight_crash_name, sizeof(flight_crash_name), "%s", crash_name);
+    log_flight_level = (int)level;
+    return true;
+}
+
+/**
+ * @copydoc log_flight_record
+ */
+void log_flight_record(LogLevel level, uint16_t label_id, const char *format, va_list args) {
+    if (!flight_header) {
+        return;
+    }
+    LogFlightRegion_T *region = this_thread_region;
+    if (!region) {
+        region = this_thread_region = claim_region();
+    }
+
+    int64_t position = platform_atomic_fetch_add_64(&region->head, 1);
+    LogFlightRecord_T *record = record_at(region, position);
+    platform_atomic_store_64(&record->sequence, 0);
+
+    LARGE_INTEGER now;
+    get_high_resolution_timestamp(&now);
+    record->timestamp = now.QuadPart;
+    record->label_id = label_id;
+    record->level = (uint8_t)level;
+
+    // Captured as a deferred entry would be, the format copied in beside the arguments
+    LogEntry_T captured;
+    va_list text_args;
+    va_copy(text_args, args);
+    va_list capture_args;
+    va_copy(capture_args, args);
+    bool deferred = log_format_capture(&captured, format, capture_args);
+    va_end(capture_args);
+    size_t format_length = deferred ? strlen(format) : 0;
+
+    if (deferred && format_length + 1 + captured.message_length <= sizeof(record->data)) {
+        memcpy(record->data, format, format_length + 1);
+        memcpy(record->data + format_length + 1, captured.message, captured.message_length);
+        record->deferred = 1;
+        record->format_length = (uint16_t)format_length;
+        record->data_length = (uint16_t)(format_length + 1 + captured.message_length);
+    } else {
+        size_t length = deferred ? log_format_render(&captured, record->data, sizeof(record->data))
+                                 : (size_t)vsnprintf(record->data, sizeof(record->data), format, text_args);
+        if (length >= sizeof(record->data)) {
+            length = sizeof(record->data) - 1;
+        }
+        record->deferred = 0;
+        record->format_length = 0;
+        record->data_length = (uint16_t)length;
+    }
+    va_end(text_args);
+
+    // Labels are named once; two threads racing to do it write the same bytes
+    if (label_id < LOG_LABEL_MAX && flight_header->labels[label_id][0] == '\0') {
+        snprintf(flight_header->labels[label_id], LOG_FLIGHT_LABEL_SIZE, "%s", log_label_name(label_id));
+    }
+
+    platform_atomic_store_64(&record->sequence, position + 1);
+}
+
+/**
+ * @copydoc log_flight_crashed
+ */
+void log_flight_crashed(int signal) {
+    if (!flight_header) {
+        return;
+    }
+    log_flight_level = LOG_FLIGHT_OFF;
+    platform_atomic_store_64(&flight_header->signal, signal);
+    platform_atomic_store_64(&flight_header->state, LOG_FLIGHT_CRASHED);
+
+    int fd = platform_fatal_open(flight_crash_name);
+    if (fd >= 0) {
+        platform_fatal_write(fd, flight_map.address, flight_map.size);
+        platform_fatal_close(fd);
+    }
+}
+
+/**
+ * @copydoc log_flight_close
+ */
+void log_flight_close(void) {
+    if (!flight_header) {
+        return;
+    }
+    log_flight_level = LOG_FLIGHT_OFF;
+    platform_atomic_store_64(&flight_header->state, LOG_FLIGHT_CLOSED);
+
+    // A thread that passed the level check just now may still be writing a
+    // record, so the mapping stays until the process exits. Where an open
+    // mapping's file cannot be removed, it is left marked closed, which the
+    // next start ignores.
+    remove(flight_name);
+}
@@ -0,0 +1,433 @@
+/**
+ * @file log_format.c
+ * @brief Captures printf-style arguments for formatting on the logger thread.
+ */
+
+#include "log_format.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform_threads.h"
+
+#define SIGNATURE_CACHE_SIZE 64 // Per thread, must be a power of two
+#define MAX_SPEC_DIGITS 9       // Longest width or precision accepted in a format
+
+/**
+ * @brief One conversion specification, split into the parts needed to rebuild it.
+ */
+typedef struct LogConversion {
+    const char *flags;
+    size_t flags_length;
+    const char *width;        // Digits, unless width_star
+    size_t width_length;
+    const char *precision;    // Digits after the '.', unless precision_star
+    size_t precision_length;
+    const char *length_modifier;
+    size_t length_modifier_length;
+    char conversion;
+    bool width_star;
+    bool has_precision;
+    bool precision_star;
+    bool has_arg;             // false for %%
+    bool deferrable;          // false for %n, wide characters and anything unknown
+    LogArgType type;
+    size_t consumed;          // Characters following the '%'
+} LogConversion;
+
+/**
+ * @brief What a format string needs from its arguments, cached per format pointer.
+ */
+typedef struct LogSignature_T {
+    const char *format;
+    bool deferrable;
+    uint8_t count;
+    uint8_t types[LOG_FORMAT_MAX_ARGS];
+} LogSignature_T;
+
+// Call sites pass string literals, so the format pointer identifies the signature
+static THREAD_LOCAL LogSignature_T signature_cache[SIGNATURE_CACHE_SIZE];
+
+/**
+ * @brief Works out the argument type for an integer conversion from its length modifier.
+ */
+static bool integer_type(const LogConversion *conv, LogArgType *type) {
+    const char *modifier = conv->length_modifier;
+    size_t length = conv->length_modifier_length;
+
+    if (length == 0 || (modifier[0] == 'h')) {
+        *type = LOG_ARG_INT; // char and short are promoted to int
+    } else if (length == 1 && modifier[0] == 'l') {
+        *type = LOG_ARG_LONG;
+    } else if ((length == 2 && modifier[0] == 'l') || (length == 3 && modifier[1] == '6')) {
+        *type = LOG_ARG_LLONG; // ll or MSVC's I64
+    } else if (length == 3 && modifier[1] == '3') {
+        *type = LOG_ARG_INT; // MSVC's I32
+    } else if (modifier[0] == 'z' || modifier[0] == 'I') {
+        *type = LOG_ARG_SIZE;
+    } else if (modifier[0] == 'j') {
+        *type = LOG_ARG_INTMAX;
+    } else if (modifier[0] == 't') {
+        *type = LOG_ARG_PTRDIFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a conversion specification.
+ * @param spec The characters following a '%'.
+ * @param conv Receives the parsed specification.
+ */
+static void parse_conversion(const char *spec, LogConversion *conv) {
+    const char *p = spec;
+    memset(conv, 0, sizeof(*conv));
+
+    conv->flags = p;
+    while (*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    conv->flags_length = (size_t)(p - conv->flags);
+
+    if (*p == '*') {
+        conv->width_star = true;
+        p++;
+    } else {
+        conv->width = p;
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        conv->width_length = (size_t)(p - conv->width);
+    }
+
+    if (*p == '.') {
+        conv->has_precision = true;
+        p++;
+        if (*p == '*') {
+            conv->precision_star = true;
+            p++;
+        } else {
+            conv->precision = p;
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+            conv->precision_length = (size_t)(p - conv->precision);
+        }
+    }
+
+    conv->length_modifier = p;
+    if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l')) {
+        p += 2;
+    } else if (p[0] == 'I' && ((p[1] == '6' && p[2] == '4') || (p[1] == '3' && p[2] == '2'))) {
+        p += 3;
+    } else if (*p && strchr("hlzjtLI", *p)) {
+        p++;
+    }
+    conv->length_modifier_length = (size_t)(p - conv->length_modifier);
+
+    conv->conversion = *p;
+    conv->consumed = (size_t)(p - spec) + (*p ? 1 : 0);
+    conv->has_arg = true;
+    conv->deferrable = conv->flags_length <= 5 &&
+                       conv->width_length <= MAX_SPEC_DIGITS &&
+                       conv->precision_length <= MAX_SPEC_DIGITS;
+
+    switch (conv->conversion) {
+    case '%':
+        conv->has_arg = false;
+        break;
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        conv->deferrable = conv->deferrable && integer_type(conv, &conv->type);
+        break;
+    case 'c':
+        conv->type = LOG_ARG_INT;
+        conv->deferrable = conv->deferrable && conv->length_modifier_length == 0;
+        break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        conv->type = (conv->length_modifier_length == 1 && conv->length_modifier[0] == 'L')
+                         ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+        break;
+    case 's':
+        conv->type = LOG_ARG_STRING;
+        conv->deferrable = conv->deferrable && conv->length_modifier_length == 0;
+        break;
+    case 'p':
+        conv->type = LOG_ARG_POINTER;
+        break;
+    default:
+        conv->deferrable = false; // %n, or something we do not understand
+        break;
+    }
+}
+
+/**
+ * @brief Builds the argument signature of a format string.
+ */
+static void build_signature(LogSignature_T *signature, const char *format) {
+    signature->format = format;
+    signature->deferrable = false;
+    signature->count = 0;
+
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        LogConversion conv;
+        parse_conversion(p + 1, &conv);
+        if (!conv.deferrable) {
+            return;
+        }
+        size_t needed = (size_t)conv.width_star + (size_t)conv.precision_star + (size_t)conv.has_arg;
+        if (signature->count + needed > LOG_FORMAT_MAX_ARGS) {
+            return;
+        }
+        if (conv.width_star) {
+            signature->types[signature->count++] = LOG_ARG_INT;
+        }
+        if (conv.precision_star) {
+            signature->types[signature->count++] = LOG_ARG_INT;
+        }
+        if (conv.has_arg) {
+            signature->types[signature->count++] = (uint8_t)conv.type;
+        }
+        p += conv.consumed;
+        if (!*p) {
+            break;
+        }
+    }
+    signature->deferrable = true;
+}
+
+/**
+ * @brief Returns the signature for a format, parsing it only on a cache miss.
+ */
+static const LogSignature_T *lookup_signature(const char *format) {
+    uintptr_t key = (uintptr_t)format;
+    LogSignature_T *signature = &signature_cache[((key >> 3) ^ (key >> 11)) & (SIGNATURE_CACHE_SIZE - 1)];
+    if (signature->format != format) {
+        build_signature(signature, format);
+    }
+    return signature;
+}
+
+/**
+ * @brief Appends raw bytes to a capture, keeping room for the terminator LOG_ENTRY_SIZE counts.
+ */
+static bool append_bytes(LogEntry_T *entry, size_t *used, const void *bytes, size_t size) {
+    if (*used + size >= sizeof(entry->message)) {
+        return false;
+    }
+    memcpy(entry->message + *used, bytes, size);
+    *used += size;
+    return true;
+}
+
+/* Pulls the next argument as @p type and appends it. */
+#define CAPTURE_ARG(type)                                            \
+    do {                                                             \
+        type value = va_arg(args, type);                             \
+        if (!append_bytes(entry, &used, &value, sizeof(value))) {    \
+            return false;                                            \
+        }                                                            \
+    } while (0)
+
+/**
+ * @copydoc log_format_capture
+ */
+bool log_format_capture(LogEntry_T *entry, const char *format, va_list args) {
+    const LogSignature_T *signature = lookup_signature(format);
+    if (!signature->deferrable) {
+        return false;
+    }
+
+    size_t used = 0;
+    if (!append_bytes(entry, &used, &signature->count, 1) ||
+        !append_bytes(entry, &used, signature->types, signature->count)) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < signature->count; i++) {
+        switch ((LogArgType)signature->types[i]) {
+        case LOG_ARG_INT:     CAPTURE_ARG(int); break;
+        case LOG_ARG_LONG:    CAPTURE_ARG(long); break;
+        case LOG_ARG_LLONG:   CAPTURE_ARG(long long); break;
+        case LOG_ARG_SIZE:    CAPTURE_ARG(size_t); break;
+        case LOG_ARG_INTMAX:  CAPTURE_ARG(intmax_t); break;
+        case LOG_ARG_PTRDIFF: CAPTURE_ARG(ptrdiff_t); break;
+        case LOG_ARG_DOUBLE:  CAPTURE_ARG(double); break;
+        case LOG_ARG_LDOUBLE: CAPTURE_ARG(long double); break;
+        case LOG_ARG_POINTER: CAPTURE_ARG(void *); break;
+        case LOG_ARG_STRING: {
+            // The caller's buffer may be gone by the time it is rendered
+            const char *value = va_arg(args, const char *);
+            if (!value) {
+                value = "(null)";
+            }
+            if (!append_bytes(entry, &used, value, strlen(value) + 1)) {
+                return false;
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    entry->format = format;
+    entry->message_length = (uint32_t)used;
+    entry->message[used] = '\0';
+    return true;
+}
+
+/**
+ * @copydoc log_format_validate
+ */
+bool log_format_validate(const LogEntry_T *entry) {
+    const unsigned char *message = (const unsigned char *)entry->message;
+    size_t length = entry->message_length;
+    if (!entry->format || length == 0 || length >= sizeof(entry->message) || 1 + (size_t)message[0] > length) {
+        return false;
+    }
+
+    // Parsed afresh, as the format is not one of this process's literals
+    LogSignature_T signature;
+    build_signature(&signature, entry->format);
+    if (!signature.deferrable || signature.count != message[0] ||
+        memcmp(signature.types, message + 1, signature.count) != 0) {
+        return false;
+    }
+
+    size_t used = 1 + (size_t)signature.count;
+    for (uint8_t i = 0; i < signature.count; i++) {
+        size_t size;
+        switch ((LogArgType)signature.types[i]) {
+        case LOG_ARG_INT:     size = sizeof(int); break;
+        case LOG_ARG_LONG:    size = sizeof(long); break;
+        case LOG_ARG_LLONG:   size = sizeof(long long); break;
+        case LOG_ARG_SIZE:    size = sizeof(size_t); break;
+        case LOG_ARG_INTMAX:  size = sizeof(intmax_t); break;
+        case LOG_ARG_PTRDIFF: size = sizeof(ptrdiff_t); break;
+        case LOG_ARG_DOUBLE:  size = sizeof(double); break;
+        case LOG_ARG_LDOUBLE: size = sizeof(long double); break;
+        case LOG_ARG_POINTER: size = sizeof(void *); break;
+        case LOG_ARG_STRING: {
+            const unsigned char *end = memchr(message + used, '\0', length - used);
+            if (!end) {
+                return false;
+            }
+            size = (size_t)(end - (message + used)) + 1;
+            break;
+        }
+        default:
+            return false;
+        }
+        if (size > length - used) {
+            return false;
+        }
+        used += size;
+    }
+    return true;
+}
+
+/* Reads the next captured argument as @p type and formats it with the rebuilt spec. */
+#define RENDER_ARG(type)                                             \
+    do {                                                             \
+        type value;                                                  \
+        memcpy(&value, *data, sizeof(value));                        \
+        *data += sizeof(value);                                      \
+        return snprintf(buffer, size, spec, value);                  \
+    } while (0)
+
+/**
+ * @brief Formats a single captured argument.
+ */
+static int render_argument(char *buffer, size_t size, const char *spec, LogArgType type,
+                           const unsigned char **data) {
+    switch (type) {
+    case LOG_ARG_INT:     RENDER_ARG(int);
+    case LOG_ARG_LONG:    RENDER_ARG(long);
+    case LOG_ARG_LLONG:   RENDER_ARG(long long);
+    case LOG_ARG_SIZE:    RENDER_ARG(size_t);
+    case LOG_ARG_INTMAX:  RENDER_ARG(intmax_t);
+    case LOG_ARG_PTRDIFF: RENDER_ARG(ptrdiff_t);
+    case LOG_ARG_DOUBLE:  RENDER_ARG(double);
+    case LOG_ARG_LDOUBLE: RENDER_ARG(long double);
+    case LOG_ARG_POINTER: RENDER_ARG(void *);
+    case LOG_ARG_STRING: {
+        const char *value = (const char *)*data;
+        *data += strlen(value) + 1;
+        return snprintf(buffer, size, spec, value);
+    }
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Reads a captured '*' width or precision.
+ */
+static int read_star(const unsigned char **data) {
+    int value;
+    memcpy(&value, *data, sizeof(value));
+    *data += sizeof(value);
+    return value;
+}
+
+/**
+ * @copydoc log_format_render
+ */
+size_t log_format_render(const LogEntry_T *entry, char *buffer, size_t size) {
+    const unsigned char *types = (const unsigned char *)entry->message + 1;
+    const unsigned char *data = types + types[-1];
+    size_t length = 0;
+
+    for (const char *p = entry->format; *p && length + 1 < size; ) {
+        if (*p != '%') {
+            buffer[length++] = *p++;
+            continue;
+        }
+
+        LogConversion conv;
+        parse_conversion(p + 1, &conv);
+        p += 1 + conv.consumed;
+
+        if (!conv.has_arg) {
+            buffer[length++] = '%';
+            continue;
+        }
+
+        // Rebuild the specification with any '*' replaced by the captured value
+        char width[16] = "";
+        char precision[16] = "";
+        if (conv.width_star) {
+            types++;
+            snprintf(width, sizeof(width), "%d", read_star(&data)); // Negative means left-justify, as printf does
+        } else {
+            snprintf(width, sizeof(width), "%.*s", (int)conv.width_length, conv.width);
+        }
+        if (conv.precision_star) {
+            types++;
+            int value = read_star(&data);
+            if (value >= 0) {
+                snprintf(precision, sizeof(precision), ".%d", value); // Negative is as if omitted
+            }
+        } else if (conv.has_precision) {
+            snprintf(precision, sizeof(precision), ".%.*s", (int)conv.precision_length, conv.precision);
+        }
+
+        char spec[64];
+        snprintf(spec, sizeof(spec), "%%%.*s%s%s%.*s%c",
+                 (int)conv.flags_length, conv.flags, width, precision,
+                 (int)conv.length_modifier_length, conv.length_modifier, conv.conversion);
+
+        int written = render_argument(buffer + length, size - length, spec, (LogArgType)*types++, &data);
+        if (written > 0) {
+            length += ((size_t)written < size - length) ? (size_t)written : size - length - 1;
+        }
+    }
+
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file log_hex.c
+ * @brief Hex dump rows for logged binary data.
+ */
+
+#include "log_hex.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOG_HEX_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define LOG_HEX_NEON
+#endif
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/**
+ * @brief Writes the hex of up to a few bytes, one at a time.
+ */
+static void encode_bytes(char *out, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = hex_digits[data[i] >> 4];
+        out[2 * i + 1] = hex_digits[data[i] & 0x0F];
+    }
+}
+
+#if defined(LOG_HEX_SSE2)
+/**
+ * @brief Writes the hex of sixteen bytes, 32 characters.
+ */
+static void encode_16(char *out, const uint8_t *data) {
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i letter_gap = _mm_set1_epi8('A' - '0' - 10);
+
+    __m128i bytes = _mm_loadu_si128((const __m128i *)data);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask);
+    __m128i low = _mm_and_si128(bytes, low_mask);
+
+    // Nibbles are 0..15, so a signed compare with 9 is safe
+    high = _mm_add_epi8(_mm_add_epi8(high, zero_char), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letter_gap));
+    low = _mm_add_epi8(_mm_add_epi8(low, zero_char), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letter_gap));
+
+    _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi8(high, low));
+}
+#elif defined(LOG_HEX_NEON)
+/**
+ * @brief Writes the hex of sixteen bytes, 32 characters.
+ */
+static void encode_16(char *out, const uint8_t *data) {
+    const uint8x16_t nine = vdupq_n_u8(9);
+    const uint8x16_t zero_char = vdupq_n_u8('0');
+    const uint8x16_t letter_gap = vdupq_n_u8('A' - '0' - 10);
+
+    uint8x16_t bytes = vld1q_u8(data);
+    uint8x16_t high = vshrq_n_u8(bytes, 4);
+    uint8x16_t low = vandq_u8(bytes, vdupq_n_u8(0x0F));
+
+    high = vaddq_u8(vaddq_u8(high, zero_char), vandq_u8(vcgtq_u8(high, nine), letter_gap));
+    low = vaddq_u8(vaddq_u8(low, zero_char), vandq_u8(vcgtq_u8(low, nine), letter_gap));
+
+    uint8x16x2_t pairs = { { high, low } };
+    vst2q_u8((uint8_t *)out, pairs); // Stores them interleaved
+}
+#endif
+
+/**
+ * @copydoc log_hex_encode
+ */
+void log_hex_encode(char *out, const uint8_t *data, size_t length) {
+#if defined(LOG_HEX_SSE2) || defined(LOG_HEX_NEON)
+    while (length >= 16) {
+        encode_16(out, data);
+        out += 32;
+        data += 16;
+        length -= 16;
+    }
+#endif
+    encode_bytes(out, data, length);
+}
+
+/**
+ * @copydoc log_hex_row
+ */
+void log_hex_row(char *out, const uint8_t *data, size_t start, size_t count) {
+    // The row's bytes in place, then each block copied out with the space after it
+    char hex[LOG_HEX_ROW_BYTES * 2];
+    memset(hex, '.', sizeof(hex));
+    if (start == 0 && count == LOG_HEX_ROW_BYTES) {
+        log_hex_encode(hex, data, count);
+    } else {
+        encode_bytes(hex + 2 * start, data, count);
+    }
+
+    for (int block = 0; block < LOG_HEX_ROW_BLOCKS; block++) {
+        memcpy(out, hex + block * LOG_HEX_BLOCK_BYTES * 2, LOG_HEX_BLOCK_BYTES * 2);
+        out += LOG_HEX_BLOCK_BYTES * 2;
+        if (block + 1 < LOG_HEX_ROW_BLOCKS) {
+            *out++ = ' ';
+        }
+    }
+}
@@ -0,0 +1,201 @@
+/**
+ * @file log_json.c
+ * @brief JSON text for the JSON-lines log sink.
+ */
+
+#include "log_json.h"
+#include "log_fields.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BYTES_OF(c) (0x0101010101010101ULL * (uint8_t)(c))
+#define HIGH_BITS 0x8080808080808080ULL
+
+/*
+ * What follows the backslash for each byte that must be escaped, 'u' for
+ * \u00XX, 0 for bytes written as they are.
+ */
+static const char escape_codes[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['"'] = '"',
+    ['\\'] = '\\'
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/**
+ * @brief Whether none of eight bytes needs escaping: none below 0x20, no quote, no backslash.
+ */
+static bool word_is_plain(uint64_t word) {
+    uint64_t quote = word ^ BYTES_OF('"');
+    uint64_t backslash = word ^ BYTES_OF('\\');
+    uint64_t found = ((word - BYTES_OF(0x20)) & ~word) |
+                     ((quote - BYTES_OF(1)) & ~quote) |
+                     ((backslash - BYTES_OF(1)) & ~backslash);
+    return (found & HIGH_BITS) == 0;
+}
+
+/**
+ * @brief Escapes as much of the text as fits.
+ * @param consumed Receives how much of the text was written.
+ * @return Bytes written.
+ */
+static size_t escape(char *out, size_t room, const char *text, size_t length, size_t *consumed) {
+    const unsigned char *start = (const unsigned char *)text;
+    const unsigned char *p = start;
+    const unsigned char *end = start + length;
+    size_t used = 0;
+
+    while (p < end) {
+        // The run of bytes needing nothing, eight at a time while it lasts
+        const unsigned char *run = p;
+        while (end - p >= 8) {
+            uint64_t word;
+            memcpy(&word, p, sizeof(word));
+            if (!word_is_plain(word)) {
+                break;
+            }
+            p += 8;
+        }
+        while (p < end && !escape_codes[*p]) {
+            p++;
+        }
+
+        size_t run_length = (size_t)(p - run);
+        if (run_length > room - used) {
+            // Cut before the start of the character that would be split
+            run_length = room - used;
+            while (run_length > 0 && (run[run_length] & 0xC0) == 0x80) {
+                run_length--;
+            }
+            memcpy(out + used, run, run_length);
+            *consumed = (size_t)(run - start) + run_length;
+            return used + run_length;
+        }
+        memcpy(out + used, run, run_length);
+        used += run_length;
+        if (p == end) {
+            break;
+        }
+
+        char code = escape_codes[*p];
+        size_t size = (code == 'u') ? 6 : 2;
+        if (size > room - used) {
+            break;
+        }
+        out[used] = '\\';
+        out[used + 1] = code;
+        if (code == 'u') {
+            out[used + 2] = '0';
+            out[used + 3] = '0';
+            out[used + 4] = hex_digits[*p >> 4];
+            out[used + 5] = hex_digits[*p & 0x0F];
+        }
+        used += size;
+        p++;
+    }
+    *consumed = (size_t)(p - start);
+    return used;
+}
+
+/**
+ * @copydoc log_json_escape
+ */
+size_t log_json_escape(char *out, size_t room, const char *text, size_t length) {
+    size_t consumed;
+    return escape(out, room, text, length, &consumed);
+}
+
+/**
+ * @brief Writes a field's value as JSON.
+ * @return Bytes written, or 0 if it did not fit.
+ */
+static size_t append_value(char *out, size_t room, const LogFieldView_T *field) {
+    char number[64];
+    const char *text = number;
+    size_t length;
+
+    switch (field->type) {
+    case LOG_FIELD_INT:
+        length = log_fields_format_uint(number,
+            field->value.i < 0 ? 0 - (uint64_t)field->value.i : (uint64_t)field->value.i, field->value.i < 0);
+        break;
+    case LOG_FIELD_UINT:
+        length = log_fields_format_uint(number, field->value.u, false);
+        break;
+    case LOG_FIELD_DOUBLE:
+        if (isfinite(field->value.d)) {
+            // The shortest of 15 or 17 digits that reads back as the same value
+            int written = snprintf(number, sizeof(number), "%.15g", field->value.d);
+            if (strtod(number, NULL) != field->value.d) {
+                written = snprintf(number, sizeof(number), "%.17g", field->value.d);
+            }
+            length = (written > 0 && (size_t)written < sizeof(number)) ? (size_t)written : 0;
+        } else {
+            text = "null"; // JSON has no NaN or infinity
+            length = 4;
+        }
+        break;
+    case LOG_FIELD_BOOL:
+        text = field->value.b ? "true" : "false";
+        length = strlen(text);
+        break;
+    default: {
+        if (room < 2) {
+            return 0;
+        }
+        size_t consumed;
+        size_t used = 1 + escape(out + 1, room - 2, field->text, field->text_length, &consumed);
+        if (consumed < field->text_length) {
+            return 0;
+        }
+        out[0] = '"';
+        out[used++] = '"';
+        return used;
+    }
+    }
+
+    if (length == 0 || length > room) {
+        return 0;
+    }
+    memcpy(out, text, length);
+    return length;
+}
+
+/**
+ * @copydoc log_json_append_fields
+ */
+size_t log_json_append_fields(char *out, size_t room, const char *fields, size_t length) {
+    const char *cursor = fields;
+    const char *end = fields + length;
+    LogFieldView_T field;
+    size_t used = 0;
+
+    while (log_fields_next(&cursor, end, &field)) {
+        // ,"key": then the value, all or nothing
+        size_t member = used;
+        if (room - member < 4) {
+            break;
+        }
+        out[member++] = ',';
+        out[member++] = '"';
+        size_t consumed;
+        member += escape(out + member, room - member - 2, field.key, field.key_length, &consumed);
+        if (consumed < field.key_length) {
+            break;
+        }
+        out[member++] = '"';
+        out[member++] = ':';
+        size_t value = append_value(out + member, room - member, &field);
+        if (value == 0) {
+            break;
+        }
+        used = member + value;
+    }
+    return used;
+}
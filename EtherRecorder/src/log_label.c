@@ -0,0 +1,84 @@
+/**
+ * @file log_label.c
+ * @brief Thread labels interned into small ids.
+ */
+
+#include "log_label.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+#include "logger.h"
+#include "platform_atomic.h"
+
+// Names are written once, before the count that covers them is released, so
+// readers need no lock. Labels are set as threads start, long before the
+// logger's mutex may exist, so writers serialise on a spin lock instead.
+static char label_names[LOG_LABEL_MAX][THREAD_LABEL_SIZE] = { "UNKNOWN" };
+static PlatformAtomic64_T label_count = 1;
+static PlatformAtomic64_T label_lock = 0;
+
+/**
+ * @brief Compares two labels without regard to case.
+ */
+static int labels_match(const char *a, const char *b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+/**
+ * @brief Looks up a label among the first @p count ids.
+ */
+static uint16_t find_label(const char *label, int64_t count) {
+    for (int64_t id = 1; id < count; id++) {
+        if (labels_match(label_names[id], label)) {
+            return (uint16_t)id;
+        }
+    }
+    return LOG_LABEL_UNKNOWN;
+}
+
+/**
+ * @copydoc log_label_intern
+ */
+uint16_t log_label_intern(const char *label) {
+    if (!label) {
+        return LOG_LABEL_UNKNOWN;
+    }
+
+    uint16_t id = find_label(label, platform_atomic_load_64(&label_count));
+    if (id != LOG_LABEL_UNKNOWN) {
+        return id;
+    }
+
+    int64_t unlocked = 0;
+    while (!platform_atomic_cas_64(&label_lock, &unlocked, 1)) {
+        unlocked = 0;
+        platform_cpu_relax();
+    }
+
+    // Another thread may have added it since we looked
+    int64_t count = platform_atomic_load_relaxed_64(&label_count);
+    id = find_label(label, count);
+    if (id == LOG_LABEL_UNKNOWN && count < LOG_LABEL_MAX) {
+        snprintf(label_names[count], THREAD_LABEL_SIZE, "%s", label);
+        platform_atomic_store_64(&label_count, count + 1);
+        id = (uint16_t)count;
+    }
+
+    platform_atomic_store_64(&label_lock, 0);
+    return id;
+}
+
+/**
+ * @copydoc log_label_name
+ */
+const char *log_label_name(uint16_t id) {
+    if (id >= platform_atomic_load_64(&label_count)) {
+        return label_names[LOG_LABEL_UNKNOWN];
+    }
+    return label_names[id];
+}
@@ -0,0 +1,129 @@
+/**
+ * @file log_level.c
+ * @brief Log levels per thread label.
+ */
+
+#include "log_level.h"
+
+#include "log_label.h"
+#include "platform_atomic.h"
+
+/**
+ * @brief A registered thread.
+ */
+typedef struct ThreadLevel_T {
+    PlatformAtomic64_T *level; // The thread's log_level_this_thread, NULL if the slot is free
+    uint16_t label_id;
+} ThreadLevel_T;
+
+THREAD_LOCAL PlatformAtomic64_T log_level_this_thread = LOG_LEVEL_UNSET;
+PlatformAtomic64_T log_level_global = LOG_DEBUG;
+
+static THREAD_LOCAL int this_thread_slot = -1;
+
+// Level + 1 for each label, 0 for labels following the global level. Changes
+// are rare and threads register as they start, possibly before the logger's
+// mutex exists, so everything here is guarded by a spin lock.
+static PlatformAtomic64_T label_levels[LOG_LABEL_MAX];
+static ThreadLevel_T registered[LOG_LEVEL_MAX_THREADS];
+static PlatformAtomic64_T registry_lock = 0;
+
+static void lock_registry(void) {
+    int64_t unlocked = 0;
+    while (!platform_atomic_cas_64(&registry_lock, &unlocked, 1)) {
+        unlocked = 0;
+        platform_cpu_relax();
+    }
+}
+
+static void unlock_registry(void) {
+    platform_atomic_store_64(&registry_lock, 0);
+}
+
+/**
+ * @brief The level a thread with this label should use. Registry lock held.
+ */
+static int effective_level(uint16_t label_id) {
+    int own = (int)platform_atomic_load_64(&label_levels[label_id]);
+    return own ? own - 1 : (int)platform_atomic_load_64(&log_level_global);
+}
+
+/**
+ * @brief Rewrites the level of every registered thread. Registry lock held.
+ */
+static void update_threads(void) {
+    for (int i = 0; i < LOG_LEVEL_MAX_THREADS; i++) {
+        if (registered[i].level) {
+            platform_atomic_store_64(registered[i].level, effective_level(registered[i].label_id));
+        }
+    }
+}
+
+/**
+ * @copydoc log_level_set_global
+ */
+void log_level_set_global(LogLevel level) {
+    lock_registry();
+    platform_atomic_store_64(&log_level_global, level);
+    update_threads();
+    unlock_registry();
+}
+
+/**
+ * @copydoc log_level_set_label
+ */
+bool log_level_set_label(const char *label, int level) {
+    uint16_t label_id = log_label_intern(label);
+    if (label_id == LOG_LABEL_UNKNOWN) {
+        return false;
+    }
+    lock_registry();
+    platform_atomic_store_64(&label_levels[label_id], (level == LOG_LEVEL_UNSET) ? 0 : level + 1);
+    update_threads();
+    unlock_registry();
+    return true;
+}
+
+/**
+ * @copydoc log_level_get_label
+ */
+int log_level_get_label(uint16_t label_id) {
+    int own = (label_id < LOG_LABEL_MAX) ? (int)platform_atomic_load_64(&label_levels[label_id]) : 0;
+    return own ? own - 1 : LOG_LEVEL_UNSET;
+}
+
+/**
+ * @copydoc log_level_register_thread
+ */
+void log_level_register_thread(uint16_t label_id) {
+    lock_registry();
+    if (this_thread_slot < 0) {
+        for (int i = 0; i < LOG_LEVEL_MAX_THREADS; i++) {
+            if (!registered[i].level) {
+                registered[i].level = &log_level_this_thread;
+                this_thread_slot = i;
+                break;
+            }
+        }
+    }
+    if (this_thread_slot >= 0) {
+        registered[this_thread_slot].label_id = label_id;
+        platform_atomic_store_64(&log_level_this_thread, effective_level(label_id));
+    }
+    // Otherwise the registry is full and the thread simply follows the global level
+    unlock_registry();
+}
+
+/**
+ * @copydoc log_level_unregister_thread
+ */
+void log_level_unregister_thread(void) {
+    if (this_thread_slot < 0) {
+        return;
+    }
+    lock_registry();
+    registered[this_thread_slot].level = NULL;
+    this_thread_slot = -1;
+    platform_atomic_store_64(&log_level_this_thread, LOG_LEVEL_UNSET);
+    unlock_registry();
+}
@@ -0,0 +1,126 @@
+/**
+ * @file log_metrics.c
+ * @brief Counters the logger keeps on itself.
+ */
+
+#include "log_metrics.h"
+
+static LogHistogram_T enqueue_latency;
+static LogHistogram_T publish_lag;
+static PlatformAtomic64_T overflow_events;
+
+// Depths are written only by the logger thread and read by anyone
+static PlatformAtomic64_T shared_queue_depth, shared_queue_high_water;
+static PlatformAtomic64_T thread_queue_depth, thread_queue_high_water;
+static PlatformAtomic64_T spill_depth, spill_high_water;
+
+/**
+ * @brief The bucket for a value: the number of bits it takes.
+ */
+static int bucket_of(uint64_t value) {
+    int bucket = 0;
+    while (value && bucket < LOG_METRICS_BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Adds a value to a histogram.
+ */
+static void histogram_add(LogHistogram_T *histogram, int64_t ticks) {
+    if (ticks < 0) {
+        ticks = 0; // Timestamps taken on different cores may disagree slightly
+    }
+    platform_atomic_fetch_add_64(&histogram->buckets[bucket_of((uint64_t)ticks)], 1);
+    platform_atomic_fetch_add_64(&histogram->count, 1);
+    int64_t max = platform_atomic_load_relaxed_64(&histogram->max);
+    while (ticks > max && !platform_atomic_cas_64(&histogram->max, &max, ticks)) {
+        // A failed swap has reloaded max
+    }
+}
+
+/**
+ * @brief Copies a histogram out.
+ */
+static void histogram_get(LogHistogram_T *histogram, uint64_t *buckets, uint64_t *count, uint64_t *max) {
+    for (int i = 0; i < LOG_METRICS_BUCKETS; i++) {
+        buckets[i] = (uint64_t)platform_atomic_load_relaxed_64(&histogram->buckets[i]);
+    }
+    *count = (uint64_t)platform_atomic_load_relaxed_64(&histogram->count);
+    *max = (uint64_t)platform_atomic_load_relaxed_64(&histogram->max);
+}
+
+/**
+ * @brief Stores a sampled depth and raises its high water.
+ */
+static void record_depth(PlatformAtomic64_T *depth, PlatformAtomic64_T *high_water, uint64_t value) {
+    platform_atomic_store_64(depth, (int64_t)value);
+    if ((int64_t)value > platform_atomic_load_relaxed_64(high_water)) {
+        platform_atomic_store_64(high_water, (int64_t)value);
+    }
+}
+
+/**
+ * @copydoc log_metrics_record_depths
+ */
+void log_metrics_record_depths(uint64_t shared_entries, uint64_t thread_bytes, uint64_t spill_entries) {
+    record_depth(&shared_queue_depth, &shared_queue_high_water, shared_entries);
+    record_depth(&thread_queue_depth, &thread_queue_high_water, thread_bytes);
+    record_depth(&spill_depth, &spill_high_water, spill_entries);
+}
+
+/**
+ * @copydoc log_metrics_record_enqueue
+ */
+void log_metrics_record_enqueue(int64_t ticks) {
+    histogram_add(&enqueue_latency, ticks);
+}
+
+/**
+ * @copydoc log_metrics_record_publish
+ */
+void log_metrics_record_publish(int64_t ticks) {
+    histogram_add(&publish_lag, ticks);
+}
+
+/**
+ * @copydoc log_metrics_record_overflow
+ */
+void log_metrics_record_overflow(void) {
+    platform_atomic_fetch_add_64(&overflow_events, 1);
+}
+
+/**
+ * @copydoc log_metrics_get
+ */
+void log_metrics_get(LogMetrics_T *metrics) {
+    metrics->shared_queue.current = (uint64_t)platform_atomic_load_64(&shared_queue_depth);
+    metrics->shared_queue.high_water = (uint64_t)platform_atomic_load_64(&shared_queue_high_water);
+    metrics->thread_queue.current = (uint64_t)platform_atomic_load_64(&thread_queue_depth);
+    metrics->thread_queue.high_water = (uint64_t)platform_atomic_load_64(&thread_queue_high_water);
+    metrics->spill.current = (uint64_t)platform_atomic_load_64(&spill_depth);
+    metrics->spill.high_water = (uint64_t)platform_atomic_load_64(&spill_high_water);
+    metrics->overflow_events = (uint64_t)platform_atomic_load_64(&overflow_events);
+    histogram_get(&enqueue_latency, metrics->enqueue, &metrics->enqueue_count, &metrics->enqueue_max);
+    histogram_get(&publish_lag, metrics->publish_lag, &metrics->publish_lag_count, &metrics->publish_lag_max);
+}
+
+/**
+ * @copydoc log_metrics_percentile
+ */
+uint64_t log_metrics_percentile(const uint64_t *buckets, uint64_t count, double fraction) {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t wanted = (uint64_t)((double)count * fraction);
+    uint64_t seen = 0;
+    for (int i = 0; i < LOG_METRICS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > wanted) {
+            return (uint64_t)1 << i;
+        }
+    }
+    return (uint64_t)1 << (LOG_METRICS_BUCKETS - 1);
+}
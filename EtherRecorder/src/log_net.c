@@ -0,0 +1,216 @@
+/**
+ * @file log_net.c
+ * @brief Network log sink: log lines streamed to a collector over UDP or TCP.
+ */
+
+#include "log_net.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform_sockets.h" // Before windows.h, which would otherwise bring in the old winsock.h
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#endif // _WIN32
+#include <windows.h>
+
+#include "common_socket.h"
+#include "platform_atomic.h"
+#include "platform_utils.h"
+
+/**
+ * @brief A network sink.
+ */
+struct LogNetSink_T {
+    LogNetProtocol protocol;
+    char host[256];
+    int port;
+    LogSink_T *sink;              // The ring and the sender
+
+    SOCKET socket;                // The sender's
+    volatile bool connected;
+    int64_t next_connect_ms;
+    PlatformAtomic64_T connects;
+};
+
+/**
+ * @brief Milliseconds on the high resolution clock.
+ */
+static int64_t now_ms(void) {
+    LARGE_INTEGER now, frequency;
+    get_high_resolution_timestamp(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (now.QuadPart / frequency.QuadPart) * 1000 + (now.QuadPart % frequency.QuadPart) * 1000 / frequency.QuadPart;
+}
+
+/**
+ * @brief Closes the socket, if open.
+ */
+static void disconnect(LogNetSink_T *net) {
+    close_socket(&net->socket);
+    net->connected = false;
+    net->next_connect_ms = now_ms() + LOG_NET_RECONNECT_MS;
+}
+
+/**
+ * @brief Opens the socket and connects it; at most once per LOG_NET_RECONNECT_MS.
+ * A UDP socket is connected too, so send() serves both and the collector's
+ * address is only looked up once.
+ * @return true if the sink can send.
+ */
+static bool connect_if_due(void *context) {
+    LogNetSink_T *net = (LogNetSink_T *)context;
+    if (net->connected) {
+        return true;
+    }
+    if (now_ms() < net->next_connect_ms) {
+        return false;
+    }
+
+    bool is_tcp = (net->protocol == LOG_NET_TCP);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)net->port);
+
+    struct addrinfo hints, *resolved = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = is_tcp ? SOCK_STREAM : SOCK_DGRAM;
+    if (getaddrinfo(net->host, NULL, &hints, &resolved) != 0 || !resolved) {
+        disconnect(net);
+        return false;
+    }
+    address.sin_addr = ((struct sockaddr_in *)resolved->ai_addr)->sin_addr;
+    freeaddrinfo(resolved);
+
+    net->socket = socket(AF_INET, is_tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+    if (net->socket == INVALID_SOCKET) {
+        disconnect(net);
+        return false;
+    }
+
+    bool connected;
+    if (is_tcp) {
+        connected = connect_with_timeout(net->socket, &address, LOG_NET_CONNECT_TIMEOUT_S) == PLATFORM_SOCKET_SUCCESS;
+        if (connected) {
+            // A stalled collector fails the send rather than holding up close for ever
+#ifdef _WIN32
+            DWORD timeout = LOG_NET_CONNECT_TIMEOUT_S * 1000;
+#else // !_WIN32
+            struct timeval timeout = { LOG_NET_CONNECT_TIMEOUT_S, 0 };
+#endif // _WIN32
+            setsockopt(net->socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+        }
+    } else {
+        connected = connect(net->socket, (struct sockaddr *)&address, sizeof(address)) == 0;
+    }
+    if (!connected) {
+        disconnect(net);
+        return false;
+    }
+    net->connected = true;
+    if (is_tcp) {
+        platform_atomic_fetch_add_64(&net->connects, 1);
+    }
+    return true;
+}
+
+/**
+ * @brief Sends one batch whole; a TCP sink that fails reconnects later for the rest.
+ * @return false if any of it could not be sent.
+ */
+static bool send_batch(void *context, const char *data, size_t length) {
+    LogNetSink_T *net = (LogNetSink_T *)context;
+    while (length > 0) {
+        int sent = (int)send(net->socket, data, (int)length, 0);
+        if (sent <= 0) {
+            if (net->protocol == LOG_NET_TCP) {
+                disconnect(net);
+            }
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+static const LogSinkOps_T net_sink_ops = { connect_if_due, send_batch, NULL };
+
+/**
+ * @copydoc log_net_protocol_from_string
+ */
+LogNetProtocol log_net_protocol_from_string(const char *name) {
+    if (name && str_cmp_nocase(name, "udp") == 0) return LOG_NET_UDP;
+    if (name && str_cmp_nocase(name, "tcp") == 0) return LOG_NET_TCP;
+    return LOG_NET_OFF;
+}
+
+/**
+ * @copydoc log_net_open
+ */
+LogNetSink_T *log_net_open(LogNetProtocol protocol, const char *host, int port,
+                           size_t batch_bytes, int flush_interval_ms, size_t queue_bytes) {
+    if (protocol == LOG_NET_OFF || !host || !*host || port <= 0 || port > 65535) {
+        return NULL;
+    }
+    LogNetSink_T *net = (LogNetSink_T *)calloc(1, sizeof(*net));
+    if (!net) {
+        return NULL;
+    }
+    net->protocol = protocol;
+    snprintf(net->host, sizeof(net->host), "%s", host);
+    net->port = port;
+    net->socket = INVALID_SOCKET;
+    platform_atomic_init_64(&net->connects, 0);
+
+    if (!batch_bytes) {
+        batch_bytes = (protocol == LOG_NET_UDP) ? LOG_NET_UDP_BATCH : LOG_NET_TCP_BATCH;
+    }
+    initialise_sockets(); // Counted on Windows, so this pairs with the cleanup in close
+    net->sink = log_sink_open(&net_sink_ops, net, batch_bytes, flush_interval_ms, queue_bytes);
+    if (!net->sink) {
+        cleanup_sockets();
+        free(net);
+        return NULL;
+    }
+    return net;
+}
+
+/**
+ * @copydoc log_net_write
+ */
+bool log_net_write(LogNetSink_T *sink, const char *data, size_t length) {
+    return log_sink_write(sink->sink, data, length);
+}
+
+/**
+ * @copydoc log_net_wake
+ */
+void log_net_wake(LogNetSink_T *sink) {
+    log_sink_wake(sink->sink);
+}
+
+/**
+ * @copydoc log_net_get_stats
+ */
+void log_net_get_stats(LogNetSink_T *sink, LogNetStats_T *stats) {
+    log_sink_get_stats(sink->sink, &stats->sink);
+    stats->connects = (uint64_t)platform_atomic_load_64(&sink->connects);
+    stats->connected = sink->connected;
+}
+
+/**
+ * @copydoc log_net_close
+ */
+void log_net_close(LogNetSink_T *sink) {
+    if (!sink) {
+        return;
+    }
+    log_sink_close(sink->sink);
+    close_socket(&sink->socket);
+    cleanup_sockets();
+    free(sink);
+}
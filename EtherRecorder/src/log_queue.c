@@ -1,83 +1,111 @@
 #include "log_queue.h"
-#include "logger.h"
-#include "platform_mutex.h"
-//
-//#include <string.h>
-//#include <stdio.h>
-// #include <windows.h> // Include Windows API for atomic operations
 
-//#include "platform_threads.h"
-#include "platform_utils.h"
-//#include "app_thread.h" // Include the app_thread header
+#include <string.h>
+
+#include "logger.h"
+#include "platform_atomic.h"
 
-extern PlatformMutex_T logging_mutex; // Mutex for thread safety
 LogQueue_T global_log_queue; // Define the log queue
 
 /**
  * @copydoc log_queue_init
  */
 void log_queue_init(LogQueue_T *queue) {
-    queue->head = 0;
-    queue->tail = 0;  
+    platform_atomic_init_64(&queue->head, 0);
+    platform_atomic_init_64(&queue->tail, 0);
+    platform_atomic_init_64(&queue->full_count, 0);
+    // Each slot starts out ready for the position that maps onto it
+    for (int64_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+        platform_atomic_init_64(&queue->slots[i].sequence, i);
+    }
 }
 
+/**
+ * @copydoc log_queue_push
+ */
 bool log_queue_push(LogQueue_T *log_queue, const LogEntry_T *entry) {
     if (!entry) {
         return false; // Prevent null pointer access
     }
-    if (entry->thread_label == NULL) {
-        return false; // Prevent logging of invalid thread label
-    }
-    long head = log_queue->head;
-    long next_head = (head + 1) % LOG_QUEUE_SIZE;
-
-    // Check if the queue is full
-    if (next_head == log_queue->tail) {
-        lock_mutex(&logging_mutex);
-        // calling logger_log would be recursive, and lead to probable stack overflow
-        int purge_count = 3;
-        LogEntry_T entry_1;
-        char msg[LOG_MSG_BUFFER_SIZE];
-        snprintf(msg, sizeof(msg), "Log queue overflow. Publishing oldest %d log entries immediately", purge_count);
-        create_log_entry(&entry_1, LOG_ERROR, msg);
-        log_now(&entry_1);
-        while (purge_count > 0) {
-            LogEntry_T popped_entry;
-            log_queue_pop(log_queue, &popped_entry);
-            log_now(&popped_entry);
-            purge_count--;
+
+    LogQueueSlot_T *slot;
+    int64_t position = platform_atomic_load_64(&log_queue->head);
+
+    for (;;) {
+        slot = &log_queue->slots[position & LOG_QUEUE_MASK];
+        int64_t sequence = platform_atomic_load_64(&slot->sequence);
+        int64_t difference = sequence - position;
+
+        if (difference == 0) {
+            // Slot is free for this position, try to claim it
+            if (platform_atomic_cas_64(&log_queue->head, &position, position + 1)) {
+                break;
+            }
+            // Another producer won, position now holds the current head
+        } else if (difference < 0) {
+            // The consumer has not yet released this slot from the previous lap
+            platform_atomic_fetch_add_64(&log_queue->full_count, 1);
+            return false;
+        } else {
+            // Another producer claimed it since we read head
+            position = platform_atomic_load_64(&log_queue->head);
         }
-        LogEntry_T entry_2;
-        create_log_entry(&entry_2, LOG_ERROR, "Log queue overflow. Purged complete");
-        unlock_mutex(&logging_mutex);
     }
 
-    // Copy the pre-constructed entry into the queue
-    log_queue->entries[head] = *entry; // Struct assignment (safe and efficient)
-
-    // Atomically update the head index
-    InterlockedExchange(&log_queue->head, next_head);
+    // The slot is exclusively ours until the sequence is published
+    memcpy(&slot->entry, entry, LOG_ENTRY_SIZE(entry));
+    platform_atomic_store_64(&slot->sequence, position + 1);
 
     return true; // Successfully added log entry
 }
 
 
+/**
+ * @copydoc log_queue_peek
+ */
+const LogEntry_T *log_queue_peek(LogQueue_T *queue) {
+    int64_t position = platform_atomic_load_relaxed_64(&queue->tail);
+    LogQueueSlot_T *slot = &queue->slots[position & LOG_QUEUE_MASK];
+
+    if (platform_atomic_load_64(&slot->sequence) != position + 1) {
+        // Queue is empty, or the producer holding this slot has not published yet
+        return NULL;
+    }
+    return &slot->entry;
+}
+
+/**
+ * @copydoc log_queue_consume
+ */
+void log_queue_consume(LogQueue_T *queue) {
+    int64_t position = platform_atomic_load_relaxed_64(&queue->tail);
+    LogQueueSlot_T *slot = &queue->slots[position & LOG_QUEUE_MASK];
+
+    // Hand the slot back to producers for the next lap, then advance
+    platform_atomic_store_64(&slot->sequence, position + LOG_QUEUE_SIZE);
+    platform_atomic_store_64(&queue->tail, position + 1);
+}
+
 /**
  * @copydoc log_queue_pop
  */
 bool log_queue_pop(LogQueue_T *queue, LogEntry_T *entry) {
-    LONG tail = queue->tail;
-
-    if (tail == queue->head) {
-        // Queue is empty
+    const LogEntry_T *oldest = log_queue_peek(queue);
+    if (!oldest) {
         return false;
     }
 
-    *entry = queue->entries[tail];
-
-    // Atomically update the tail index
-    InterlockedExchange(&queue->tail, (tail + 1) % LOG_QUEUE_SIZE);
+    memcpy(entry, oldest, LOG_ENTRY_SIZE(oldest));
+    log_queue_consume(queue);
     return true;
 }
 
-
+/**
+ * @copydoc log_queue_get_stats
+ */
+void log_queue_get_stats(LogQueue_T *queue, LogQueueStats_T *stats) {
+    // Positions only ever increase, so they double as push/pop totals
+    stats->dequeued = (uint64_t)platform_atomic_load_64(&queue->tail);
+    stats->enqueued = (uint64_t)platform_atomic_load_64(&queue->head);
+    stats->full_count = (uint64_t)platform_atomic_load_64(&queue->full_count);
+}
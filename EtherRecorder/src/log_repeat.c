@@ -0,0 +1,102 @@
+/**
+ * @file log_repeat.c
+ * @brief Collapsing of identical consecutive log messages.
+ */
+
+#include "log_repeat.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log_label.h"
+
+/**
+ * @brief The last message published for one label.
+ */
+typedef struct LogRepeat_T {
+    LogEntry_T last;           // As queued, only LOG_ENTRY_SIZE of it in use
+    bool valid;                // last holds a message
+    uint32_t count;            // Repeats held back since last or the last summary
+    int64_t held_since;        // Timestamp of the first of them
+    LARGE_INTEGER latest;      // Timestamp of the most recent
+} LogRepeat_T;
+
+static LogRepeat_T repeats[LOG_LABEL_MAX];
+static int labels_holding = 0;
+
+/**
+ * @brief Whether two entries would print the same message at the same level.
+ */
+static bool same_message(const LogEntry_T *a, const LogEntry_T *b) {
+    return !a->blob && !b->blob && // Each dump is its own
+           a->level == b->level &&
+           a->format == b->format &&
+           a->message_length == b->message_length &&
+           a->fields_length == b->fields_length &&
+           memcmp(a->message, b->message, a->message_length + 1 + a->fields_length) == 0;
+}
+
+/**
+ * @brief Fills in the summary of a label's held repeats and clears the count.
+ */
+static void take_summary(LogRepeat_T *repeat, LogEntry_T *summary) {
+    summary->level = repeat->last.level;
+    summary->timestamp = repeat->latest;
+    summary->label_id = repeat->last.label_id;
+    summary->fields_length = 0;
+    summary->blob = 0;
+    summary->format = NULL;
+    int length = snprintf(summary->message, sizeof(summary->message),
+        "last message repeated %u time%s", repeat->count, repeat->count == 1 ? "" : "s");
+    summary->message_length = (length > 0) ? (uint32_t)length : 0;
+    repeat->count = 0;
+    labels_holding--;
+}
+
+/**
+ * @copydoc log_repeat_check
+ */
+LogRepeatResult log_repeat_check(const LogEntry_T *entry, LogEntry_T *summary) {
+    LogRepeat_T *repeat = &repeats[entry->label_id < LOG_LABEL_MAX ? entry->label_id : LOG_LABEL_UNKNOWN];
+
+    if (repeat->valid && same_message(entry, &repeat->last)) {
+        if (repeat->count++ == 0) {
+            repeat->held_since = entry->timestamp.QuadPart;
+            labels_holding++;
+        }
+        repeat->latest = entry->timestamp;
+        return LOG_REPEAT_HELD;
+    }
+
+    LogRepeatResult result = LOG_REPEAT_PUBLISH;
+    if (repeat->count > 0) {
+        take_summary(repeat, summary);
+        result = LOG_REPEAT_PUBLISH_AFTER_SUMMARY;
+    }
+    memcpy(&repeat->last, entry, LOG_ENTRY_SIZE(entry));
+    repeat->valid = true;
+    return result;
+}
+
+/**
+ * @copydoc log_repeat_take_due
+ */
+bool log_repeat_take_due(int64_t cutoff, LogEntry_T *summary) {
+    if (labels_holding == 0) {
+        return false;
+    }
+    for (int i = 0; i < LOG_LABEL_MAX; i++) {
+        if (repeats[i].count > 0 && repeats[i].held_since < cutoff) {
+            take_summary(&repeats[i], summary);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @copydoc log_repeat_held
+ */
+int log_repeat_held(void) {
+    return labels_holding;
+}
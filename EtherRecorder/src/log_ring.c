@@ -0,0 +1,113 @@
+/**
+ * @file log_ring.c
+ * @brief In-memory ring of the most recent log lines.
+ */
+
+#include "log_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_HEADER_SIZE sizeof(uint32_t) // Each line is its length, then its bytes
+
+/**
+ * @brief Copies into the ring at a position, wrapping at its end.
+ */
+static void ring_put(LogRing_T *ring, uint64_t position, const void *data, size_t length) {
+    size_t offset = (size_t)(position & (ring->size - 1));
+    size_t first = ring->size - offset;
+    if (first >= length) {
+        memcpy(ring->data + offset, data, length);
+    } else {
+        memcpy(ring->data + offset, data, first);
+        memcpy(ring->data, (const char *)data + first, length - first);
+    }
+}
+
+/**
+ * @brief Copies out of the ring from a position, wrapping at its end.
+ */
+static void ring_get(const LogRing_T *ring, uint64_t position, void *data, size_t length) {
+    size_t offset = (size_t)(position & (ring->size - 1));
+    size_t first = ring->size - offset;
+    if (first >= length) {
+        memcpy(data, ring->data + offset, length);
+    } else {
+        memcpy(data, ring->data + offset, first);
+        memcpy((char *)data + first, ring->data, length - first);
+    }
+}
+
+/**
+ * @copydoc log_ring_init
+ */
+bool log_ring_init(LogRing_T *ring, size_t bytes) {
+    memset(ring, 0, sizeof(*ring));
+    size_t size = 1;
+    while (size < bytes) {
+        size <<= 1;
+    }
+    ring->data = (char *)malloc(size);
+    if (!ring->data) {
+        return false;
+    }
+    ring->size = size;
+    return true;
+}
+
+/**
+ * @copydoc log_ring_write
+ */
+void log_ring_write(LogRing_T *ring, const char *data, size_t length) {
+    size_t size = RECORD_HEADER_SIZE + length;
+    if (!ring->data || size > ring->size) {
+        return;
+    }
+    // Let go of the oldest lines until this one fits
+    while (ring->size - (size_t)(ring->head - ring->tail) < size) {
+        uint32_t oldest;
+        ring_get(ring, ring->tail, &oldest, sizeof(oldest));
+        ring->tail += RECORD_HEADER_SIZE + oldest;
+        ring->lines_overwritten++;
+    }
+    uint32_t length32 = (uint32_t)length;
+    ring_put(ring, ring->head, &length32, sizeof(length32));
+    ring_put(ring, ring->head + RECORD_HEADER_SIZE, data, length);
+    ring->head += size;
+    ring->lines++;
+}
+
+/**
+ * @copydoc log_ring_copy
+ */
+size_t log_ring_copy(const LogRing_T *ring, char *out, size_t room) {
+    if (!ring->data) {
+        return 0;
+    }
+    // Skip the oldest lines until the rest fit; the records' headers are not copied
+    uint64_t position = ring->tail;
+    size_t text = (size_t)(ring->head - ring->tail) - (size_t)((ring->lines - ring->lines_overwritten) * RECORD_HEADER_SIZE);
+    while (text > room) {
+        uint32_t length;
+        ring_get(ring, position, &length, sizeof(length));
+        position += RECORD_HEADER_SIZE + length;
+        text -= length;
+    }
+    size_t copied = 0;
+    while (position != ring->head) {
+        uint32_t length;
+        ring_get(ring, position, &length, sizeof(length));
+        ring_get(ring, position + RECORD_HEADER_SIZE, out + copied, length);
+        copied += length;
+        position += RECORD_HEADER_SIZE + length;
+    }
+    return copied;
+}
+
+/**
+ * @copydoc log_ring_free
+ */
+void log_ring_free(LogRing_T *ring) {
+    free(ring->data);
+    memset(ring, 0, sizeof(*ring));
+}
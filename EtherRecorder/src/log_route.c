@@ -0,0 +1,180 @@
+/**
+ * @file log_route.c
+ * @brief Which sinks each entry goes to, by level and thread label.
+ */
+
+#include "log_route.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "log_label.h"
+#include "platform_utils.h"
+
+#define ROUTE_LEVELS (LOG_FATAL + 1)
+
+typedef struct LogRouteRule_T {
+    LogLevel level;   // This and above
+    char label[64];   // Empty for any
+    bool prefix;      // label ended in '*'
+    uint8_t sinks;
+} LogRouteRule_T;
+
+static LogRouteRule_T g_rules[LOG_ROUTE_MAX_RULES];
+static int g_rule_count = 0;
+static uint8_t g_default_sinks = LOG_SINK_FILE | LOG_SINK_CONSOLE;
+static LogLevel g_floors[8];     // Per sink bit, the lowest level it takes whatever the rules say
+
+// Sinks per label and level, filled in for a label the first time it is looked up
+static uint8_t g_routes[LOG_LABEL_MAX][ROUTE_LEVELS];
+static bool g_resolved[LOG_LABEL_MAX];
+
+/**
+ * @brief Forgets every label's routes, to be worked out again from the rules.
+ */
+static void invalidate(void) {
+    memset(g_resolved, 0, sizeof(g_resolved));
+}
+
+/**
+ * @brief Compares a label with a rule's, without regard to case.
+ */
+static bool label_matches(const LogRouteRule_T *rule, const char *label) {
+    if (!rule->label[0]) {
+        return true;
+    }
+    size_t length = strlen(rule->label);
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)label[i]) != tolower((unsigned char)rule->label[i])) {
+            return false; // Also stops at the end of a shorter label
+        }
+    }
+    return rule->prefix || label[length] == '\0';
+}
+
+/**
+ * @brief Works out a label's sinks at each level from the rules.
+ */
+static void resolve(uint16_t label_id) {
+    const char *label = log_label_name(label_id);
+    for (int level = 0; level < ROUTE_LEVELS; level++) {
+        g_routes[label_id][level] = g_rule_count ? 0 : g_default_sinks;
+    }
+    for (int i = 0; i < g_rule_count; i++) {
+        if (label_matches(&g_rules[i], label)) {
+            for (int level = g_rules[i].level; level < ROUTE_LEVELS; level++) {
+                g_routes[label_id][level] |= g_rules[i].sinks;
+            }
+        }
+    }
+    for (int bit = 0; bit < 8; bit++) {
+        for (int level = 0; level < (int)g_floors[bit]; level++) {
+            g_routes[label_id][level] &= (uint8_t)~(1u << bit);
+        }
+    }
+    g_resolved[label_id] = true;
+}
+
+/**
+ * @brief Reads a comma separated list of sink names.
+ * @return The mask, 0 if any name is not a sink.
+ */
+static uint8_t sinks_from_string(char *names) {
+    uint8_t sinks = 0;
+    for (char *name = strtok(names, ","); name; name = strtok(NULL, ",")) {
+        if (str_cmp_nocase(name, "file") == 0) sinks |= LOG_SINK_FILE;
+        else if (str_cmp_nocase(name, "console") == 0) sinks |= LOG_SINK_CONSOLE;
+        else if (str_cmp_nocase(name, "network") == 0) sinks |= LOG_SINK_NETWORK;
+        else if (str_cmp_nocase(name, "ring") == 0) sinks |= LOG_SINK_RING;
+        else return 0;
+    }
+    return sinks;
+}
+
+/**
+ * @copydoc log_route_init
+ */
+void log_route_init(uint8_t default_sinks) {
+    g_rule_count = 0;
+    g_default_sinks = default_sinks;
+    invalidate();
+}
+
+/**
+ * @copydoc log_route_set_default
+ */
+void log_route_set_default(uint8_t default_sinks) {
+    g_default_sinks = default_sinks;
+    invalidate();
+}
+
+/**
+ * @copydoc log_route_set_floor
+ */
+void log_route_set_floor(uint8_t sinks, LogLevel level) {
+    for (int bit = 0; bit < 8; bit++) {
+        if (sinks & (1u << bit)) {
+            g_floors[bit] = level;
+        }
+    }
+    invalidate();
+}
+
+/**
+ * @copydoc log_route_add
+ */
+bool log_route_add(const char *rule) {
+    if (!rule || g_rule_count == LOG_ROUTE_MAX_RULES) {
+        return false;
+    }
+    char level[32], label[64], sinks[128];
+    if (sscanf(rule, "%31s %63s %127s", level, label, sinks) != 3) {
+        return false;
+    }
+
+    LogRouteRule_T* added = &g_rules[g_rule_count];
+    added->level = log_level_from_string(level, (LogLevel)ROUTE_LEVELS);
+    added->sinks = sinks_from_string(sinks);
+    if (added->level == (LogLevel)ROUTE_LEVELS || !added->sinks) {
+        return false;
+    }
+    size_t length = strlen(label);
+    added->prefix = (label[length - 1] == '*');
+    if (added->prefix) {
+        label[--length] = '\0'; // "*" alone leaves an empty label, which matches any
+    }
+    snprintf(added->label, sizeof(added->label), "%s", label);
+
+    g_rule_count++;
+    invalidate();
+    return true;
+}
+
+/**
+ * @copydoc log_route_lookup
+ */
+uint8_t log_route_lookup(LogLevel level, uint16_t label_id) {
+    if (label_id >= LOG_LABEL_MAX || (int)level < 0 || (int)level >= ROUTE_LEVELS) {
+        return g_default_sinks;
+    }
+    if (!g_resolved[label_id]) {
+        resolve(label_id);
+    }
+    return g_routes[label_id][level];
+}
+
+/**
+ * @copydoc log_route_uses
+ */
+bool log_route_uses(uint8_t sink) {
+    if (!g_rule_count) {
+        return (g_default_sinks & sink) != 0;
+    }
+    for (int i = 0; i < g_rule_count; i++) {
+        if (g_rules[i].sinks & sink) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file log_segment.c
+ * @brief Sequence-numbered segments of a log file.
+ */
+
+#include "log_segment.h"
+#include "log_codec.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Sequence numbers of the segments found on disk.
+ */
+typedef struct SegmentScan_T {
+    const LogSegments_T *segments;
+    uint32_t lowest;
+    uint32_t highest; // 0 if none were found
+} SegmentScan_T;
+
+/**
+ * @brief Opens a segment; @p append keeps what is already there.
+ */
+static FILE *open_segment(const LogSegments_T *segments, uint32_t sequence, bool append) {
+    char name[MAX_PATH];
+    log_segments_name(segments, sequence, name, sizeof(name));
+    static const char *modes[2][2][2] = {
+        { { "w", "a" },   { "wb", "ab" } },
+        { { "w+", "a+" }, { "w+b", "a+b" } }
+    }; // [read_write][binary][append]
+    return fopen(name, modes[segments->read_write][segments->binary][append]);
+}
+
+/**
+ * @brief The size of a segment on disk, compressed or not, 0 if it is not there.
+ */
+static uint64_t segment_size(const LogSegments_T *segments, uint32_t sequence) {
+    char name[MAX_PATH];
+    struct stat st;
+    uint64_t size = 0;
+    log_segments_name(segments, sequence, name, sizeof(name));
+    if (stat(name, &st) == 0) {
+        size += (uint64_t)st.st_size;
+    }
+    strncat(name, LOG_CODEC_SUFFIX, sizeof(name) - strlen(name) - 1);
+    if (stat(name, &st) == 0) {
+        size += (uint64_t)st.st_size;
+    }
+    return size;
+}
+
+/**
+ * @brief Deletes a segment and any compressed copy of it, returning their size.
+ */
+static uint64_t delete_segment(const LogSegments_T *segments, uint32_t sequence) {
+    char name[MAX_PATH];
+    uint64_t size = segment_size(segments, sequence);
+    log_segments_name(segments, sequence, name, sizeof(name));
+    remove(name);
+    strncat(name, LOG_CODEC_SUFFIX, sizeof(name) - strlen(name) - 1);
+    remove(name);
+    return size;
+}
+
+/**
+ * @brief Notes the sequence number of a file if it is one of our segments.
+ */
+static void scan_segment(const char *name, void *context) {
+    SegmentScan_T *scan = (SegmentScan_T *)context;
+    const LogSegments_T *segments = scan->segments;
+    size_t stem_length = strlen(segments->stem);
+
+    if (strncmp(name, segments->stem, stem_length) != 0 || name[stem_length] != '.') {
+        return;
+    }
+    const char *digits = name + stem_length + 1;
+    const char *end = digits;
+    while (isdigit((unsigned char)*end)) {
+        end++;
+    }
+    if (end == digits || (size_t)(end - digits) > 9) {
+        return;
+    }
+    // Either the segment as written or its compressed copy
+    size_t extension_length = strlen(segments->extension);
+    if (strncmp(end, segments->extension, extension_length) != 0 ||
+        (end[extension_length] != '\0' && strcmp(end + extension_length, LOG_CODEC_SUFFIX) != 0)) {
+        return;
+    }
+
+    uint32_t sequence = (uint32_t)strtoul(digits, NULL, 10);
+    if (sequence == 0) {
+        return;
+    }
+    if (scan->highest == 0 || sequence < scan->lowest) {
+        scan->lowest = sequence;
+    }
+    if (sequence > scan->highest) {
+        scan->highest = sequence;
+    }
+}
+
+/**
+ * @copydoc log_segments_init
+ */
+void log_segments_init(LogSegments_T *segments, const char *file_name, bool binary) {
+    memset(segments, 0, sizeof(*segments));
+    segments->binary = binary;
+
+    const char *base = file_name;
+    for (const char *p = file_name; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            base = p + 1;
+        }
+    }
+    if (base > file_name) {
+        size_t length = (size_t)(base - file_name - 1);
+        if (length >= sizeof(segments->directory)) {
+            length = sizeof(segments->directory) - 1;
+        }
+        memcpy(segments->directory, file_name, length);
+        segments->directory[length] = '\0';
+    }
+
+    const char *dot = strrchr(base, '.');
+    if (dot && dot != base && strlen(dot) < sizeof(segments->extension)) {
+        snprintf(segments->extension, sizeof(segments->extension), "%s", dot);
+    } else {
+        dot = base + strlen(base);
+    }
+    size_t stem_length = (size_t)(dot - base);
+    if (stem_length >= sizeof(segments->stem)) {
+        stem_length = sizeof(segments->stem) - 1;
+    }
+    memcpy(segments->stem, base, stem_length);
+    segments->stem[stem_length] = '\0';
+}
+
+/**
+ * @copydoc log_segments_name
+ */
+void log_segments_name(const LogSegments_T *segments, uint32_t sequence, char *buffer, size_t size) {
+    if (segments->directory[0]) {
+        snprintf(buffer, size, "%s%c%s.%0*u%s", segments->directory, PATH_SEPARATOR,
+            segments->stem, LOG_SEGMENT_DIGITS, sequence, segments->extension);
+    } else {
+        snprintf(buffer, size, "%s.%0*u%s", segments->stem, LOG_SEGMENT_DIGITS, sequence, segments->extension);
+    }
+}
+
+/**
+ * @copydoc log_segments_open
+ */
+FILE *log_segments_open(LogSegments_T *segments, bool purge, uint64_t *existing_bytes) {
+    *existing_bytes = 0;
+
+    if (segments->current == 0) {
+        // First open this run: carry on from the newest segment left behind
+        SegmentScan_T scan = { segments, 0, 0 };
+        platform_list_directory(segments->directory, scan_segment, &scan);
+
+        if (scan.highest == 0) {
+            segments->first = segments->current = 1;
+        } else if (purge) {
+            for (uint32_t sequence = scan.lowest; sequence <= scan.highest; sequence++) {
+                delete_segment(segments, sequence);
+            }
+            segments->first = segments->current = 1;
+        } else {
+            segments->first = scan.lowest;
+            segments->current = scan.highest;
+        }
+    }
+
+    FILE *stream = open_segment(segments, segments->current, true);
+    if (stream && fseek(stream, 0, SEEK_END) == 0) {
+        long size = ftell(stream);
+        *existing_bytes = (size > 0) ? (uint64_t)size : 0;
+    }
+    return stream;
+}
+
+/**
+ * @copydoc log_segments_prepare_next
+ */
+bool log_segments_prepare_next(LogSegments_T *segments) {
+    if (!segments->next) {
+        segments->next = open_segment(segments, segments->current + 1, false);
+    }
+    return segments->next != NULL;
+}
+
+/**
+ * @copydoc log_segments_advance
+ */
+FILE *log_segments_advance(LogSegments_T *segments) {
+    FILE *stream = segments->next ? segments->next : open_segment(segments, segments->current + 1, false);
+    segments->next = NULL;
+    if (stream) {
+        segments->current++;
+    }
+    return stream;
+}
+
+/**
+ * @copydoc log_segments_prune
+ */
+void log_segments_prune(LogSegments_T *segments, uint32_t max_segments, uint64_t max_total_bytes) {
+    if (max_segments > 0) {
+        while (segments->current - segments->first + 1 > max_segments) {
+            delete_segment(segments, segments->first++);
+        }
+    }
+
+    if (max_total_bytes > 0) {
+        // Only done on rotation, so the sizes are simply read back from the files
+        uint64_t total = 0;
+        for (uint32_t sequence = segments->first; sequence <= segments->current; sequence++) {
+            total += segment_size(segments, sequence);
+        }
+        while (total > max_total_bytes && segments->first < segments->current) {
+            uint64_t size = delete_segment(segments, segments->first++);
+            total = (size < total) ? total - size : 0;
+        }
+    }
+}
+
+/**
+ * @copydoc log_segments_close
+ */
+void log_segments_close(LogSegments_T *segments) {
+    if (segments->next) {
+        fclose(segments->next);
+        segments->next = NULL;
+        delete_segment(segments, segments->current + 1);
+    }
+}
@@ -0,0 +1,251 @@
+/**
+ * @file log_sink.c
+ * @brief A sink's own queue and writer thread.
+ */
+
+#include "log_sink.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform_atomic.h"
+#include "platform_mutex.h"
+#include "platform_threads.h"
+
+/**
+ * @brief What precedes each line in the ring.
+ */
+typedef struct RecordHeader_T {
+    uint32_t length;
+    uint32_t skipped; // Lines dropped just before this one, for the writer to mark
+} RecordHeader_T;
+
+#define RECORD_HEADER_SIZE sizeof(RecordHeader_T)
+
+/**
+ * @brief A sink.
+ */
+struct LogSink_T {
+    const LogSinkOps_T *ops;
+    void *context;
+    size_t batch_bytes;
+    int flush_interval_ms;
+
+    char *ring;
+    size_t ring_size;             // A power of two
+    PlatformAtomic64_T head;      // Bytes ever queued; the logger thread's
+    PlatformAtomic64_T tail;      // Bytes ever taken off; the writer's
+    uint64_t signalled_head;      // head when the writer was last woken; the logger thread's
+    PlatformAtomic64_T skipped;   // Dropped since the last line queued, carried by the next
+
+    PlatformThread_T thread;
+    PlatformEvent_T wake;
+    volatile bool stopping;
+
+    char *batch;                  // The writer's
+
+    PlatformAtomic64_T lines_queued;
+    PlatformAtomic64_T lines_dropped;
+    PlatformAtomic64_T bytes_written;
+    PlatformAtomic64_T writes;
+    PlatformAtomic64_T write_failures;
+};
+
+/**
+ * @brief Copies into the ring at a position, wrapping at its end.
+ */
+static void ring_put(LogSink_T *sink, uint64_t position, const void *data, size_t length) {
+    size_t offset = (size_t)(position & (sink->ring_size - 1));
+    size_t first = sink->ring_size - offset;
+    if (first >= length) {
+        memcpy(sink->ring + offset, data, length);
+    } else {
+        memcpy(sink->ring + offset, data, first);
+        memcpy(sink->ring, (const char *)data + first, length - first);
+    }
+}
+
+/**
+ * @brief Copies out of the ring from a position, wrapping at its end.
+ */
+static void ring_get(const LogSink_T *sink, uint64_t position, void *data, size_t length) {
+    size_t offset = (size_t)(position & (sink->ring_size - 1));
+    size_t first = sink->ring_size - offset;
+    if (first >= length) {
+        memcpy(data, sink->ring + offset, length);
+    } else {
+        memcpy(data, sink->ring + offset, first);
+        memcpy((char *)data + first, sink->ring, length - first);
+    }
+}
+
+/**
+ * @brief Writes everything queued, batch by batch, while the sink is ready.
+ * Lines in a batch the sink fails to write are dropped. Where lines were
+ * dropped because the ring was full, the batch ends and the sink is told how
+ * many, so it can mark the gap where it happened.
+ */
+static void write_queued(LogSink_T *sink) {
+    uint64_t tail = (uint64_t)platform_atomic_load_relaxed_64(&sink->tail);
+    uint64_t head = (uint64_t)platform_atomic_load_64(&sink->head);
+
+    while (tail != head && (!sink->ops->ready || sink->ops->ready(sink->context))) {
+        // Whole lines, up to batch_bytes, though a longer line goes on its own
+        size_t used = 0;
+        uint64_t lines = 0;
+        while (tail != head) {
+            RecordHeader_T record;
+            ring_get(sink, tail, &record, sizeof(record));
+            if (used > 0 && (used + record.length > sink->batch_bytes || record.skipped)) {
+                break;
+            }
+            if (record.skipped && sink->ops->skipped) {
+                sink->ops->skipped(sink->context, record.skipped);
+            }
+            ring_get(sink, tail + RECORD_HEADER_SIZE, sink->batch + used, record.length);
+            used += record.length;
+            lines++;
+            tail += RECORD_HEADER_SIZE + record.length;
+        }
+        platform_atomic_store_64(&sink->tail, (int64_t)tail); // The space is the logger's again
+
+        if (sink->ops->write(sink->context, sink->batch, used)) {
+            platform_atomic_fetch_add_64(&sink->bytes_written, (int64_t)used);
+            platform_atomic_fetch_add_64(&sink->writes, 1);
+        } else {
+            platform_atomic_fetch_add_64(&sink->write_failures, 1);
+            platform_atomic_fetch_add_64(&sink->lines_dropped, (int64_t)lines);
+        }
+        head = (uint64_t)platform_atomic_load_64(&sink->head);
+    }
+}
+
+/**
+ * @brief The writer: wakes when a batch is waiting, when asked, or when the flush interval has passed.
+ */
+static void *writer_thread_function(void *arg) {
+    LogSink_T *sink = (LogSink_T *)arg;
+    while (!sink->stopping) {
+        platform_event_wait(&sink->wake, (unsigned int)sink->flush_interval_ms);
+        write_queued(sink);
+    }
+    write_queued(sink); // What was logged before close
+    uint64_t skipped = (uint64_t)platform_atomic_load_64(&sink->skipped);
+    if (skipped && sink->ops->skipped && (!sink->ops->ready || sink->ops->ready(sink->context))) {
+        sink->ops->skipped(sink->context, skipped); // Dropped after the last line queued
+    }
+    return NULL;
+}
+
+/**
+ * @brief Frees a sink whose writer is not running.
+ */
+static void free_sink(LogSink_T *sink) {
+    free(sink->ring);
+    free(sink->batch);
+    free(sink);
+}
+
+/**
+ * @copydoc log_sink_open
+ */
+LogSink_T *log_sink_open(const LogSinkOps_T *ops, void *context, size_t batch_bytes,
+                         int flush_interval_ms, size_t queue_bytes) {
+    LogSink_T *sink = (LogSink_T *)calloc(1, sizeof(*sink));
+    if (!sink) {
+        return NULL;
+    }
+    sink->ops = ops;
+    sink->context = context;
+    sink->batch_bytes = batch_bytes ? batch_bytes : LOG_SINK_RECORD_MAX;
+    sink->flush_interval_ms = (flush_interval_ms > 0) ? flush_interval_ms : 1;
+
+    // A power of two, with room for at least a few of the longest lines
+    size_t minimum = 4 * (RECORD_HEADER_SIZE + LOG_SINK_RECORD_MAX);
+    size_t ring_size = 1;
+    while (ring_size < queue_bytes || ring_size < minimum) {
+        ring_size <<= 1;
+    }
+    sink->ring_size = ring_size;
+    sink->ring = (char *)malloc(sink->ring_size);
+    sink->batch = (char *)malloc((sink->batch_bytes > LOG_SINK_RECORD_MAX) ? sink->batch_bytes : LOG_SINK_RECORD_MAX);
+    if (!sink->ring || !sink->batch || platform_event_init(&sink->wake) != 0) {
+        free_sink(sink);
+        return NULL;
+    }
+    if (platform_thread_create(&sink->thread, writer_thread_function, sink) != 0) {
+        platform_event_destroy(&sink->wake);
+        free_sink(sink);
+        return NULL;
+    }
+    return sink;
+}
+
+/**
+ * @copydoc log_sink_write
+ */
+bool log_sink_write(LogSink_T *sink, const char *data, size_t length) {
+    if (length > LOG_SINK_RECORD_MAX) {
+        length = LOG_SINK_RECORD_MAX;
+    }
+
+    uint64_t head = (uint64_t)platform_atomic_load_relaxed_64(&sink->head);
+    uint64_t tail = (uint64_t)platform_atomic_load_64(&sink->tail);
+    size_t size = RECORD_HEADER_SIZE + length;
+    if (size > sink->ring_size - (size_t)(head - tail)) {
+        platform_atomic_fetch_add_64(&sink->lines_dropped, 1);
+        platform_atomic_fetch_add_64(&sink->skipped, 1);
+        return false;
+    }
+
+    RecordHeader_T record = { (uint32_t)length, 0 };
+    if (platform_atomic_load_relaxed_64(&sink->skipped)) {
+        record.skipped = (uint32_t)platform_atomic_exchange_64(&sink->skipped, 0);
+    }
+    ring_put(sink, head, &record, sizeof(record));
+    ring_put(sink, head + RECORD_HEADER_SIZE, data, length);
+    head += size;
+    platform_atomic_store_64(&sink->head, (int64_t)head);
+    platform_atomic_fetch_add_64(&sink->lines_queued, 1);
+
+    // A full batch is worth a wake up; anything less waits for the flush interval
+    if (head - sink->signalled_head >= sink->batch_bytes) {
+        sink->signalled_head = head;
+        platform_event_signal(&sink->wake);
+    }
+    return true;
+}
+
+/**
+ * @copydoc log_sink_wake
+ */
+void log_sink_wake(LogSink_T *sink) {
+    sink->signalled_head = (uint64_t)platform_atomic_load_relaxed_64(&sink->head);
+    platform_event_signal(&sink->wake);
+}
+
+/**
+ * @copydoc log_sink_get_stats
+ */
+void log_sink_get_stats(LogSink_T *sink, LogSinkStats_T *stats) {
+    stats->lines_queued = (uint64_t)platform_atomic_load_64(&sink->lines_queued);
+    stats->lines_dropped = (uint64_t)platform_atomic_load_64(&sink->lines_dropped);
+    stats->bytes_written = (uint64_t)platform_atomic_load_64(&sink->bytes_written);
+    stats->writes = (uint64_t)platform_atomic_load_64(&sink->writes);
+    stats->write_failures = (uint64_t)platform_atomic_load_64(&sink->write_failures);
+    stats->queued_bytes = (uint64_t)(platform_atomic_load_64(&sink->head) - platform_atomic_load_64(&sink->tail));
+}
+
+/**
+ * @copydoc log_sink_close
+ */
+void log_sink_close(LogSink_T *sink) {
+    if (!sink) {
+        return;
+    }
+    sink->stopping = true;
+    platform_event_signal(&sink->wake);
+    platform_thread_join(sink->thread, NULL);
+    platform_event_destroy(&sink->wake);
+    free_sink(sink);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file log_spill.c
+ * @brief Overflow buffer for entries that find every log queue full.
+ */
+
+#include "log_spill.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform_threads.h"
+
+LogSpill_T global_log_spill;
+
+// Buffer position this thread must see consumed before using the queues again
+static THREAD_LOCAL int64_t this_thread_spilled_until = 0;
+
+/**
+ * @copydoc log_spill_init
+ */
+bool log_spill_init(LogSpill_T *spill, size_t capacity) {
+    platform_atomic_init_64(&spill->head, 0);
+    platform_atomic_init_64(&spill->tail, 0);
+    platform_mutex_init(&spill->mutex);
+    spill->capacity = 0;
+    spill->entries = (capacity > 0) ? (LogEntry_T *)malloc(capacity * sizeof(LogEntry_T)) : NULL;
+    if (!spill->entries) {
+        platform_mutex_destroy(&spill->mutex);
+        return false;
+    }
+    spill->capacity = (int64_t)capacity;
+    return true;
+}
+
+/**
+ * @copydoc log_spill_push
+ */
+bool log_spill_push(LogSpill_T *spill, const LogEntry_T *entry) {
+    if (!spill->entries) {
+        return false;
+    }
+
+    platform_mutex_lock(&spill->mutex);
+    int64_t head = platform_atomic_load_relaxed_64(&spill->head);
+    if (head - platform_atomic_load_64(&spill->tail) >= spill->capacity) {
+        platform_mutex_unlock(&spill->mutex);
+        return false;
+    }
+    memcpy(&spill->entries[head % spill->capacity], entry, LOG_ENTRY_SIZE(entry));
+    platform_atomic_store_64(&spill->head, head + 1);
+    platform_mutex_unlock(&spill->mutex);
+
+    this_thread_spilled_until = head + 1;
+    return true;
+}
+
+/**
+ * @copydoc log_spill_holding
+ */
+bool log_spill_holding(LogSpill_T *spill) {
+    if (this_thread_spilled_until == 0) {
+        return false;
+    }
+    if (platform_atomic_load_64(&spill->tail) < this_thread_spilled_until) {
+        return true;
+    }
+    this_thread_spilled_until = 0;
+    return false;
+}
+
+/**
+ * @copydoc log_spill_pending
+ */
+size_t log_spill_pending(LogSpill_T *spill) {
+    return (size_t)(platform_atomic_load_64(&spill->head) - platform_atomic_load_relaxed_64(&spill->tail));
+}
+
+/**
+ * @copydoc log_spill_peek
+ */
+const LogEntry_T *log_spill_peek(LogSpill_T *spill) {
+    int64_t tail = platform_atomic_load_relaxed_64(&spill->tail);
+    if (tail == platform_atomic_load_64(&spill->head)) {
+        return NULL;
+    }
+    return &spill->entries[tail % spill->capacity];
+}
+
+/**
+ * @copydoc log_spill_consume
+ */
+void log_spill_consume(LogSpill_T *spill) {
+    platform_atomic_store_64(&spill->tail, platform_atomic_load_relaxed_64(&spill->tail) + 1);
+}
+
+/**
+ * @copydoc log_spill_free
+ */
+void log_spill_free(LogSpill_T *spill) {
+    if (!spill->entries) {
+        return;
+    }
+    free(spill->entries);
+    spill->entries = NULL;
+    spill->capacity = 0;
+    platform_mutex_destroy(&spill->mutex);
+}
@@ -0,0 +1,249 @@
+/**
+ * @file log_writer.c
+ * @brief Buffered output for the log sinks.
+ */
+
+#include "log_writer.h"
+#include "platform_signal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @copydoc log_writer_init
+ */
+bool log_writer_init(LogWriter_T *writer, FILE *stream, size_t capacity) {
+    writer->stream = stream;
+    writer->used = 0;
+    writer->capacity = 0;
+    writer->total = 0;
+    writer->buffer = NULL;
+    memset(&writer->map, 0, sizeof(writer->map));
+    writer->synced = 0;
+    writer->aio = NULL;
+    writer->fd = -1;
+    memset(writer->slots, 0, sizeof(writer->slots));
+    writer->active = 0;
+
+    if (capacity == 0) {
+        return true;
+    }
+    writer->buffer = (char *)malloc(capacity);
+    if (!writer->buffer) {
+        return false;
+    }
+    writer->capacity = capacity;
+    return true;
+}
+
+/**
+ * @copydoc log_writer_write
+ */
+bool log_writer_write(LogWriter_T *writer, const void *data, size_t length) {
+    if (writer->map.address) {
+        if (length > writer->map.size - writer->total) {
+            return false; // Past even the slack, the logger should have rotated
+        }
+        memcpy(writer->map.address + writer->total, data, length);
+        writer->total += length;
+        return true;
+    }
+
+    // total is only moved on once what is buffered has gone, as it gives its offset
+    if (length > writer->capacity - writer->used) {
+        if (!log_writer_flush(writer)) {
+            writer->total += length;
+            return false;
+        }
+        if (length > writer->capacity) {
+            // Larger than the whole buffer, no point copying it
+            uint64_t offset = writer->total;
+            writer->total += length;
+            if (writer->aio) {
+                return platform_aio_write_now(writer->fd, data, length, offset) == (long)length;
+            }
+            return fwrite(data, 1, length, writer->stream) == length;
+        }
+    }
+    memcpy(writer->buffer + writer->used, data, length);
+    writer->used += length;
+    writer->total += length;
+    return true;
+}
+
+/**
+ * @brief Queues the filled buffer and switches to the other, first waiting for
+ * that one's own write if it is still in flight.
+ */
+static bool queue_async(LogWriter_T *writer, size_t length) {
+    bool ok = true;
+    LogWriterSlot_T *slot = &writer->slots[writer->active];
+    slot->length = length;
+    slot->offset = writer->total - length;
+    if (!platform_aio_write(writer->aio, writer->fd, slot->data, length, slot->offset, slot)) {
+        ok = platform_aio_write_now(writer->fd, slot->data, length, slot->offset) == (long)length;
+        slot->length = 0;
+    }
+
+    writer->active ^= 1;
+    LogWriterSlot_T *next = &writer->slots[writer->active];
+    while (next->length) {
+        if (platform_aio_submit(writer->aio, 1) != 0) {
+            // The queue has failed; nothing more can be known about that write
+            next->length = 0;
+            ok = false;
+            break;
+        }
+        platform_aio_reap(writer->aio, log_writer_complete);
+    }
+    writer->buffer = next->data;
+    return ok;
+}
+
+/**
+ * @copydoc log_writer_flush
+ */
+bool log_writer_flush(LogWriter_T *writer) {
+    if (writer->map.address) {
+        // Already in the file; now and then start it on its way to disk and let the pages go
+        if (writer->total - writer->synced >= LOG_WRITER_SYNC_BYTES) {
+            platform_file_map_sync(&writer->map, (size_t)writer->synced, (size_t)(writer->total - writer->synced), true);
+            writer->synced = writer->total;
+        }
+        return true;
+    }
+    if (writer->used == 0) {
+        return true;
+    }
+    size_t length = writer->used;
+    writer->used = 0;
+    if (writer->aio) {
+        return queue_async(writer, length);
+    }
+    return writer->stream && fwrite(writer->buffer, 1, length, writer->stream) == length;
+}
+
+/**
+ * @copydoc log_writer_write_out_raw
+ */
+void log_writer_write_out_raw(LogWriter_T *writer) {
+    if (writer->map.address || writer->aio || !writer->stream || writer->used == 0) {
+        return;
+    }
+    int fd = platform_fatal_fileno(writer->stream);
+    if (fd >= 0 && platform_fatal_write(fd, writer->buffer, writer->used)) {
+        writer->used = 0;
+    }
+}
+
+/**
+ * @copydoc log_writer_map
+ */
+bool log_writer_map(LogWriter_T *writer, FILE *stream, size_t size) {
+    log_writer_flush(writer);
+    if (writer->total >= size || platform_file_map(&writer->map, stream, size) != 0) {
+        return false;
+    }
+    writer->stream = stream;
+    writer->synced = writer->total;
+    return true;
+}
+
+/**
+ * @copydoc log_writer_unmap
+ */
+void log_writer_unmap(LogWriter_T *writer) {
+    if (!writer->map.address) {
+        return;
+    }
+    platform_file_map_sync(&writer->map, (size_t)writer->synced, (size_t)(writer->total - writer->synced), false);
+    platform_file_unmap(&writer->map, (size_t)writer->total);
+    writer->synced = 0;
+}
+
+/**
+ * @copydoc log_writer_set_async
+ */
+bool log_writer_set_async(LogWriter_T *writer, PlatformAio_T *aio) {
+    if (!writer->buffer || !writer->stream) {
+        return false;
+    }
+    int fd = platform_aio_file(writer->stream);
+    if (fd < 0) {
+        return false;
+    }
+    if (!writer->aio) {
+        char *second = (char *)malloc(writer->capacity);
+        if (!second) {
+            return false;
+        }
+        writer->slots[0].writer = writer->slots[1].writer = writer;
+        writer->slots[0].data = writer->buffer;
+        writer->slots[1].data = second;
+        writer->active = 0;
+        writer->aio = aio;
+    }
+    writer->fd = fd;
+    return true;
+}
+
+/**
+ * @copydoc log_writer_submit
+ */
+void log_writer_submit(PlatformAio_T *aio) {
+    platform_aio_submit(aio, 0);
+    platform_aio_reap(aio, log_writer_complete);
+}
+
+/**
+ * @copydoc log_writer_settle
+ */
+bool log_writer_settle(LogWriter_T *writer) {
+    bool ok = log_writer_flush(writer);
+    if (!writer->aio) {
+        return ok;
+    }
+    LogWriterSlot_T *other = &writer->slots[writer->active ^ 1];
+    while (other->length) {
+        if (platform_aio_submit(writer->aio, 1) != 0) {
+            other->length = 0;
+            return false;
+        }
+        platform_aio_reap(writer->aio, log_writer_complete);
+    }
+    return ok;
+}
+
+/**
+ * @copydoc log_writer_complete
+ */
+void log_writer_complete(void *context, long result) {
+    LogWriterSlot_T *slot = (LogWriterSlot_T *)context;
+    if (result < 0) {
+        result = 0; // Try the lot again below
+    }
+    if ((size_t)result < slot->length) {
+        // Short or failed, finish it here while the bytes are still in hand
+        size_t remaining = slot->length - (size_t)result;
+        platform_aio_write_now(slot->writer->fd, slot->data + result, remaining, slot->offset + (uint64_t)result);
+    }
+    slot->length = 0;
+}
+
+/**
+ * @copydoc log_writer_free
+ */
+void log_writer_free(LogWriter_T *writer) {
+    log_writer_settle(writer);
+    log_writer_unmap(writer);
+    if (writer->aio) {
+        free(writer->slots[0].data);
+        free(writer->slots[1].data);
+        memset(writer->slots, 0, sizeof(writer->slots));
+        writer->aio = NULL;
+    } else {
+        free(writer->buffer);
+    }
+    writer->buffer = NULL;
+    writer->capacity = 0;
+}
@@ -15,16 +15,38 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <stdbool.h>
-#include <math.h>
 #include <windows.h>
 
+#include "log_binary.h"
+#include "log_blob.h"
+#include "log_compress.h"
+#include "log_flight.h"
+#include "log_fields.h"
+#include "log_format.h"
+#include "log_hex.h"
+#include "log_json.h"
+#include "log_label.h"
+#include "log_level.h"
+#include "log_metrics.h"
+#include "log_net.h"
+#include "log_repeat.h"
+#include "log_ring.h"
+#include "log_route.h"
+#include "log_writer.h"
 #include "log_queue.h"
+#include "log_segment.h"
+#include "log_sink.h"
+#include "log_spill.h"
+#include "thread_log_queue.h"
+#include "platform_signal.h"
 #include "platform_threads.h"
 #include "platform_utils.h"
 #include "app_thread.h"
 #include "app_config.h"
 
 #define MAX_LOG_FAILURES 100 // Maximum number of log failures before exiting
+#define LOG_LINE_BUFFER_SIZE (LOG_MSG_BUFFER_SIZE + 256) // A message plus its prefix
+#define LOG_JSON_LINE_BUFFER_SIZE (LOG_MSG_BUFFER_SIZE * LOG_JSON_ESCAPED_MAX + 256) // Every byte escaped at worst
 #define MAX_THREADS 100
 #define APP_LOG_FILE_INDEX 0
 
@@ -41,10 +63,15 @@
 #define CONFIG_LOG_PATH_KEY "log_file_path"
 #define CONFIG_LOG_FILE_KEY "log_file_name"
 
+// One per distinct file; threads configured with the same file name share it
 typedef struct ThreadLogFile {
-    char thread_label[MAX_PATH];
     FILE *log_fp;
     char log_file_name[MAX_PATH];
+    LogSegments_T segments; // log_fp is the current segment of log_file_name
+    LogWriter_T writer;     // Output waiting to be written to log_fp, writer.total counts the segment's bytes
+    LogBinaryFile_T binary; // Ids defined so far, when writing binary files
+    uint64_t entries;       // Published to this file this run
+    uint64_t bytes;
 } ThreadLogFile;
 
 typedef enum LogTimestampGranularity {
@@ -56,6 +83,29 @@ typedef enum LogTimestampGranularity {
     LOG_TS_SECOND      = 1           // 1/1
 } LogTimestampGranularity;
 
+/* What a producer does with an entry when its own queue and the shared queue are both full */
+typedef enum LogOverflowPolicy {
+    LOG_OVERFLOW_BLOCK,         // Wait up to overflow_block_ms for room, then drop
+    LOG_OVERFLOW_DROP_NEWEST,   // Drop the entry being logged
+    LOG_OVERFLOW_DROP_BY_LEVEL, // Drop below WARN, wait for room for WARN and above
+    LOG_OVERFLOW_SPILL          // Move it to the overflow buffer, dropping it if that is full too (default)
+} LogOverflowPolicy;
+
+/* How log files are written */
+typedef enum LogFileBackend {
+    LOG_FILE_BACKEND_STDIO,     // Buffered batches handed to fwrite (default)
+    LOG_FILE_BACKEND_MMAP,      // Preallocated segments mapped into memory, writes are copies
+    LOG_FILE_BACKEND_IO_URING   // Double-buffered batches queued on an io_uring (Linux)
+} LogFileBackend;
+
+#define LOG_AIO_ENTRIES 256 // Room for both buffers of every log file to be in flight
+
+// The console is for watching, not for the record: a small queue that drops, and a
+// writer that coalesces whatever is waiting into one write a few times a second
+#define LOG_CONSOLE_QUEUE_BYTES 65536
+#define LOG_CONSOLE_BATCH_BYTES 16384
+#define LOG_CONSOLE_FLUSH_MS 50
+
 
 
 #ifdef _DEBUG
@@ -66,6 +116,7 @@ bool g_trace_all = false;
 
 PlatformMutex_T logging_mutex; // Mutex for thread safety
 static ThreadLogFile thread_log_files[MAX_THREADS + 1]; // +1 for the main application log file
+static ThreadLogFile *g_label_log_files[LOG_LABEL_MAX];  // By label id, NULL for the main log file
 
 // for high-resolution timestamps
 THREAD_LOCAL static ULARGE_INTEGER g_filetime_reference_ularge;
@@ -73,11 +124,21 @@ THREAD_LOCAL static LARGE_INTEGER g_qpc_reference;
 THREAD_LOCAL static LARGE_INTEGER g_qpc_frequency;
 THREAD_LOCAL static int g_timestamp_initialised = 0;
 
+// The formatted date and time of the second last published by this thread
+static THREAD_LOCAL char g_cached_time[32];
+static THREAD_LOCAL size_t g_cached_time_length = 0;
+static THREAD_LOCAL int64_t g_cached_second_start = 0;  // Timestamp ticks at the start of that second
+static THREAD_LOCAL int64_t g_nanoseconds_per_tick = 0;
+
 static LogTimestampGranularity g_log_timestamp_granularity = LOG_TS_NANOSECOND;  // Default
-static LogLevel g_log_level = LOG_DEBUG; // Current log level
 static LogOutput g_log_output = LOG_OUTPUT_BOTH; // Log output destination
 int g_log_leading_zeros = 12;
 
+// Worked out from the config once, rather than for every entry
+static int g_log_index_width = 12;
+static int g_log_fractional_width = 9;           // Digits after the decimal point
+static int64_t g_log_fraction_divisor = 1;       // Nanoseconds per unit of the last digit
+
 //colour is nice 
 static bool g_log_use_ansi_colours = false;
 
@@ -89,6 +150,12 @@ static int g_thread_log_file_count = 0;
 static char log_file_path[MAX_PATH] = "";             // Log file path
 static char log_file_name[MAX_PATH] = "log_file.log"; // Log file name
 static off_t g_log_file_size = 10485760;                // Log file size before rotation
+static uint64_t g_log_prepare_size = 7864320;           // Size at which the next segment is opened
+static uint32_t g_log_max_segments = 0;                 // Segments kept per file, 0 for no limit
+static uint64_t g_log_max_total_bytes = 0;              // Bytes kept per file, 0 for no limit
+static bool g_log_compress_segments = false;            // Compress closed segments in the background
+static LogFileBackend g_log_file_backend = LOG_FILE_BACKEND_STDIO;
+static PlatformAio_T g_log_aio = { .ring_fd = -1 }; // Shared by every file when the backend is io_uring
 
 // Thread-specific log file
 __declspec(thread) static char thread_log_file[MAX_PATH] = "";
@@ -96,6 +163,63 @@ __declspec(thread) static char thread_log_file[MAX_PATH] = "";
 static PlatformThread_T log_thread; // Logging thread
 static bool logging_thread_started = false; // indicate whether the logger thread has started
 static bool g_purge_logs_on_restart = false;
+static bool g_log_deferred_formatting = true; // Leave vsnprintf to the logger thread
+static bool g_log_binary_files = false; // Write log files in the format read by etherlog-decode
+static bool g_log_json_files = false;   // Write log files as JSON lines, see log_json.h
+static char g_json_line[LOG_JSON_LINE_BUFFER_SIZE]; // Built with logging_mutex held
+static LogEntry_T g_flattened_entry;    // An entry with its fields as text, for binary files; logging_mutex held
+static LogEntry_T g_hex_row_entry;      // One row of a hex dump; logging_mutex held
+static LogBlobPool_T g_log_blobs;       // Bytes for logger_log_hex dumps, see log_blob.h
+static LogBinaryHeader_T g_log_binary_header; // Clock reference shared by every binary file this run
+static char g_unpublished_name[MAX_PATH] = "";  // Where a crash writes what was still queued; built at init, the handler cannot format
+static int g_unpublished_fd = -1;               // Opened by the fatal signal handler at the first such entry
+static char g_unpublished_line[LOG_LINE_BUFFER_SIZE]; // Fatal signal handler only
+
+// Lines are also streamed to a collector when log_protocol is set, see log_net.h
+static LogNetSink_T* g_log_net = NULL;
+static bool g_log_net_json = false;     // Send JSON lines rather than text
+static char g_log_net_source[256] = ""; // Names this process to the collector, may be empty
+static char g_log_net_destination[300] = ""; // host:port, for reports
+static char g_text_line[sizeof(g_log_net_source) + LOG_LINE_BUFFER_SIZE]; // Lines for the queued sinks; logging_mutex held
+
+// The console has its own queue and writer thread once the logger is initialised,
+// so a slow terminal only holds up itself; see log_sink.h. The files stay with the
+// logger thread, and route.N rules in [logger] pick the sinks for each entry, see log_route.h
+static LogSink_T* g_console_sink = NULL; // NULL before init and after close, when the console is written directly
+static LogRing_T g_log_ring;             // Recent lines in memory, when ring_bytes is set
+static uint8_t g_log_sinks_open = LOG_SINK_FILE | LOG_SINK_CONSOLE; // Sinks that can take entries
+static bool g_log_default_routes_stale = false; // log_destination has changed since the routes were set
+static bool g_log_text_routes = true;    // Some route leads to a sink other than the files
+
+// Output is buffered per sink and written when the buffer fills, every
+// flush interval, or straight away for errors
+static LogWriter_T g_console_writer;
+static uint64_t g_console_entries = 0; // Published to the console this run
+static uint64_t g_console_bytes = 0;
+static int g_log_flush_interval_ms = 200;
+static int g_log_flush_bytes = 65536; // 0 writes every entry as it is published
+static int64_t g_log_flush_interval_ticks = 0;
+static int64_t g_log_last_flush_ticks = 0;
+static int64_t g_log_flush_frequency = 1;  // Timestamp ticks per second
+static bool g_log_unflushed = false;       // Something is sitting in a writer's buffer
+
+// Index of the last published entry, only touched with logging_mutex held
+static uint64_t g_log_index = 0;
+
+// Producers never write to the sinks themselves; when the queues are full they follow the policy
+static LogOverflowPolicy g_log_overflow_policy = LOG_OVERFLOW_SPILL; // Never holds a producer up
+static int g_log_overflow_block_ms = 10;
+static int g_log_overflow_spill_entries = 4096;
+static int g_log_overflow_report_ms = 1000; // How often the logger reports what was dropped
+static PlatformAtomic64_T g_log_dropped[LOG_FATAL + 1]; // Entries dropped, per level
+static uint64_t g_log_dropped_reported[LOG_FATAL + 1];  // Logger thread only
+static int64_t g_log_last_drop_report_ticks = 0;        // Logger thread only
+static THREAD_LOCAL bool g_is_logger_thread = false;    // Never made to wait on itself
+
+static THREAD_LOCAL uint32_t g_enqueue_calls = 0; // Counts towards the next timed enqueue
+
+static bool g_log_collapse_repeats = false;  // Count identical consecutive messages rather than publish them
+static int g_log_repeat_report_ms = 10000;   // Longest a count is held before it is published
 
 
 /**
@@ -191,14 +315,70 @@ static const char* get_log_level_colour(LogLevel level) {
 }
 
 /**
- * @brief Publishes a log entry to the appropriate destination (file or console).
+ * @brief Returns the console's writer, writing straight through until the logger is initialised.
+ */
+static LogWriter_T* console_writer(void) {
+    if (!g_console_writer.stream) {
+        log_writer_init(&g_console_writer, stderr, 0);
+    }
+    return &g_console_writer;
+}
+
+/**
+ * @brief Writes @p value in decimal, zero-padded to at least @p width digits.
+ * @return The position after the last digit.
+ */
+static char* append_padded_uint(char* out, uint64_t value, int width) {
+    // Two digits per step from a table, rather than a division per digit
+    static const char digit_pairs[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char digits[20];
+    int count = 0;
+
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        digits[19 - count++] = digit_pairs[pair + 1];
+        digits[19 - count++] = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = (unsigned)value * 2;
+        digits[19 - count++] = digit_pairs[pair + 1];
+        digits[19 - count++] = digit_pairs[pair];
+    } else {
+        digits[19 - count++] = (char)('0' + value);
+    }
+
+    for (; width > count; width--) {
+        *out++ = '0';
+    }
+    memcpy(out, digits + 20 - count, (size_t)count);
+    return out + count;
+}
+
+/**
+ * @brief Appends @p length bytes of @p text.
+ * @return The position after the text.
+ */
+static char* append_text(char* out, const char* text, size_t length) {
+    memcpy(out, text, length);
+    return out + length;
+}
+
+/**
+ * @brief Builds the text line for a log entry.
  * @param entry The log entry.
- * @param log_output The file pointer (typically stderr for screen output).
+ * @param index The index assigned to the entry at publication.
+ * @param colour true to colour the level, as the console does.
+ * @param line Receives the line, LOG_LINE_BUFFER_SIZE bytes.
+ * @return The line's length, newline included; 0 if there was no message.
  */
-static void publish_log_entry(const LogEntry_T* entry, FILE* log_output) {
+static size_t render_log_line(const LogEntry_T* entry, uint64_t index, bool colour, char* line) {
     if (!entry || !entry->message) {
         fprintf(stderr, "Log Error: Attempted to log NULL or blank message\n");
-        return;
+        return 0;
     }
 
     /* Initialize the timestamp system for the current thread if not already initialized */
@@ -215,74 +395,262 @@ static void publish_log_entry(const LogEntry_T* entry, FILE* log_output) {
     }
 
     /*
-     * We assume the timestamp system is already initialised at application startup.
-     * Calculate the elapsed ticks since the QPC reference.
+     * The date and time only change once a second, so the formatted text is
+     * cached along with the tick range of that second. Most entries just
+     * subtract the start of the second to get the fractional part.
      */
-    int64_t elapsed_ticks = entry->timestamp.QuadPart - g_qpc_reference.QuadPart;
-    int64_t elapsed_seconds = elapsed_ticks / g_qpc_frequency.QuadPart;
+    int64_t ticks_into_second = entry->timestamp.QuadPart - g_cached_second_start;
+    if (ticks_into_second < 0 || ticks_into_second >= g_qpc_frequency.QuadPart || !g_cached_time_length) {
+        int64_t elapsed_ticks = entry->timestamp.QuadPart - g_qpc_reference.QuadPart;
+        int64_t elapsed_seconds = elapsed_ticks / g_qpc_frequency.QuadPart;
+        if (elapsed_ticks < 0 && elapsed_ticks % g_qpc_frequency.QuadPart) {
+            elapsed_seconds--; // Round down, entries can predate this thread's reference
+        }
 
-    /* Convert stored FILETIME reference to time_t (seconds since Unix epoch) */
-    time_t rawtime = (time_t)((g_filetime_reference_ularge.QuadPart / 10000000ULL) - 11644473600ULL);
-    rawtime += elapsed_seconds;
+        /* Convert stored FILETIME reference to time_t (seconds since Unix epoch) */
+        time_t rawtime = (time_t)((g_filetime_reference_ularge.QuadPart / 10000000ULL) - 11644473600ULL);
+        rawtime += elapsed_seconds;
 
-    struct tm timeinfo;
-    localtime_s(&timeinfo, &rawtime);
+        struct tm timeinfo;
+        localtime_s(&timeinfo, &rawtime);
+        g_cached_time_length = strftime(g_cached_time, sizeof(g_cached_time), "%Y-%m-%d %H:%M:%S", &timeinfo);
 
-    int64_t nanoseconds = (elapsed_ticks % g_qpc_frequency.QuadPart) *
-        (1000000000 / g_qpc_frequency.QuadPart);
+        g_cached_second_start = g_qpc_reference.QuadPart + elapsed_seconds * g_qpc_frequency.QuadPart;
+        g_nanoseconds_per_tick = 1000000000 / g_qpc_frequency.QuadPart;
+        ticks_into_second = entry->timestamp.QuadPart - g_cached_second_start;
+    }
 
-    /*
-     * We now assume that g_log_timestamp_granularity is a power of 10.
-     * For example, if g_log_timestamp_granularity is 1000000 (for microsecond precision),
-     * the divisor becomes 1000000000 / 1000000 = 1000.
-     */
-    int64_t divisor = 1000000000 / g_log_timestamp_granularity;
-    int64_t adjusted_time = nanoseconds / divisor;
+    /* Get ANSI colour for the log level (only for console output) */
+    const char* log_colour = colour ? get_log_level_colour(entry->level) : "";
+    const char* reset_colour = colour ? ANSI_RESET : "";
+    const char* level_name = log_level_to_string(entry->level);
 
     /*
-     * Determine the field width to print the fractional part by taking
-     * the base-10 logarithm of g_log_timestamp_granularity.
-     * For instance, log10(1000000) yields 6.
+     * Build the line: the index with leading zeros to g_log_index_width, then
+     * the time, with the sub-second part zero-padded to g_log_fractional_width.
+     * The prefix is bounded, and the message and label by their buffers.
      */
-    int fractional_width = (int)log10((double)g_log_timestamp_granularity);
+    char* out = line;
+
+    out = append_padded_uint(out, index, g_log_index_width);
+    *out++ = ' ';
+    out = append_text(out, g_cached_time, g_cached_time_length);
+    if (g_log_fractional_width > 0) {
+        int64_t nanoseconds = ticks_into_second * g_nanoseconds_per_tick;
+        *out++ = '.';
+        out = append_padded_uint(out, (uint64_t)(nanoseconds / g_log_fraction_divisor), g_log_fractional_width);
+    }
+    *out++ = ' ';
+    out = append_text(out, log_colour, strlen(log_colour));
+    out = append_text(out, level_name, strlen(level_name));
+    out = append_text(out, reset_colour, strlen(reset_colour));
+    out = append_text(out, ": [", 3);
+    const char* label = log_label_name(entry->label_id);
+    out = append_text(out, label, strlen(label));
+    out = append_text(out, "] ", 2);
+
+    size_t room = (size_t)(line + LOG_LINE_BUFFER_SIZE - out) - 1;
+    out = append_text(out, entry->message, (entry->message_length < room) ? entry->message_length : room);
+    if (entry->fields_length) {
+        room = (size_t)(line + LOG_LINE_BUFFER_SIZE - out) - 1;
+        out += log_fields_append_text(out, room, LOG_ENTRY_FIELDS(entry), entry->fields_length);
+    }
+    *out++ = '\n';
 
-    /* Determine log index width (default: 12, or user-defined) */
-    int index_width = (g_log_leading_zeros >= 0) ? g_log_leading_zeros : 12;
+    return (size_t)(out - line);
+}
 
-    /* Get ANSI colour for the log level (only for console output) */
-    const char* log_colour = (log_output == stderr) ? get_log_level_colour(entry->level) : "";
-    const char* reset_colour = (log_output == stderr) ? "\x1b[0m" : "";
+/**
+ * @brief Returns an entry's time in nanoseconds since the Unix epoch, from the
+ * run's clock reference. Plain arithmetic, so safe in the fatal signal handler.
+ */
+static int64_t epoch_nanoseconds(const LogEntry_T* entry) {
+    const LogBinaryHeader_T* clock = &g_log_binary_header;
+    int64_t ticks = entry->timestamp.QuadPart - clock->qpc_reference;
+    return (int64_t)(clock->filetime_reference - 116444736000000000ULL) * 100 +
+        (ticks / clock->qpc_frequency) * 1000000000 + (ticks % clock->qpc_frequency) * 1000000000 / clock->qpc_frequency;
+}
 
-    char time_buffer[64];
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+/**
+ * @brief Publishes a log entry to the appropriate destination (file or console).
+ * @param entry The log entry.
+ * @param index The index assigned to the entry at publication.
+ * @param writer The sink's writer, the console's for screen output.
+ */
+static void publish_log_entry(const LogEntry_T* entry, uint64_t index, LogWriter_T* writer) {
+    char line[LOG_LINE_BUFFER_SIZE];
+    size_t length = render_log_line(entry, index, writer == &g_console_writer, line);
+    if (length) {
+        log_writer_write(writer, line, length);
+    }
+}
 
-    /*
-     * Print the log entry.
-     * The index is printed with leading zeros using 'index_width'.
-     * The sub-second part is printed with a field width equal to 'fractional_width',
-     * ensuring that leading zeros are preserved.
-     */
-    if (fractional_width > 0) {
-        fprintf(log_output, "%0*llu %s.%0*lld %s%s%s: [%s] %s\n",
-            index_width, entry->index,
-            time_buffer,
-            fractional_width, adjusted_time,
-            log_colour, log_level_to_string(entry->level), reset_colour,
-            entry->thread_label,
-            entry->message);
+
+/**
+ * @brief Level names for JSON lines, in full and without padding.
+ */
+static const char* json_level_name(LogLevel level) {
+    static const char* names[] = { "TRACE", "DEBUG", "INFO", "NOTICE", "WARN", "ERROR", "CRITICAL", "FATAL" };
+    return ((int)level >= LOG_TRACE && (int)level <= LOG_FATAL) ? names[level] : "UNKNOWN";
+}
+
+/**
+ * @brief Builds the JSON line for a log entry in g_json_line. Caller holds logging_mutex.
+ * @param entry The entry, with its message text.
+ * @param index The index assigned to the entry at publication.
+ * @param source Added as a "source" member if not empty.
+ * @return The line's length, newline included.
+ */
+static size_t render_json_line(const LogEntry_T* entry, uint64_t index, const char* source) {
+    int64_t nanoseconds = epoch_nanoseconds(entry);
+
+    char* out = g_json_line;
+    char* end = g_json_line + sizeof(g_json_line) - 3; // Kept back for the closing quote, brace and newline
+    const char* level_name = json_level_name(entry->level);
+    const char* label = log_label_name(entry->label_id);
+
+    out = append_text(out, "{\"index\":", 9);
+    out += log_fields_format_uint(out, index, false);
+    if (*source) {
+        out = append_text(out, ",\"source\":\"", 11);
+        out += log_json_escape(out, (size_t)(end - out), source, strlen(source));
+        *out++ = '"';
     }
-    else {
-        fprintf(log_output, "%0*llu %s %s%s%s: [%s] %s\n",
-            index_width, entry->index,
-            time_buffer,
-            log_colour, log_level_to_string(entry->level), reset_colour,
-            entry->thread_label,
-            entry->message);
+    out = append_text(out, ",\"ts\":", 6);
+    out += log_fields_format_uint(out, nanoseconds < 0 ? 0 - (uint64_t)nanoseconds : (uint64_t)nanoseconds, nanoseconds < 0);
+    out = append_text(out, ",\"level\":\"", 10);
+    out = append_text(out, level_name, strlen(level_name));
+    out = append_text(out, "\",\"label\":\"", 11);
+    out += log_json_escape(out, (size_t)(end - out), label, strlen(label));
+    out = append_text(out, "\",\"msg\":\"", 9);
+    out += log_json_escape(out, (size_t)(end - out), entry->message, entry->message_length);
+    *out++ = '"';
+    if (entry->fields_length) {
+        out += log_json_append_fields(out, (size_t)(end - out) + 1, LOG_ENTRY_FIELDS(entry), entry->fields_length);
+    }
+    *out++ = '}';
+    *out++ = '\n';
+
+    return (size_t)(out - g_json_line);
+}
+
+/**
+ * @brief Publishes a log entry to a JSON-lines file, one object per line.
+ * Caller holds logging_mutex.
+ * @param entry The entry, with its message text.
+ * @param index The index assigned to the entry at publication.
+ * @param writer The file's writer.
+ */
+static void publish_json_entry(const LogEntry_T* entry, uint64_t index, LogWriter_T* writer) {
+    log_writer_write(writer, g_json_line, render_json_line(entry, index, ""));
+}
+
+/**
+ * @brief Hands a log entry's line to the network sink, which queues it and
+ * returns. Caller holds logging_mutex.
+ * @param entry The entry, with its message text.
+ * @param index The index assigned to the entry at publication.
+ */
+static void publish_network_entry(const LogEntry_T* entry, uint64_t index) {
+    if (g_log_net_json) {
+        log_net_write(g_log_net, g_json_line, render_json_line(entry, index, g_log_net_source));
+        return;
     }
+    // Text lines start with the source, if there is one, so a collector can tell senders apart
+    size_t prefix = strlen(g_log_net_source);
+    memcpy(g_text_line, g_log_net_source, prefix);
+    if (prefix) {
+        g_text_line[prefix++] = ' ';
+    }
+    size_t length = render_log_line(entry, index, false, g_text_line + prefix);
+    if (length) {
+        log_net_write(g_log_net, g_text_line, prefix + length);
+    }
+}
 
-    fflush(log_output);
+/**
+ * @brief Hands a log entry's line to the console's queue, or writes it
+ * directly when the console has none. Caller holds logging_mutex.
+ * @param entry The entry, with its message text.
+ * @param index The index assigned to the entry at publication.
+ */
+static void publish_console_entry(const LogEntry_T* entry, uint64_t index) {
+    if (!g_console_sink) {
+        uint64_t before = g_console_writer.total;
+        publish_log_entry(entry, index, console_writer());
+        g_console_entries++;
+        g_console_bytes += g_console_writer.total - before;
+        if (entry->level >= LOG_ERROR) {
+            log_writer_flush(&g_console_writer);
+        }
+        return;
+    }
+    size_t length = render_log_line(entry, index, true, g_text_line);
+    if (length && log_sink_write(g_console_sink, g_text_line, length)) {
+        g_console_entries++;
+        g_console_bytes += length;
+    }
+    if (entry->level >= LOG_ERROR) {
+        log_sink_wake(g_console_sink);
+    }
 }
 
+/**
+ * @brief Writes the console's batches, on its own thread.
+ */
+static bool write_console(void* context, const char* data, size_t length) {
+    (void)context;
+    bool written = fwrite(data, 1, length, stderr) == length;
+    fflush(stderr);
+    return written;
+}
+
+/**
+ * @brief Marks where the console fell behind and lines were dropped, on its own thread.
+ */
+static void skipped_console(void* context, uint64_t lines) {
+    (void)context;
+    // Whether the files have them depends on routing and on the file having opened, so nothing is claimed
+    fprintf(stderr, "*** %llu log lines skipped, the console fell behind ***\n",
+            (unsigned long long)lines);
+}
+
+static const LogSinkOps_T console_sink_ops = { NULL, write_console, skipped_console };
+
+/**
+ * @brief The sinks entries go to when there are no route rules: the files and
+ * console as log_destination says, and the network and ring if they are set up.
+ */
+static uint8_t default_sinks(void) {
+    uint8_t sinks = LOG_SINK_NETWORK | LOG_SINK_RING;
+    if (g_log_output != LOG_OUTPUT_SCREEN) sinks |= LOG_SINK_FILE;
+    if (g_log_output != LOG_OUTPUT_FILE) sinks |= LOG_SINK_CONSOLE;
+    return sinks & g_log_sinks_open;
+}
+
+/**
+ * @brief Copies an entry with its fields turned into text after the message,
+ * for sinks that store only the message. Caller holds logging_mutex.
+ * @return The copy, or @p entry itself if it has no fields.
+ */
+static const LogEntry_T* flatten_log_fields(const LogEntry_T* entry) {
+    if (!entry->fields_length) {
+        return entry;
+    }
+    LogEntry_T* flat = &g_flattened_entry;
+    flat->level = entry->level;
+    flat->timestamp = entry->timestamp;
+    flat->label_id = entry->label_id;
+    flat->fields_length = 0;
+    flat->blob = 0;
+    flat->format = NULL;
+    memcpy(flat->message, entry->message, entry->message_length);
+    size_t length = entry->message_length + log_fields_append_text(flat->message + entry->message_length,
+        sizeof(flat->message) - entry->message_length - 1, LOG_ENTRY_FIELDS(entry), entry->fields_length);
+    flat->message[length] = '\0';
+    flat->message_length = (uint32_t)length;
+    return flat;
+}
 
 /**
  * @brief Constructs the full log file name.
@@ -303,24 +671,43 @@ static void construct_log_file_name(char *full_log_file_name, size_t size, const
 
 
 /**
- * @brief Sets the log file for the current thread.
+ * @brief Sets the log file for a thread label.
+ *
+ * Labels given the same file name share one ThreadLogFile, and so one handle
+ * and one output buffer, rather than each opening the file for themselves.
+ *
+ * @param label The thread label.
  * @param filename The log file name to set.
  */
 void set_log_thread_file(const char *label, const char *filename) {
+    uint16_t label_id = log_label_intern(label);
+    if (label_id == LOG_LABEL_UNKNOWN) {
+        return; // Out of label ids, the thread logs to the main file
+    }
+
     lock_mutex(&logging_mutex); // Lock the mutex
 
+    for (int i = 0; i < g_thread_log_file_count; i++) {
+        if (str_cmp_nocase(thread_log_files[i].log_file_name, filename) == 0) {
+            g_label_log_files[label_id] = (i == APP_LOG_FILE_INDEX) ? NULL : &thread_log_files[i];
+            unlock_mutex(&logging_mutex);
+            return;
+        }
+    }
+
     if (g_thread_log_file_count >= MAX_THREADS) {
-        // Maximum number of threads reached
+        // Maximum number of files reached
         unlock_mutex(&logging_mutex); // Unlock the mutex
         return;
     }
 
-    strncpy(thread_log_files[g_thread_log_file_count].thread_label, label, sizeof(thread_log_files[g_thread_log_file_count].thread_label) - 1);
-    strncpy(thread_log_files[g_thread_log_file_count].log_file_name, filename, sizeof(thread_log_files[g_thread_log_file_count].log_file_name) - 1);
+    ThreadLogFile* thread_log_file = &thread_log_files[g_thread_log_file_count];
+    strncpy(thread_log_file->log_file_name, filename, sizeof(thread_log_file->log_file_name) - 1);
     // Don't open yet, leave it to the first log message in the context of the logger.
-    thread_log_files[g_thread_log_file_count].log_fp = NULL;   
+    thread_log_file->log_fp = NULL;
+    g_label_log_files[label_id] = thread_log_file;
 
-    // incremented each time we learn of a thread that needed logging
+    // incremented each time we learn of a file that needed logging
     g_thread_log_file_count++;
 
     unlock_mutex(&logging_mutex); // Unlock the mutex
@@ -339,7 +726,15 @@ void set_thread_log_file_from_config(const char* thread_label) {
 
     /* Read log level from config */
     const char* config_log_level = get_config_string("logger", "log_level", NULL);
-    g_log_level = log_level_from_string(config_log_level, LOG_INFO); // Default to LOG_INFO if not set
+    log_level_set_global(log_level_from_string(config_log_level, LOG_INFO)); // Default to LOG_INFO if not set
+
+    /* Read the thread's own log level, if it has one */
+    char level_config_key[MAX_PATH];
+    snprintf(level_config_key, sizeof(level_config_key), "%s.log_level", thread_label);
+    const char* config_thread_log_level = get_config_string("logger", level_config_key, NULL);
+    if (config_thread_log_level) {
+        log_level_set_label(thread_label, (int)log_level_from_string(config_thread_log_level, LOG_INFO));
+    }
 
 #ifdef _DEBUG
     g_trace_all = get_config_bool("debug", "trace_on", false);
@@ -358,18 +753,6 @@ void set_thread_log_file_from_config(const char* thread_label) {
     }
 }
 
-
-/**
- * @brief Generates a timestamped log filename.
- * @param buffer The buffer to store the filename.
- * @param size The size of the buffer.
- */
-static void generate_log_filename(char *buffer, size_t size) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(buffer, size, "log_%Y-%m-%d.txt", t);
-}
-
 /**
  * @brief Converts log level to string.
  * @param level The log level.
@@ -386,6 +769,49 @@ const char* log_level_to_string(LogLevel level) {
     }
 }
 
+/**
+ * @brief Makes a newly opened segment the log file's stream, writing a fresh
+ * header if the files are binary.
+ * @param thread_log_file The log file.
+ * @param log_fp The segment's stream.
+ * @param existing_bytes Bytes already in the segment.
+ */
+static void attach_log_stream(ThreadLogFile *thread_log_file, FILE *log_fp, uint64_t existing_bytes) {
+    // The writer collects a whole batch and hands it over in one call, so a
+    // stdio buffer as well would only add a copy
+    setvbuf(log_fp, NULL, _IONBF, 0);
+    thread_log_file->writer.total = existing_bytes;
+    if (g_log_file_backend == LOG_FILE_BACKEND_MMAP &&
+        log_writer_map(&thread_log_file->writer, log_fp, (size_t)g_log_file_size + LOG_WRITER_MAP_SLACK)) {
+        // Mapped: nothing more to set up
+    } else if (thread_log_file->writer.buffer) {
+        thread_log_file->writer.stream = log_fp;
+    } else {
+        log_writer_init(&thread_log_file->writer, log_fp, (size_t)g_log_flush_bytes);
+        thread_log_file->writer.total = existing_bytes;
+    }
+    if (g_log_file_backend == LOG_FILE_BACKEND_IO_URING) {
+        // Without a buffer (flush_bytes=0) the file is simply written through
+        log_writer_set_async(&thread_log_file->writer, &g_log_aio);
+    }
+    thread_log_file->log_fp = log_fp;
+
+    if (g_log_binary_files) {
+        // Every open starts a new set of definitions
+        log_binary_write_header(&thread_log_file->writer, &thread_log_file->binary, &g_log_binary_header);
+    }
+}
+
+/**
+ * @brief Hands the kernel every file write queued since the last call, in one
+ * system call, when the backend is io_uring. Caller holds logging_mutex.
+ */
+static void submit_log_writes(void) {
+    if (g_log_file_backend == LOG_FILE_BACKEND_IO_URING) {
+        log_writer_submit(&g_log_aio);
+    }
+}
+
 /**
  * @brief Opens the log file and manages the failure count.
  * 
@@ -417,11 +843,16 @@ static bool open_log_file_if_needed(ThreadLogFile *thread_log_file) {
         }
     }
 
-	char* mode = "a"; // Append mode by default
-	if (g_purge_logs_on_restart) {
-		mode = "w"; // Overwrite mode if purge_logs_on_restart is true
-	}
-    thread_log_file->log_fp = fopen(thread_log_file->log_file_name, mode);
+    // Append to the newest segment by default, start afresh if purge_logs_on_restart is true
+    if (thread_log_file->segments.current == 0) {
+        log_segments_init(&thread_log_file->segments, thread_log_file->log_file_name, g_log_binary_files);
+        thread_log_file->segments.read_write = (g_log_file_backend == LOG_FILE_BACKEND_MMAP);
+    }
+    uint64_t existing_bytes;
+    FILE *log_fp = log_segments_open(&thread_log_file->segments, g_purge_logs_on_restart, &existing_bytes);
+    if (log_fp) {
+        attach_log_stream(thread_log_file, log_fp, existing_bytes);
+    }
     if (thread_log_file->log_fp == NULL) {
         if (log_failure_count == 0) {
             char error_message[LOG_MSG_BUFFER_SIZE];
@@ -444,24 +875,40 @@ static bool open_log_file_if_needed(ThreadLogFile *thread_log_file) {
 }
 
 /**
- * @brief Rotates the log file if it exceeds the configured size.
+ * @brief Moves to the next segment once the current one has reached the configured
+ * size, counted from what the writer has been given. Caller holds logging_mutex.
  */
 static void rotate_log_file_if_needed(ThreadLogFile *thread_log_file) {
-    lock_mutex(&logging_mutex);
-    struct stat st;
-    if (stat(thread_log_file->log_file_name, &st) == 0 && st.st_size >= g_log_file_size) {
-        fclose(thread_log_file->log_fp);
-        char rotated_log_filename[512];
-        generate_log_filename(rotated_log_filename, sizeof(rotated_log_filename));
-        snprintf(rotated_log_filename + strlen(rotated_log_filename), sizeof(rotated_log_filename) - strlen(rotated_log_filename), ".old");
-        rename(thread_log_file->log_file_name, rotated_log_filename);
-        thread_log_file->log_fp = fopen(thread_log_file->log_file_name, "a");
-        if (thread_log_file->log_fp == NULL) {
-            unlock_mutex(&logging_mutex);
-            return;
+    if (thread_log_file->writer.total < g_log_prepare_size) {
+        return; // All there is to it for nearly every entry
+    }
+    if (!thread_log_file->segments.next) {
+        // Open the next segment now, while there is still room in this one
+        log_segments_prepare_next(&thread_log_file->segments);
+    }
+    if (thread_log_file->writer.total < (uint64_t)g_log_file_size) {
+        return;
+    }
+
+    log_writer_settle(&thread_log_file->writer);
+    log_writer_unmap(&thread_log_file->writer);
+    fclose(thread_log_file->log_fp);
+    thread_log_file->log_fp = NULL;
+
+    FILE *log_fp = log_segments_advance(&thread_log_file->segments);
+    if (log_fp) {
+        attach_log_stream(thread_log_file, log_fp, 0);
+        if (g_log_compress_segments) {
+            // Only the name is handed over; the worker does the rest in its own time
+            char closed_name[MAX_PATH];
+            log_segments_name(&thread_log_file->segments, thread_log_file->segments.current - 1,
+                closed_name, sizeof(closed_name));
+            log_compress_submit(closed_name);
         }
+        log_segments_prune(&thread_log_file->segments, g_log_max_segments, g_log_max_total_bytes);
+    } else {
+        thread_log_file->writer.stream = NULL; // Reopened by open_log_file_if_needed
     }
-    unlock_mutex(&logging_mutex);
 }
 
 /**
@@ -498,6 +945,168 @@ LogOutput log_output_from_string(const char* destination_str, LogOutput default_
     return default_output;
 }
 
+/**
+ * @brief Convert an overflow policy string to the corresponding enum.
+ * @param policy_str The string representing the policy.
+ * @param default_policy The policy to use if the string is missing or invalid.
+ * @return The corresponding LogOverflowPolicy value.
+ */
+static LogOverflowPolicy log_overflow_policy_from_string(const char* policy_str, LogOverflowPolicy default_policy) {
+    if (!policy_str) return default_policy;
+
+    if (str_cmp_nocase(policy_str, "block") == 0) return LOG_OVERFLOW_BLOCK;
+    if (str_cmp_nocase(policy_str, "drop_newest") == 0 ||
+        str_cmp_nocase(policy_str, "drop") == 0) return LOG_OVERFLOW_DROP_NEWEST;
+    if (str_cmp_nocase(policy_str, "drop_by_level") == 0) return LOG_OVERFLOW_DROP_BY_LEVEL;
+    if (str_cmp_nocase(policy_str, "spill") == 0) return LOG_OVERFLOW_SPILL;
+
+    return default_policy;
+}
+
+/**
+ * @brief Convert a file backend string to the corresponding enum.
+ * @param backend_str The string representing the backend.
+ * @param default_backend The backend to use if the string is missing or invalid.
+ * @return The corresponding LogFileBackend value.
+ */
+static LogFileBackend log_file_backend_from_string(const char* backend_str, LogFileBackend default_backend) {
+    if (!backend_str) return default_backend;
+
+    if (str_cmp_nocase(backend_str, "stdio") == 0) return LOG_FILE_BACKEND_STDIO;
+    if (str_cmp_nocase(backend_str, "mmap") == 0 ||
+        str_cmp_nocase(backend_str, "mapped") == 0) return LOG_FILE_BACKEND_MMAP;
+    if (str_cmp_nocase(backend_str, "io_uring") == 0 ||
+        str_cmp_nocase(backend_str, "uring") == 0) return LOG_FILE_BACKEND_IO_URING;
+
+    return default_backend;
+}
+
+
+/**
+ * @brief Formats a deferred entry's message into a copy of the entry.
+ * @param entry The entry holding captured arguments.
+ * @param rendered Receives the entry with its message text.
+ * @return @p rendered.
+ */
+static const LogEntry_T* render_log_entry(const LogEntry_T* entry, LogEntry_T* rendered) {
+    rendered->level = entry->level;
+    rendered->timestamp = entry->timestamp;
+    rendered->label_id = entry->label_id;
+    rendered->fields_length = 0; // Only entries without fields are deferred
+    rendered->blob = 0;          // The dump follows as rows of its own
+    rendered->format = NULL;
+    rendered->message_length = (uint32_t)log_format_render(entry, rendered->message, sizeof(rendered->message));
+    return rendered;
+}
+
+/**
+ * @brief Writes an entry to its file and the console. Caller holds logging_mutex.
+ * @param entry The entry as queued.
+ * @param text_entry The entry with its message text, or NULL if it has not been rendered.
+ * @param rendered Space to render it in if the console needs it after all.
+ */
+static void publish_locked(const LogEntry_T* entry, const LogEntry_T* text_entry, LogEntry_T* rendered) {
+    ThreadLogFile* tlf = &thread_log_files[APP_LOG_FILE_INDEX];
+
+    /* Rotate & open the main log file if needed */
+    if (tlf->log_fp) rotate_log_file_if_needed(tlf);
+    if (!open_log_file_if_needed(tlf) && g_log_output != LOG_OUTPUT_SCREEN) {
+        g_log_output = LOG_OUTPUT_SCREEN; // Fallback to screen logging
+        g_log_default_routes_stale = true;
+    }
+
+    /* Check if the entry's thread has a specific log file */
+    ThreadLogFile* label_log_file = g_label_log_files[entry->label_id];
+    if (label_log_file) {
+        if (label_log_file->log_fp) rotate_log_file_if_needed(label_log_file);
+        if (!open_log_file_if_needed(label_log_file)) {
+            fprintf(stderr, "File Error: Could not open log file for thread %s\n", log_label_name(entry->label_id));
+        }
+        tlf = label_log_file;
+    }
+
+    if (g_log_default_routes_stale) {
+        log_route_set_default(default_sinks());
+        g_log_default_routes_stale = false;
+    }
+    uint8_t sinks = log_route_lookup(entry->level, entry->label_id) & g_log_sinks_open;
+    if ((sinks & LOG_SINK_FILE) && !tlf->log_fp) {
+        sinks = (sinks & ~LOG_SINK_FILE) | LOG_SINK_CONSOLE; // The file could not be opened
+    }
+
+    uint64_t index = ++g_log_index;
+    g_log_unflushed = true;
+
+    /* Log to file if routed there */
+    if (sinks & LOG_SINK_FILE) {
+        uint64_t before = tlf->writer.total;
+        if (g_log_binary_files) {
+            log_binary_write_entry(&tlf->writer, &tlf->binary, flatten_log_fields(entry), index);
+        } else if (g_log_json_files) {
+            publish_json_entry(text_entry, index, &tlf->writer);
+        } else {
+            publish_log_entry(text_entry, index, &tlf->writer);
+        }
+        tlf->entries++;
+        tlf->bytes += tlf->writer.total - before;
+        if (entry->level >= LOG_ERROR) {
+            log_writer_flush(&tlf->writer);
+            submit_log_writes();
+        }
+    }
+
+    /* The other sinks take text; each queues it for its own thread, or keeps it in memory */
+    if (sinks & (LOG_SINK_CONSOLE | LOG_SINK_NETWORK | LOG_SINK_RING)) {
+        if (!text_entry) {
+            text_entry = render_log_entry(entry, rendered); // Only binary files wanted it earlier
+        }
+        if (sinks & LOG_SINK_CONSOLE) {
+            publish_console_entry(text_entry, index);
+        }
+        if (sinks & LOG_SINK_NETWORK) {
+            publish_network_entry(text_entry, index);
+            if (entry->level >= LOG_ERROR) {
+                log_net_wake(g_log_net);
+            }
+        }
+        if (sinks & LOG_SINK_RING) {
+            log_ring_write(&g_log_ring, g_text_line, render_log_line(text_entry, index, false, g_text_line));
+        }
+    }
+}
+
+/**
+ * @brief Publishes the rows of an entry's hex dump, each as an entry of its
+ * own at the entry's time, level and label, and frees its slot. Caller holds
+ * logging_mutex.
+ * @param entry The entry carrying the dump.
+ */
+static void publish_hex_dump_locked(const LogEntry_T* entry) {
+    const LogBlob_T* blob = log_blob_get(&g_log_blobs, entry->blob);
+    if (blob) {
+        LogEntry_T* row = &g_hex_row_entry;
+        row->level = entry->level;
+        row->timestamp = entry->timestamp;
+        row->label_id = entry->label_id;
+        row->fields_length = 0;
+        row->blob = 0;
+        row->format = NULL;
+        row->message_length = LOG_HEX_ROW_LENGTH;
+        row->message[LOG_HEX_ROW_LENGTH] = '\0';
+
+        size_t start = blob->row_start % LOG_HEX_ROW_BYTES;
+        for (size_t done = 0; done < blob->length; start = 0) {
+            size_t count = LOG_HEX_ROW_BYTES - start;
+            if (count > blob->length - done) {
+                count = blob->length - done;
+            }
+            log_hex_row(row->message, blob->data + done, start, count);
+            publish_locked(row, row, NULL);
+            done += count;
+        }
+    }
+    log_blob_release(&g_log_blobs, entry->blob);
+}
 
 /**
  * @brief Logs a message immediately to file and console.
@@ -513,92 +1122,862 @@ static void log_immediately(const LogEntry_T* entry) {
         return;
     }
 
-    const char* thread_label = entry->thread_label ? entry->thread_label : get_thread_label();
-    ThreadLogFile* tlf = &thread_log_files[APP_LOG_FILE_INDEX];
-
-    /* Rotate & open the main log file if needed */
-    if (tlf->log_fp) rotate_log_file_if_needed(tlf);
-    if (!open_log_file_if_needed(tlf)) {
-        g_log_output = LOG_OUTPUT_SCREEN; // Fallback to screen logging
-    }
-
-    /* Check if the current thread has a specific log file */
-    for (int i = 1; i <= g_thread_log_file_count; i++) {
-        if (thread_label && str_cmp_nocase(thread_log_files[i].thread_label, thread_label) == 0) {
-            if (thread_log_files[i].log_fp) rotate_log_file_if_needed(&thread_log_files[i]);
-            if (!open_log_file_if_needed(&thread_log_files[i])) {
-                fprintf(stderr, "File Error: Could not open log file for thread %s\n", thread_label);
-            }
-            tlf = &thread_log_files[i];
+    if (g_log_collapse_repeats) {
+        LogEntry_T summary;
+        switch (log_repeat_check(entry, &summary)) {
+        case LOG_REPEAT_HELD:
+            unlock_mutex(&logging_mutex);
+            return;
+        case LOG_REPEAT_PUBLISH_AFTER_SUMMARY:
+            publish_locked(&summary, &summary, NULL);
+            break;
+        default:
             break;
         }
     }
 
-    /* Log to file if enabled */
-    if (g_log_output == LOG_OUTPUT_FILE || g_log_output == LOG_OUTPUT_BOTH) {
-        publish_log_entry(entry, tlf->log_fp);
+    // Deferred entries are formatted only now, once they are known to be
+    // published, and not at all if only binary files want them; those store
+    // the captured arguments as they are
+    LogEntry_T rendered;
+    const LogEntry_T* text_entry = entry;
+    if (entry->format) {
+        text_entry = (g_log_binary_files && !g_log_text_routes) ? NULL : render_log_entry(entry, &rendered);
     }
 
-    /* Log to screen if enabled */
-    if (g_log_output == LOG_OUTPUT_SCREEN || g_log_output == LOG_OUTPUT_BOTH) {
-        publish_log_entry(entry, stderr);
+    if (!entry->blob || entry->message_length) {
+        publish_locked(entry, text_entry, &rendered); // A dump split across slots has no message after the first
+    }
+    if (entry->blob) {
+        publish_hex_dump_locked(entry);
     }
 
     unlock_mutex(&logging_mutex);
 }
 
+/**
+ * @copydoc logger_report_repeats
+ */
+void logger_report_repeats(bool now) {
+    if (!g_log_collapse_repeats) {
+        return;
+    }
+
+    lock_mutex(&logging_mutex);
+    if (log_repeat_held() > 0) {
+        int64_t cutoff = INT64_MAX;
+        if (!now) {
+            LARGE_INTEGER current, frequency;
+            get_high_resolution_timestamp(&current);
+            QueryPerformanceFrequency(&frequency);
+            cutoff = current.QuadPart - (frequency.QuadPart * g_log_repeat_report_ms) / 1000;
+        }
+        LogEntry_T summary;
+        while (log_repeat_take_due(cutoff, &summary)) {
+            publish_locked(&summary, &summary, NULL);
+        }
+    }
+    unlock_mutex(&logging_mutex);
+}
+
 
 /**
- * @brief Logs a message avoiding the queue
+ * @brief Logs a message avoiding the queue, noting how long it waited to be published
  */
 void log_now(const LogEntry_T *entry) {
+    LARGE_INTEGER now;
+    get_high_resolution_timestamp(&now);
+    log_metrics_record_publish(now.QuadPart - entry->timestamp.QuadPart);
     log_immediately(entry);
 }
 
-unsigned long long safe_increment_index() {
-    static volatile LONG64 log_index = 0;
-    // Use InterlockedIncrement64 to safely increment log_index
-    return InterlockedIncrement64(&log_index);
+/**
+ * @brief Writes out every sink's buffered output. Caller holds logging_mutex.
+ */
+static void flush_log_writers(void) {
+    for (int i = 0; i <= g_thread_log_file_count && i <= MAX_THREADS; i++) {
+        if (thread_log_files[i].log_fp) {
+            log_writer_flush(&thread_log_files[i].writer);
+        }
+    }
+    log_writer_flush(console_writer());
+    submit_log_writes();
+    g_log_unflushed = false;
 }
 
+/**
+ * @brief Flushes the sinks if the flush interval has passed since the last time.
+ * @return Milliseconds until output still buffered is due, or -1 if nothing is buffered.
+ */
+int logger_flush_if_due(void) {
+    if (!g_log_unflushed) {
+        return -1;
+    }
 
-void create_log_entry(LogEntry_T* entry, LogLevel level, const char* message) {
-    const char* this_thread_label = get_thread_label();
-    const char* name = this_thread_label ? this_thread_label : "UNKNOWN";
+    LARGE_INTEGER now;
+    get_high_resolution_timestamp(&now);
+    int64_t remaining = g_log_last_flush_ticks + g_log_flush_interval_ticks - now.QuadPart;
+    if (remaining > 0) {
+        return (int)((remaining * 1000) / g_log_flush_frequency) + 1;
+    }
 
-    entry->index = safe_increment_index();
+    lock_mutex(&logging_mutex);
+    flush_log_writers();
+    unlock_mutex(&logging_mutex);
+    g_log_last_flush_ticks = now.QuadPart;
+    return -1;
+}
+
+/**
+ * @brief Fills in everything but the message: timestamp, level and thread label.
+ * @param entry The entry to fill in.
+ * @param level The log level.
+ */
+static void init_log_entry_header(LogEntry_T* entry, LogLevel level) {
     get_high_resolution_timestamp(&entry->timestamp); // Get the high-resolution timestamp
     entry->level = level;
-    // Copy the thread label and message safely
-    strncpy(entry->thread_label, name, sizeof(entry->thread_label) - 1);
-    entry->thread_label[sizeof(entry->thread_label) - 1] = '\0'; // Ensure null termination
-    strncpy(entry->message, message, sizeof(entry->message) - 1);
-    entry->message[sizeof(entry->message) - 1] = '\0'; // Ensure null termination
+    entry->label_id = get_thread_label_id();
+    entry->fields_length = 0;
+    entry->blob = 0;
+    entry->format = NULL;
 }
 
-void _logger_log(LogLevel level, const char* format, ...) {
-    if (level < g_log_level) {
+/**
+ * @brief Formats the message directly into an entry and records its length.
+ * @param entry The entry to format into.
+ * @param format The format string.
+ * @param args The arguments for the format string.
+ */
+static void format_log_message(LogEntry_T* entry, const char* format, va_list args) {
+    int written = vsnprintf(entry->message, sizeof(entry->message), format, args);
+    if (written < 0) {
+        entry->message[0] = '\0';
+        written = 0;
+    } else if (written >= (int)sizeof(entry->message)) {
+        written = (int)sizeof(entry->message) - 1; // Truncated
+    }
+    entry->message_length = (uint32_t)written;
+}
+
+/**
+ * @brief Captures the arguments for the logger thread to format, or formats
+ * them now if deferred formatting is off or cannot handle the format.
+ * @param entry The entry to fill in.
+ * @param format The format string.
+ * @param args The arguments for the format string.
+ */
+static void fill_log_message(LogEntry_T* entry, const char* format, va_list args) {
+    if (g_log_deferred_formatting) {
+        va_list capture_args;
+        va_copy(capture_args, args);
+        bool captured = log_format_capture(entry, format, capture_args);
+        va_end(capture_args);
+        if (captured) {
+            return;
+        }
+    }
+    format_log_message(entry, format, args);
+}
+
+void create_log_entry(LogEntry_T* entry, LogLevel level, const char* message) {
+    init_log_entry_header(entry, level);
+
+    size_t message_length = strlen(message);
+    if (message_length >= sizeof(entry->message)) {
+        message_length = sizeof(entry->message) - 1;
+    }
+    memcpy(entry->message, message, message_length);
+    entry->message[message_length] = '\0';
+    entry->message_length = (uint32_t)message_length;
+}
+
+/**
+ * @brief Retries the shared queue until it takes the entry or the block timeout passes.
+ * @param entry The entry to queue.
+ * @return true if the entry was queued.
+ */
+static bool wait_for_log_queue(const LogEntry_T* entry) {
+    LARGE_INTEGER started, now, frequency;
+    get_high_resolution_timestamp(&started);
+    QueryPerformanceFrequency(&frequency);
+    int64_t timeout_ticks = (frequency.QuadPart * g_log_overflow_block_ms) / 1000;
+
+    for (;;) {
+        thread_log_queue_ring(); // Make sure the logger is awake to make room
+        if (log_queue_push(&global_log_queue, entry)) {
+            thread_log_queue_spilled(&global_log_queue);
+            return true;
+        }
+        get_high_resolution_timestamp(&now);
+        if (now.QuadPart - started.QuadPart >= timeout_ticks) {
+            return false;
+        }
+        sleep_ms(1);
+    }
+}
+
+/**
+ * @brief Deals with an entry that found the queues full, according to the overflow policy.
+ *
+ * Runs on the producer's thread, so it never writes to a sink; the only way an
+ * entry is lost is by being counted as dropped.
+ *
+ * @param entry The entry that could not be queued.
+ */
+static void handle_log_overflow(const LogEntry_T* entry) {
+    bool queued = false;
+    log_metrics_record_overflow();
+
+    if (g_is_logger_thread) {
+        // Nobody else can make room for the logger thread, and it writes to the sinks anyway
+        log_immediately(entry);
         return;
     }
 
+    switch (g_log_overflow_policy) {
+        case LOG_OVERFLOW_BLOCK:
+            queued = wait_for_log_queue(entry);
+            break;
+        case LOG_OVERFLOW_DROP_BY_LEVEL:
+            queued = entry->level >= LOG_WARN && wait_for_log_queue(entry);
+            break;
+        case LOG_OVERFLOW_SPILL:
+            queued = log_spill_push(&global_log_spill, entry);
+            if (queued) {
+                thread_log_queue_ring();
+            }
+            break;
+        case LOG_OVERFLOW_DROP_NEWEST:
+        default:
+            break;
+    }
+
+    if (!queued) {
+        platform_atomic_fetch_add_64(&g_log_dropped[entry->level], 1);
+        log_blob_release(&g_log_blobs, entry->blob);
+    }
+}
+
+/**
+ * @copydoc logger_report_dropped
+ */
+void logger_report_dropped(bool now) {
+    LARGE_INTEGER current, frequency;
+    get_high_resolution_timestamp(&current);
+    QueryPerformanceFrequency(&frequency);
+    if (!now && current.QuadPart - g_log_last_drop_report_ticks < (frequency.QuadPart * g_log_overflow_report_ms) / 1000) {
+        return;
+    }
+    g_log_last_drop_report_ticks = current.QuadPart;
+
+    char message[LOG_MSG_BUFFER_SIZE] = "";
+    size_t length = 0;
+    uint64_t total = 0;
+    for (int level = LOG_TRACE; level <= LOG_FATAL; level++) {
+        uint64_t dropped = (uint64_t)platform_atomic_load_64(&g_log_dropped[level]);
+        uint64_t since_last = dropped - g_log_dropped_reported[level];
+        if (since_last == 0) {
+            continue;
+        }
+        g_log_dropped_reported[level] = dropped;
+        total += since_last;
+        int written = snprintf(message + length, sizeof(message) - length, "%s%s %llu",
+            length ? ", " : "", log_level_to_string((LogLevel)level), (unsigned long long)since_last);
+        if (written > 0 && (size_t)written < sizeof(message) - length) {
+            length += (size_t)written;
+        }
+    }
+    if (total == 0) {
+        return;
+    }
+
+    // Published directly: this is the logger thread, and the queues may still be full
+    LogEntry_T entry;
+    char text[LOG_MSG_BUFFER_SIZE];
+    snprintf(text, sizeof(text), "%llu log entries dropped because the log queues were full (%s)",
+        (unsigned long long)total, message);
+    create_log_entry(&entry, LOG_WARN, text);
+    log_immediately(&entry);
+}
+
+/**
+ * @brief Logs one line of the metrics report.
+ * @param direct Publish it straight away rather than queue it.
+ */
+static void report_metric(bool direct, const char* format, ...) {
+    char text[LOG_MSG_BUFFER_SIZE];
     va_list args;
     va_start(args, format);
-
-    // Format the log message
-    char log_buffer[LOG_MSG_BUFFER_SIZE];
-    vsnprintf(log_buffer, sizeof(log_buffer), format, args);
+    vsnprintf(text, sizeof(text), format, args);
     va_end(args);
 
-    LogEntry_T entry;
-    create_log_entry(&entry, level, log_buffer);
+    if (direct) {
+        LogEntry_T entry;
+        create_log_entry(&entry, LOG_INFO, text);
+        log_immediately(&entry);
+    } else {
+        logger_log(LOG_INFO, "%s", text);
+    }
+}
 
-    if (logging_thread_started) {
-        // Push the log message to the queue; if full, log immediately
-        if (!log_queue_push(&global_log_queue, &entry)) {
-            log_immediately(&entry);
+/**
+ * @brief Converts timestamp ticks to microseconds.
+ */
+static double ticks_to_us(uint64_t ticks) {
+    return (double)ticks * 1e6 / (double)g_log_flush_frequency;
+}
+
+/**
+ * @brief Logs the percentiles of a histogram.
+ */
+static void report_histogram(bool direct, const char* name, const uint64_t* buckets, uint64_t count, uint64_t max) {
+    report_metric(direct, "Log metrics: %s over %llu entries: p50 < %.2f us, p99 < %.2f us, p99.9 < %.2f us, max %.2f us",
+        name, (unsigned long long)count,
+        ticks_to_us(log_metrics_percentile(buckets, count, 0.50)),
+        ticks_to_us(log_metrics_percentile(buckets, count, 0.99)),
+        ticks_to_us(log_metrics_percentile(buckets, count, 0.999)),
+        ticks_to_us(max));
+}
+
+/**
+ * @copydoc logger_get_dropped
+ */
+uint64_t logger_get_dropped(void) {
+    uint64_t dropped = 0;
+    for (int level = LOG_TRACE; level <= LOG_FATAL; level++) {
+        dropped += (uint64_t)platform_atomic_load_64(&g_log_dropped[level]);
+    }
+    return dropped;
+}
+
+/**
+ * @copydoc logger_report_metrics
+ */
+void logger_report_metrics(bool direct) {
+    LogMetrics_T metrics;
+    LogQueueStats_T queue_stats;
+    log_metrics_get(&metrics);
+    log_queue_get_stats(&global_log_queue, &queue_stats);
+
+    uint64_t dropped = logger_get_dropped();
+
+    report_metric(direct, "Log metrics: shared queue %llu entries, high water %llu of %d; fullest thread queue %llu bytes, high water %llu of %d; overflow buffer %llu entries, high water %llu",
+        (unsigned long long)metrics.shared_queue.current, (unsigned long long)metrics.shared_queue.high_water, LOG_QUEUE_SIZE,
+        (unsigned long long)metrics.thread_queue.current, (unsigned long long)metrics.thread_queue.high_water, THREAD_LOG_QUEUE_BYTES,
+        (unsigned long long)metrics.spill.current, (unsigned long long)metrics.spill.high_water);
+    report_metric(direct, "Log metrics: %llu overflow events, %llu entries dropped, %llu pushes to the shared queue found it full",
+        (unsigned long long)metrics.overflow_events, (unsigned long long)dropped, (unsigned long long)queue_stats.full_count);
+    char enqueue_name[64];
+    snprintf(enqueue_name, sizeof(enqueue_name), "enqueue latency (1 call in %d timed)", LOG_METRICS_SAMPLE_EVERY);
+    report_histogram(direct, enqueue_name, metrics.enqueue, metrics.enqueue_count, metrics.enqueue_max);
+    report_histogram(direct, "publish lag", metrics.publish_lag, metrics.publish_lag_count, metrics.publish_lag_max);
+
+    // Copied out a sink at a time so nothing is logged with the mutex held
+    for (int i = 0; i < MAX_THREADS + 1; i++) {
+        char name[MAX_PATH];
+        uint64_t entries, bytes;
+        lock_mutex(&logging_mutex);
+        bool used = i < g_thread_log_file_count;
+        if (used) {
+            snprintf(name, sizeof(name), "%s", thread_log_files[i].log_file_name);
+            entries = thread_log_files[i].entries;
+            bytes = thread_log_files[i].bytes;
+        }
+        unlock_mutex(&logging_mutex);
+        if (!used) {
+            break;
         }
+        report_metric(direct, "Log metrics: %s: %llu entries, %llu bytes", name,
+            (unsigned long long)entries, (unsigned long long)bytes);
+    }
+    lock_mutex(&logging_mutex);
+    uint64_t console_entries = g_console_entries;
+    uint64_t console_bytes = g_console_bytes;
+    bool console_queued = (g_console_sink != NULL);
+    LogSinkStats_T console;
+    if (console_queued) {
+        log_sink_get_stats(g_console_sink, &console);
+    }
+    bool network = (g_log_net != NULL);
+    LogNetStats_T net;
+    if (network) {
+        log_net_get_stats(g_log_net, &net);
+    }
+    bool ring = (g_log_ring.data != NULL);
+    uint64_t ring_lines = g_log_ring.lines;
+    uint64_t ring_overwritten = g_log_ring.lines_overwritten;
+    unlock_mutex(&logging_mutex);
+
+    if (console_queued) {
+        report_metric(direct, "Log metrics: console: %llu entries, %llu bytes, %llu dropped, %llu bytes waiting",
+            (unsigned long long)console_entries, (unsigned long long)console_bytes,
+            (unsigned long long)console.lines_dropped, (unsigned long long)console.queued_bytes);
     } else {
-        log_immediately(&entry);
+        report_metric(direct, "Log metrics: console: %llu entries, %llu bytes",
+            (unsigned long long)console_entries, (unsigned long long)console_bytes);
+    }
+    if (network) {
+        report_metric(direct, "Log metrics: network to %s: %llu lines queued, %llu dropped, %llu bytes in %llu sends, %llu failed, %llu connects, %llu bytes waiting, %s",
+            g_log_net_destination,
+            (unsigned long long)net.sink.lines_queued, (unsigned long long)net.sink.lines_dropped,
+            (unsigned long long)net.sink.bytes_written, (unsigned long long)net.sink.writes,
+            (unsigned long long)net.sink.write_failures, (unsigned long long)net.connects,
+            (unsigned long long)net.sink.queued_bytes, net.connected ? "connected" : "not connected");
+    }
+    if (ring) {
+        report_metric(direct, "Log metrics: ring: %llu lines, %llu overwritten",
+            (unsigned long long)ring_lines, (unsigned long long)ring_overwritten);
+    }
+
+    LogBlobStats_T blobs;
+    log_blob_get_stats(&g_log_blobs, &blobs);
+    if (blobs.stored || blobs.dropped) {
+        report_metric(direct, "Log metrics: hex dumps: %llu of %llu bytes, %llu dropped for want of a free slot",
+            (unsigned long long)blobs.stored, (unsigned long long)blobs.bytes, (unsigned long long)blobs.dropped);
+    }
+}
+
+/**
+ * @copydoc logger_dump_ring
+ */
+bool logger_dump_ring(const char* file_name) {
+    // The name can come from a remote peer, so it may only name a file in the log directory
+    if (!*file_name || strpbrk(file_name, "/\\:") || strstr(file_name, "..")) {
+        return false;
+    }
+    char path[MAX_PATH];
+    construct_log_file_name(path, sizeof(path), get_config_string("logger", CONFIG_LOG_PATH_KEY, log_file_path), file_name);
+
+    lock_mutex(&logging_mutex);
+    size_t size = g_log_ring.size;
+    char* text = size ? (char*)malloc(size) : NULL;
+    size_t length = text ? log_ring_copy(&g_log_ring, text, size) : 0;
+    unlock_mutex(&logging_mutex);
+    if (!text) {
+        return false;
+    }
+
+    FILE* file = fopen(path, "wb");
+    bool written = file && fwrite(text, 1, length, file) == length;
+    if (file) {
+        fclose(file);
+    }
+    free(text);
+    return written;
+}
+
+/**
+ * @copydoc logger_rate_limit
+ */
+int64_t logger_rate_limit(LogRateLimit_T *limit, int interval_ms) {
+    LARGE_INTEGER now;
+    get_high_resolution_timestamp(&now);
+    int64_t due = platform_atomic_load_relaxed_64(&limit->next_due);
+    // Of threads arriving together once the interval is up, only the one that moves it on logs
+    if (now.QuadPart < due ||
+        !platform_atomic_cas_64(&limit->next_due, &due, now.QuadPart + ((int64_t)interval_ms * g_log_flush_frequency) / 1000)) {
+        platform_atomic_fetch_add_64(&limit->suppressed, 1);
+        return -1;
+    }
+    return platform_atomic_exchange_64(&limit->suppressed, 0);
+}
+
+/**
+ * @copydoc logger_set_as_logger_thread
+ */
+void logger_set_as_logger_thread(void) {
+    g_is_logger_thread = true;
+}
+
+/**
+ * @brief Times one enqueue in LOG_METRICS_SAMPLE_EVERY, from the entry's timestamp to now.
+ * @param started The entry's timestamp.
+ */
+static void sample_enqueue_latency(int64_t started) {
+    if ((++g_enqueue_calls & (LOG_METRICS_SAMPLE_EVERY - 1)) == 0) {
+        LARGE_INTEGER now;
+        get_high_resolution_timestamp(&now);
+        log_metrics_record_enqueue(now.QuadPart - started);
+    }
+}
+
+/**
+ * @brief Whether a call at @p level gets past the calling thread's log level.
+ */
+static inline bool log_level_enabled(LogLevel level) {
+    // One thread-local load and compare for labelled threads; the rest follow the global level
+    int thread_level = (int)platform_atomic_load_relaxed_64(&log_level_this_thread);
+    if ((int)level < thread_level) {
+        return false;
+    }
+    return thread_level != LOG_LEVEL_UNSET || (int)level >= (int)platform_atomic_load_relaxed_64(&log_level_global);
+}
+
+/**
+ * @brief Finds space for an entry and fills in its header: the thread's own
+ * queue when it can take one, otherwise @p fallback on the caller's stack.
+ * @param level The log level.
+ * @param fallback Space for the entry should the queue not have it.
+ * @return Where to build the entry.
+ */
+static LogEntry_T* begin_log_entry(LogLevel level, LogEntry_T* fallback) {
+    // Once anything has gone to the overflow buffer, follow it there until it is published
+    bool overflowing = logging_thread_started && log_spill_holding(&global_log_spill);
+
+    if (logging_thread_started && !overflowing && !thread_log_queue_spilling(&global_log_queue)) {
+        // Fill in straight into the thread's own queue, committing only the bytes used
+        LogEntry_T* reserved = thread_log_queue_reserve();
+        if (reserved) {
+            init_log_entry_header(reserved, level);
+            return reserved;
+        }
+    }
+    init_log_entry_header(fallback, level);
+    return fallback;
+}
+
+/**
+ * @brief Hands a filled in entry to the logger thread.
+ * @param entry The entry, as returned by begin_log_entry.
+ * @param fallback The space passed to begin_log_entry.
+ */
+static void end_log_entry(LogEntry_T* entry, LogEntry_T* fallback) {
+    if (entry != fallback) {
+        int64_t started = entry->timestamp.QuadPart; // The entry is the logger's once committed
+        thread_log_queue_commit(entry);
+        sample_enqueue_latency(started);
+        return;
+    }
+
+    // No queue of our own (or it is full): the entry was built on the stack
+    if (!logging_thread_started) {
+        log_immediately(entry); // Nothing is draining the queues yet
+        return;
+    }
+
+    // Fall back to the shared queue; if that is full too, apply the overflow policy
+    bool overflowing = log_spill_holding(&global_log_spill);
+    if (!overflowing && log_queue_push(&global_log_queue, entry)) {
+        thread_log_queue_spilled(&global_log_queue);
+        thread_log_queue_ring();
+    } else {
+        handle_log_overflow(entry);
+    }
+    sample_enqueue_latency(entry->timestamp.QuadPart);
+}
+
+/**
+ * @brief Records a call in the flight recorder.
+ */
+static void flight_record(LogLevel level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_flight_record(level, get_thread_label_id(), format, args);
+    va_end(args);
+}
+
+void _logger_log(LogLevel level, const char* format, ...) {
+    // The flight recorder sees calls the log levels filter out
+    if ((int)level >= log_flight_level) {
+        va_list flight_args;
+        va_start(flight_args, format);
+        log_flight_record(level, get_thread_label_id(), format, flight_args);
+        va_end(flight_args);
+    }
+    if (!log_level_enabled(level)) {
+        return;
+    }
+
+    LogEntry_T fallback;
+    LogEntry_T* entry = begin_log_entry(level, &fallback);
+    va_list args;
+    va_start(args, format);
+    fill_log_message(entry, format, args);
+    va_end(args);
+    end_log_entry(entry, &fallback);
+}
+
+/**
+ * @copydoc _logger_log_fields
+ */
+void _logger_log_fields(LogLevel level, const char* message, const LogField_T* fields, size_t count) {
+    if ((int)level >= log_flight_level) {
+        char packed[LOG_MSG_BUFFER_SIZE];
+        char text[LOG_MSG_BUFFER_SIZE];
+        size_t packed_length = log_fields_encode(packed, sizeof(packed), fields, count);
+        size_t text_length = log_fields_append_text(text, sizeof(text) - 1, packed, packed_length);
+        text[text_length] = '\0';
+        flight_record(level, "%s%s", message, text);
+    }
+    if (!log_level_enabled(level)) {
+        return;
+    }
+
+    LogEntry_T fallback;
+    LogEntry_T* entry = begin_log_entry(level, &fallback);
+
+    // The message as it is, then the fields packed after its terminator
+    size_t message_length = strlen(message);
+    if (message_length >= sizeof(entry->message)) {
+        message_length = sizeof(entry->message) - 1;
+    }
+    memcpy(entry->message, message, message_length);
+    entry->message[message_length] = '\0';
+    entry->message_length = (uint32_t)message_length;
+    entry->fields_length = (uint16_t)log_fields_encode(LOG_ENTRY_FIELDS(entry),
+        sizeof(entry->message) - message_length - 1, fields, count);
+
+    end_log_entry(entry, &fallback);
+}
+
+/**
+ * @copydoc _logger_log_hex
+ */
+void _logger_log_hex(LogLevel level, const void* data, size_t length, size_t row_start, const char* format, ...) {
+    if ((int)level >= log_flight_level) {
+        va_list flight_args;
+        va_start(flight_args, format);
+        log_flight_record(level, get_thread_label_id(), format, flight_args);
+        va_end(flight_args);
+    }
+    if (!log_level_enabled(level)) {
+        return;
+    }
+
+    // An entry per slot's worth of bytes, the message on the first, each dump following on from the last
+    const uint8_t* bytes = (const uint8_t*)data;
+    row_start %= LOG_HEX_ROW_BYTES;
+    bool first = true;
+    do {
+        size_t chunk = (length < g_log_blobs.slot_bytes) ? length : g_log_blobs.slot_bytes;
+        LogEntry_T fallback;
+        LogEntry_T* entry = begin_log_entry(level, &fallback);
+        entry->blob = log_blob_store(&g_log_blobs, bytes, chunk, row_start);
+        if (entry->blob) {
+            if (first) {
+                va_list args;
+                va_start(args, format);
+                fill_log_message(entry, format, args);
+                va_end(args);
+            } else {
+                entry->message[0] = '\0';
+                entry->message_length = 0;
+            }
+        } else {
+            // Formatted now rather than deferred, so the lost dump can be noted after the message
+            size_t used = 0;
+            if (first) {
+                va_list args;
+                va_start(args, format);
+                format_log_message(entry, format, args);
+                va_end(args);
+                used = entry->message_length;
+            }
+            int written = snprintf(entry->message + used, sizeof(entry->message) - used,
+                "%s(hex dump of %llu bytes dropped, no free slot)", used ? " " : "", (unsigned long long)length);
+            if (written > 0) {
+                used += ((size_t)written < sizeof(entry->message) - used) ? (size_t)written : sizeof(entry->message) - used - 1;
+            }
+            entry->message_length = (uint32_t)used;
+            chunk = length; // The rest is lost with it
+        }
+        end_log_entry(entry, &fallback);
+
+        bytes += chunk;
+        length -= chunk;
+        row_start = (row_start + chunk) % LOG_HEX_ROW_BYTES;
+        first = false;
+    } while (length > 0);
+}
+
+/**
+ * @brief Opens the flight recorder unless it is turned off, first saving the one
+ * left by an earlier run that did not close it.
+ * @param log_directory Where crash copies go, beside the logs.
+ * @param notice Receives a line worth logging once the logger is up, or is left empty.
+ * @param size The size of @p notice.
+ */
+static void open_flight_recorder(const char* log_directory, char* notice, size_t size) {
+    if (!get_config_bool("logger", "flight_recorder", true)) {
+        return;
+    }
+    char default_name[MAX_PATH];
+#ifdef __linux__
+    snprintf(default_name, sizeof(default_name), "%s", LOG_FLIGHT_DEFAULT_FILE);
+#else
+    construct_log_file_name(default_name, sizeof(default_name), log_directory, LOG_FLIGHT_DEFAULT_FILE_NAME);
+#endif
+    const char* name = get_config_string("logger", "flight_recorder_file", default_name);
+    LogLevel level = log_level_from_string(get_config_string("logger", "flight_recorder_level", NULL), LOG_INFO);
+    int slots = get_config_int("logger", "flight_recorder_slots", LOG_FLIGHT_DEFAULT_SLOTS);
+    if (slots < 1) slots = LOG_FLIGHT_DEFAULT_SLOTS;
+
+    if (*log_directory) {
+        create_directories(log_directory);
+    }
+    char saved_name[MAX_PATH];
+    if (log_flight_save_previous(name, log_directory, saved_name, sizeof(saved_name))) {
+        snprintf(notice, size, "The last run did not close its flight recorder, saved to %s", saved_name);
+    }
+
+    char crash_name[MAX_PATH];
+    char crash_file_name[64];
+    snprintf(crash_file_name, sizeof(crash_file_name), "flight_recorder.%ld.crash", platform_process_id());
+    construct_log_file_name(crash_name, sizeof(crash_name), log_directory, crash_file_name);
+    if (!log_flight_open(name, crash_name, (uint32_t)slots, level, &g_log_binary_header)) {
+        fprintf(stderr, "Log Error: Could not create the flight recorder %s, or another process is using it\n", name);
+    }
+}
+
+/**
+ * @brief Starts the network sink if log_protocol is set.
+ */
+static void open_network_sink(void) {
+    LogNetProtocol protocol = log_net_protocol_from_string(get_config_string("logger", "log_protocol", NULL));
+    if (protocol == LOG_NET_OFF) {
+        return;
+    }
+    const char* host = get_config_string("logger", "log_host", "127.0.0.1");
+    int port = get_config_int("logger", "log_port", 7020);
+    int batch_bytes = get_config_int("logger", "log_network_batch_bytes", 0);
+    int flush_ms = get_config_int("logger", "log_network_flush_ms", 100);
+    int queue_bytes = get_config_int("logger", "log_network_queue_bytes", 1048576);
+    const char* format = get_config_string("logger", "log_network_format", NULL);
+    g_log_net_json = format && str_cmp_nocase(format, "json") == 0;
+    snprintf(g_log_net_source, sizeof(g_log_net_source), "%s", get_config_string("logger", "log_network_source", ""));
+
+    snprintf(g_log_net_destination, sizeof(g_log_net_destination), "%s:%d", host, port);
+
+    g_log_net = log_net_open(protocol, host, port, (batch_bytes > 0) ? (size_t)batch_bytes : 0,
+                             flush_ms, (queue_bytes > 0) ? (size_t)queue_bytes : 0);
+    if (!g_log_net) {
+        fprintf(stderr, "Log Error: Could not start logging to %s:%d\n", host, port);
+    }
+}
+
+/**
+ * @brief Gives the console its own small, lossy queue, sets up the ring if
+ * ring_bytes is set, and reads console_level and the route.N rules. Caller
+ * holds logging_mutex.
+ */
+static void open_routed_sinks(void) {
+    int console_queue_bytes = get_config_int("logger", "console_queue_bytes", LOG_CONSOLE_QUEUE_BYTES);
+    if (console_queue_bytes > 0) {
+        int console_flush_ms = get_config_int("logger", "console_flush_ms", LOG_CONSOLE_FLUSH_MS);
+        g_console_sink = log_sink_open(&console_sink_ops, NULL, LOG_CONSOLE_BATCH_BYTES,
+                                       console_flush_ms, (size_t)console_queue_bytes);
+        if (!g_console_sink) {
+            fprintf(stderr, "Log Error: Could not start the console thread, the logger thread will write to the console\n");
+        }
+    }
+
+    int ring_bytes = get_config_int("logger", "ring_bytes", 0);
+    if (ring_bytes > 0 && !log_ring_init(&g_log_ring, (size_t)ring_bytes)) {
+        fprintf(stderr, "Log Error: Could not allocate the log ring\n");
+    }
+
+    g_log_sinks_open = LOG_SINK_FILE | LOG_SINK_CONSOLE;
+    if (g_log_net) g_log_sinks_open |= LOG_SINK_NETWORK;
+    if (g_log_ring.data) g_log_sinks_open |= LOG_SINK_RING;
+
+    log_route_init(default_sinks());
+    log_route_set_floor(LOG_SINK_CONSOLE, log_level_from_string(get_config_string("logger", "console_level", NULL), LOG_TRACE));
+    for (int i = 1; i <= LOG_ROUTE_MAX_RULES; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "route.%d", i);
+        const char* rule = get_config_string("logger", key, NULL);
+        if (rule && !log_route_add(rule)) {
+            fprintf(stderr, "Log Error: Could not read %s = %s\n", key, rule);
+        }
+    }
+    g_log_text_routes = log_route_uses(LOG_SINK_CONSOLE | LOG_SINK_NETWORK | LOG_SINK_RING);
+}
+
+/**
+ * @brief Writes an entry the logger never published to the unpublished
+ * file, opening it first if need be. Runs in the fatal signal handler, so it
+ * builds the line itself and writes it with platform_fatal_write: the time is
+ * seconds since the Unix epoch, as nothing here may call localtime, and a
+ * deferred entry shows its format, as nothing here may call vsnprintf; the
+ * flight recorder holds the arguments.
+ */
+static void write_unpublished_entry(const LogEntry_T* entry) {
+    if (g_unpublished_fd < 0) {
+        g_unpublished_fd = platform_fatal_open(g_unpublished_name);
+        if (g_unpublished_fd < 0) {
+            return;
+        }
+    }
+
+    char* line = g_unpublished_line;
+    char* end = line + sizeof(g_unpublished_line) - 1; // Kept back for the newline
+    int64_t nanoseconds = epoch_nanoseconds(entry);
+    const char* level_name = log_level_to_string(entry->level);
+    const char* label = log_label_name(entry->label_id);
+
+    char* out = line;
+    if (nanoseconds < 0) {
+        *out++ = '-';
+        nanoseconds = -nanoseconds;
+    }
+    out = append_padded_uint(out, (uint64_t)(nanoseconds / 1000000000), 1);
+    *out++ = '.';
+    out = append_padded_uint(out, (uint64_t)(nanoseconds % 1000000000), 9);
+    *out++ = ' ';
+    out = append_text(out, level_name, strlen(level_name));
+    out = append_text(out, ": [", 3);
+    out = append_text(out, label, strlen(label));
+    out = append_text(out, "] ", 2);
+
+    const char* text = entry->format ? entry->format : entry->message;
+    size_t length = entry->format ? strlen(entry->format) : entry->message_length;
+    const char* note = entry->format ? " (arguments not formatted)" : (entry->fields_length ? " (fields not shown)" : "");
+    size_t room = (size_t)(end - out);
+    if (room > strlen(note)) {
+        room -= strlen(note);
+        out = append_text(out, text, (length < room) ? length : room);
+        out = append_text(out, note, strlen(note));
+    }
+    *out++ = '\n';
+    platform_fatal_write(g_unpublished_fd, line, (size_t)(out - line));
+
+    const LogBlob_T* blob = log_blob_get(&g_log_blobs, entry->blob);
+    if (blob && blob->length <= g_log_blobs.slot_bytes) {
+        size_t start = blob->row_start % LOG_HEX_ROW_BYTES;
+        for (size_t offset = 0; offset < blob->length;) {
+            size_t count = LOG_HEX_ROW_BYTES - start;
+            if (count > blob->length - offset) {
+                count = blob->length - offset;
+            }
+            log_hex_row(line, blob->data + offset, start, count);
+            line[LOG_HEX_ROW_LENGTH] = '\n';
+            platform_fatal_write(g_unpublished_fd, line, LOG_HEX_ROW_LENGTH + 1);
+            offset += count;
+            start = 0;
+        }
+    }
+}
+
+/**
+ * @brief Runs on a fatal signal: saves the flight recorder, writes out
+ * whatever the sinks still hold, then whatever is still queued, before the
+ * process dies.
+ */
+static void logger_fatal_signal(int signal) {
+    log_flight_crashed(signal);
+    for (int i = 0; i < g_thread_log_file_count; i++) {
+        if (thread_log_files[i].log_fp) {
+            log_writer_write_out_raw(&thread_log_files[i].writer);
+        }
+    }
+    log_writer_write_out_raw(&g_console_writer);
+
+    // Often the entries that explain the crash, the logger not having reached them
+    if (*g_unpublished_name) {
+        thread_log_queue_walk(&global_log_queue, &global_log_spill, write_unpublished_entry);
+        if (g_unpublished_fd >= 0) {
+            platform_fatal_close(g_unpublished_fd);
+        }
     }
 }
 
@@ -625,14 +2004,118 @@ bool init_logger_from_config(char* logger_init_result) {
     const char* config_timestamp_granularity = get_config_string("logger", "timestamp_granularity", NULL);
     g_log_timestamp_granularity = timestamp_granularity_from_string(config_timestamp_granularity, LOG_TS_NANOSECOND);
 
+    /* Read whether the logger thread or the caller formats messages */
+    g_log_deferred_formatting = get_config_bool("logger", "deferred_formatting", g_log_deferred_formatting);
+
+    /* Read whether identical consecutive messages are collapsed into a count */
+    g_log_collapse_repeats = get_config_bool("logger", "collapse_repeats", g_log_collapse_repeats);
+    g_log_repeat_report_ms = get_config_int("logger", "repeat_report_ms", g_log_repeat_report_ms);
+    if (g_log_repeat_report_ms < 1) g_log_repeat_report_ms = 1;
+
     /* Read ANSI colour setting */
     g_log_use_ansi_colours = get_config_bool("logger", "ansi_colours", g_log_use_ansi_colours);
 
     /* make leading zeros on the index for the log message*/
     g_log_leading_zeros = get_config_int("logger", "log_leading_zeros", g_log_leading_zeros);
+    g_log_index_width = (g_log_leading_zeros >= 0) ? g_log_leading_zeros : 12;
+    if (g_log_index_width > 20) g_log_index_width = 20; // Wider than any 64 bit index
+
+    /*
+     * The granularity is a power of 10, e.g. 1000000 for microseconds: 6 digits,
+     * each the last worth 1000000000 / 1000000 = 1000 nanoseconds.
+     */
+    g_log_fractional_width = 0;
+    for (int granularity = g_log_timestamp_granularity; granularity >= 10; granularity /= 10) {
+        g_log_fractional_width++;
+    }
+    g_log_fraction_divisor = 1000000000 / g_log_timestamp_granularity;
+
+    /* Read the log file format, text or binary */
+    const char* config_log_file_format = get_config_string("logger", "log_file_format", NULL);
+    g_log_binary_files = config_log_file_format && str_cmp_nocase(config_log_file_format, "binary") == 0;
+    g_log_json_files = config_log_file_format && str_cmp_nocase(config_log_file_format, "json") == 0;
+    {
+        /* One clock reference for the whole run, so binary files shared by threads and the flight recorder agree */
+        LARGE_INTEGER qpc_frequency, qpc_reference;
+        FILETIME file_time;
+        QueryPerformanceFrequency(&qpc_frequency);
+        QueryPerformanceCounter(&qpc_reference);
+        GetSystemTimeAsFileTime(&file_time);
+
+        g_log_binary_header.qpc_frequency = qpc_frequency.QuadPart;
+        g_log_binary_header.qpc_reference = qpc_reference.QuadPart;
+        g_log_binary_header.filetime_reference = ((uint64_t)file_time.dwHighDateTime << 32) | file_time.dwLowDateTime;
+        g_log_binary_header.timestamp_granularity = (uint32_t)g_log_timestamp_granularity;
+        g_log_binary_header.index_width = (uint8_t)g_log_index_width;
+        log_binary_init_header(&g_log_binary_header);
+    }
 
     /* Read log file size (moved higher) */
     g_log_file_size = get_config_int("logger", "log_file_size", g_log_file_size);
+    if (g_log_file_size <= 0) g_log_file_size = 10485760;
+    g_log_prepare_size = (uint64_t)g_log_file_size - (uint64_t)g_log_file_size / 4;
+
+    /* Read how many old segments to keep, by count and by total size */
+    int config_max_segments = get_config_int("logger", "max_segments", (int)g_log_max_segments);
+    g_log_max_segments = (config_max_segments > 0) ? (uint32_t)config_max_segments : 0;
+    const char* config_max_total_bytes = get_config_string("logger", "max_total_bytes", NULL);
+    if (config_max_total_bytes) {
+        g_log_max_total_bytes = platform_strtoull(config_max_total_bytes, NULL, 10);
+    }
+
+    /* Read how log files are written; mmap preallocates each segment to log_file_size */
+    const char* config_file_backend = get_config_string("logger", "file_backend", NULL);
+    g_log_file_backend = log_file_backend_from_string(config_file_backend, g_log_file_backend);
+
+    if (g_log_file_backend == LOG_FILE_BACKEND_IO_URING && g_log_aio.ring_fd < 0 &&
+        platform_aio_init(&g_log_aio, LOG_AIO_ENTRIES) != 0) {
+        fprintf(stderr, "Log Error: io_uring is not available, log files will be written with stdio\n");
+        g_log_file_backend = LOG_FILE_BACKEND_STDIO;
+    }
+
+    /* Read whether closed segments are compressed, and start the worker that does it */
+    g_log_compress_segments = get_config_bool("logger", "compress_segments", g_log_compress_segments);
+    if (g_log_compress_segments && !log_compress_start()) {
+        fprintf(stderr, "Log Error: Could not start the compression thread, segments will be left uncompressed\n");
+        g_log_compress_segments = false;
+    }
+
+    /* Read how output is batched: buffer size per sink and the longest it may sit unwritten */
+    g_log_flush_bytes = get_config_int("logger", "flush_bytes", g_log_flush_bytes);
+    if (g_log_flush_bytes < 0) g_log_flush_bytes = 0;
+    g_log_flush_interval_ms = get_config_int("logger", "flush_interval_ms", g_log_flush_interval_ms);
+    if (g_log_flush_interval_ms < 0) g_log_flush_interval_ms = 0;
+
+    LARGE_INTEGER flush_frequency;
+    QueryPerformanceFrequency(&flush_frequency);
+    g_log_flush_frequency = flush_frequency.QuadPart;
+    g_log_flush_interval_ticks = (flush_frequency.QuadPart * g_log_flush_interval_ms) / 1000;
+
+    log_writer_free(console_writer());
+    log_writer_init(&g_console_writer, stderr, (size_t)g_log_flush_bytes);
+
+    /* Read what producers do when the queues are full */
+    const char* config_overflow_policy = get_config_string("logger", "overflow_policy", NULL);
+    g_log_overflow_policy = log_overflow_policy_from_string(config_overflow_policy, g_log_overflow_policy);
+    g_log_overflow_block_ms = get_config_int("logger", "overflow_block_ms", g_log_overflow_block_ms);
+    if (g_log_overflow_block_ms < 0) g_log_overflow_block_ms = 0;
+    g_log_overflow_spill_entries = get_config_int("logger", "overflow_spill_entries", g_log_overflow_spill_entries);
+    g_log_overflow_report_ms = get_config_int("logger", "overflow_report_ms", g_log_overflow_report_ms);
+    if (g_log_overflow_report_ms < 0) g_log_overflow_report_ms = 0;
+    for (int level = LOG_TRACE; level <= LOG_FATAL; level++) {
+        platform_atomic_init_64(&g_log_dropped[level], 0);
+        g_log_dropped_reported[level] = 0;
+    }
+    if (g_log_overflow_policy == LOG_OVERFLOW_SPILL && g_log_overflow_spill_entries > 0 &&
+        !log_spill_init(&global_log_spill, (size_t)g_log_overflow_spill_entries)) {
+        fprintf(stderr, "Log Error: Could not allocate the overflow buffer, entries will be dropped instead\n");
+    }
+    int hex_dump_slots = get_config_int("logger", "hex_dump_slots", LOG_BLOB_DEFAULT_SLOTS);
+    int hex_dump_bytes = get_config_int("logger", "hex_dump_bytes", LOG_BLOB_DEFAULT_BYTES);
+    if (hex_dump_slots > 0 && hex_dump_bytes > 0 &&
+        !log_blob_init(&g_log_blobs, (size_t)hex_dump_slots, (size_t)hex_dump_bytes)) {
+        fprintf(stderr, "Log Error: Could not allocate the hex dump slots, dumps will be dropped\n");
+    }
 
 
 
@@ -669,6 +2152,20 @@ bool init_logger_from_config(char* logger_init_result) {
         sanitise_path(thread_log_files[APP_LOG_FILE_INDEX].log_file_name);
     }
 
+    /* Keep the last calls somewhere a crash cannot take them, and write out what is buffered if one comes */
+    char flight_notice[LOG_MSG_BUFFER_SIZE] = "";
+    open_flight_recorder(config_log_file_path, flight_notice, sizeof(flight_notice));
+    char unpublished_file_name[64];
+    snprintf(unpublished_file_name, sizeof(unpublished_file_name), "unpublished.%ld.crash.log", platform_process_id());
+    construct_log_file_name(g_unpublished_name, sizeof(g_unpublished_name), config_log_file_path, unpublished_file_name);
+    platform_fatal_handler_install(logger_fatal_signal);
+
+    /* Stream to a collector as well, if one is configured */
+    open_network_sink();
+
+    /* Give the console its own queue, and work out where each entry goes */
+    open_routed_sinks();
+
     /* Initialize log queue */
     log_queue_init(&global_log_queue);
 
@@ -687,6 +2184,9 @@ bool init_logger_from_config(char* logger_init_result) {
     /* Unlock mutex before returning */
     unlock_mutex(&logging_mutex);
 
+    if (*flight_notice) {
+        logger_log(LOG_WARN, "%s", flight_notice);
+    }
     return success;
 }
 
@@ -696,7 +2196,7 @@ bool init_logger_from_config(char* logger_init_result) {
  * @param level The log level to set.
  */
 void logger_set_level(LogLevel level) {
-    g_log_level = level;
+    log_level_set_global(level);
 }
 
 /**
@@ -705,23 +2205,44 @@ void logger_set_level(LogLevel level) {
  */
 void logger_set_output(LogOutput output) {
     g_log_output = output;
+    g_log_default_routes_stale = true; // Picked up by the next entry published
 }
 
 /**
  * @brief Closes the logger and releases resources.
  */
 void logger_close() {
+    logger_report_repeats(true);
+    logger_report_metrics(true);
+    log_flight_close();
+
     lock_mutex(&logging_mutex);
     // Close all thread-specific log files
     for (int i = 0; i < g_thread_log_file_count; i++) {
         if (thread_log_files[i].log_fp) {
+            log_writer_free(&thread_log_files[i].writer);
             fclose(thread_log_files[i].log_fp);
         }
+        log_segments_close(&thread_log_files[i].segments);
     }
     g_thread_log_file_count = 0;
+    log_sink_close(g_console_sink); // Writes what is queued; its writer never takes the mutex
+    g_console_sink = NULL;
+    log_writer_free(console_writer());
+    log_net_close(g_log_net);
+    g_log_net = NULL;
+    log_ring_free(&g_log_ring);
+    g_log_sinks_open = LOG_SINK_FILE | LOG_SINK_CONSOLE;
+    log_spill_free(&global_log_spill);
+    log_blob_free(&g_log_blobs);
+    platform_aio_close(&g_log_aio, log_writer_complete);
+    g_log_compress_segments = false;
 
     unlock_mutex(&logging_mutex);
 
+    // Lets the segment in hand finish; anything still queued stays uncompressed
+    log_compress_stop();
+
     if (logging_thread_started) {
         // Wait for logging thread to finish (it won't, so this is just for completeness)
         platform_thread_join(log_thread, NULL);
@@ -11,6 +11,8 @@
 #include "shutdown_handler.h"
 
 
+#define HEARTBEAT_LOG_INTERVAL_MS 60000 // Least time between HEARTBEAT lines
+
 extern bool wait_for_all_threads_to_complete(int time_ms);
 
 CONDITION_VARIABLE shutdown_condition;
@@ -146,7 +148,7 @@ int main(int argc, char* argv[]) {
         if (wait_for_all_threads_to_complete(7620)) {
             break;
         } else {
-            logger_log(LOG_DEBUG, "HEARTBEAT");
+            logger_log_every_ms(HEARTBEAT_LOG_INTERVAL_MS, LOG_DEBUG, "HEARTBEAT");
         }
     }
     return app_exit();
@@ -0,0 +1,221 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // syscall, pwrite and MAP_POPULATE under a strict -std
+#endif
+
+#include "platform_aio.h"
+
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+#if defined(__linux__)
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+int platform_aio_init(PlatformAio_T *aio, unsigned entries) {
+    memset(aio, 0, sizeof(*aio));
+    aio->ring_fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        return -1; // Too old a kernel, or io_uring switched off
+    }
+
+    aio->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    aio->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    aio->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    aio->sq_ring = mmap(NULL, aio->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd, IORING_OFF_SQ_RING);
+    aio->cq_ring = mmap(NULL, aio->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd, IORING_OFF_CQ_RING);
+    aio->sqes = mmap(NULL, aio->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring_fd, IORING_OFF_SQES);
+    if (aio->sq_ring == MAP_FAILED || aio->cq_ring == MAP_FAILED || aio->sqes == MAP_FAILED) {
+        if (aio->sq_ring != MAP_FAILED) munmap(aio->sq_ring, aio->sq_ring_size);
+        if (aio->cq_ring != MAP_FAILED) munmap(aio->cq_ring, aio->cq_ring_size);
+        if (aio->sqes != MAP_FAILED) munmap(aio->sqes, aio->sqes_size);
+        close(ring_fd);
+        memset(aio, 0, sizeof(*aio));
+        aio->ring_fd = -1;
+        return -1;
+    }
+
+    unsigned char *sq = (unsigned char *)aio->sq_ring;
+    unsigned char *cq = (unsigned char *)aio->cq_ring;
+    aio->sq_head = (unsigned *)(sq + params.sq_off.head);
+    aio->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    aio->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    aio->sq_array = (unsigned *)(sq + params.sq_off.array);
+    aio->cq_head = (unsigned *)(cq + params.cq_off.head);
+    aio->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    aio->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    aio->cqes = cq + params.cq_off.cqes;
+    aio->entries = params.sq_entries;
+    aio->ring_fd = ring_fd;
+    return 0;
+}
+
+int platform_aio_file(FILE *file) {
+    int fd = fileno(file);
+    int flags = (fd >= 0) ? fcntl(fd, F_GETFL) : -1;
+    if (flags < 0 || ((flags & O_APPEND) && fcntl(fd, F_SETFL, flags & ~O_APPEND) != 0)) {
+        return -1;
+    }
+    return fd;
+}
+
+bool platform_aio_write(PlatformAio_T *aio, int fd, const void *data, size_t length, uint64_t offset, void *context) {
+    if (aio->ring_fd < 0) {
+        return false;
+    }
+    unsigned tail = *aio->sq_tail; // Only we move the tail
+    if (tail - __atomic_load_n(aio->sq_head, __ATOMIC_ACQUIRE) >= aio->entries) {
+        if (platform_aio_submit(aio, 0) != 0) {
+            return false;
+        }
+        if (tail - __atomic_load_n(aio->sq_head, __ATOMIC_ACQUIRE) >= aio->entries) {
+            return false;
+        }
+    }
+
+    unsigned index = tail & *aio->sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)aio->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = (uint32_t)length;
+    sqe->off = offset;
+    sqe->user_data = (uint64_t)(uintptr_t)context;
+    aio->sq_array[index] = index;
+    __atomic_store_n(aio->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    aio->queued++;
+    return true;
+}
+
+int platform_aio_submit(PlatformAio_T *aio, unsigned wait_for) {
+    if (aio->ring_fd < 0) {
+        return -1;
+    }
+    if (aio->queued == 0 && wait_for == 0) {
+        return 0;
+    }
+    unsigned flags = wait_for ? IORING_ENTER_GETEVENTS : 0;
+    int submitted;
+    do {
+        submitted = io_uring_enter(aio->ring_fd, aio->queued, wait_for, flags);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted < 0) {
+        return -1;
+    }
+    aio->queued -= (unsigned)submitted;
+    aio->in_flight += (unsigned)submitted;
+    return 0;
+}
+
+unsigned platform_aio_reap(PlatformAio_T *aio, PlatformAioDone_T done) {
+    if (aio->ring_fd < 0) {
+        return 0;
+    }
+    unsigned head = *aio->cq_head; // Only we move the head
+    unsigned tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    while (head != tail) {
+        struct io_uring_cqe *cqe = (struct io_uring_cqe *)aio->cqes + (head & *aio->cq_mask);
+        done((void *)(uintptr_t)cqe->user_data, (long)cqe->res);
+        head++;
+        count++;
+    }
+    __atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+    aio->in_flight -= (count < aio->in_flight) ? count : aio->in_flight;
+    return count;
+}
+
+long platform_aio_write_now(int fd, const void *data, size_t length, uint64_t offset) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t result = pwrite(fd, bytes + written, length - written, (off_t)(offset + written));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return -1;
+        }
+        written += (size_t)result;
+    }
+    return (long)written;
+}
+
+void platform_aio_close(PlatformAio_T *aio, PlatformAioDone_T done) {
+    if (aio->ring_fd < 0) {
+        return;
+    }
+    while (aio->queued || aio->in_flight) {
+        if (platform_aio_submit(aio, 1) != 0) {
+            break;
+        }
+        platform_aio_reap(aio, done);
+    }
+    munmap(aio->sqes, aio->sqes_size);
+    munmap(aio->cq_ring, aio->cq_ring_size);
+    munmap(aio->sq_ring, aio->sq_ring_size);
+    close(aio->ring_fd);
+    aio->ring_fd = -1;
+}
+
+#else // !__linux__
+
+int platform_aio_init(PlatformAio_T *aio, unsigned entries) {
+    (void)entries;
+    memset(aio, 0, sizeof(*aio));
+    aio->ring_fd = -1;
+    return -1;
+}
+
+int platform_aio_file(FILE *file) {
+    (void)file;
+    return -1;
+}
+
+bool platform_aio_write(PlatformAio_T *aio, int fd, const void *data, size_t length, uint64_t offset, void *context) {
+    (void)aio; (void)fd; (void)data; (void)length; (void)offset; (void)context;
+    return false;
+}
+
+int platform_aio_submit(PlatformAio_T *aio, unsigned wait_for) {
+    (void)aio; (void)wait_for;
+    return -1;
+}
+
+unsigned platform_aio_reap(PlatformAio_T *aio, PlatformAioDone_T done) {
+    (void)aio; (void)done;
+    return 0;
+}
+
+long platform_aio_write_now(int fd, const void *data, size_t length, uint64_t offset) {
+    (void)fd; (void)data; (void)length; (void)offset;
+    return -1;
+}
+
+void platform_aio_close(PlatformAio_T *aio, PlatformAioDone_T done) {
+    (void)aio; (void)done;
+}
+
+#endif // __linux__
@@ -0,0 +1,167 @@
+#include "platform_mmap.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else // !_WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#ifdef _WIN32
+
+int platform_file_map(PlatformFileMap_T *map, FILE *file, size_t size) {
+    memset(map, 0, sizeof(*map));
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    LARGE_INTEGER current;
+    if (handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle, &current)) {
+        return -1;
+    }
+    if ((unsigned long long)current.QuadPart > size) {
+        size = (size_t)current.QuadPart;
+    }
+
+    // Creating the mapping extends the file to its full size
+    unsigned long long full = size;
+    map->mapping = CreateFileMappingA(handle, NULL, PAGE_READWRITE, (DWORD)(full >> 32), (DWORD)full, NULL);
+    if (!map->mapping) {
+        return -1;
+    }
+    map->address = (unsigned char *)MapViewOfFile(map->mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!map->address) {
+        CloseHandle(map->mapping);
+        map->mapping = NULL;
+        return -1;
+    }
+    map->size = size;
+    map->file = file;
+    return 0;
+}
+
+int platform_file_map_sync(PlatformFileMap_T *map, size_t offset, size_t length, bool release) {
+    (void)release; // Windows trims the working set of a file mapping by itself
+    if (!map->address || offset >= map->size) {
+        return -1;
+    }
+    if (length > map->size - offset) {
+        length = map->size - offset;
+    }
+    return FlushViewOfFile(map->address + offset, length) ? 0 : -1;
+}
+
+int platform_file_unmap(PlatformFileMap_T *map, size_t length) {
+    if (!map->address) {
+        return -1;
+    }
+    int result = 0;
+    if (!UnmapViewOfFile(map->address)) {
+        result = -1;
+    }
+    CloseHandle(map->mapping);
+    if (platform_file_truncate(map->file, length) != 0) {
+        result = -1;
+    }
+    map->address = NULL;
+    map->mapping = NULL;
+    map->size = 0;
+    return result;
+}
+
+bool platform_file_lock(FILE *file) {
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    return LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+}
+
+int platform_file_truncate(FILE *file, size_t length) {
+    return _chsize_s(_fileno(file), (long long)length) == 0 ? 0 : -1;
+}
+
+#else // !_WIN32
+
+int platform_file_map(PlatformFileMap_T *map, FILE *file, size_t size) {
+    memset(map, 0, sizeof(*map));
+    int fd = fileno(file);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        return -1;
+    }
+    if ((size_t)st.st_size > size) {
+        size = (size_t)st.st_size;
+    }
+
+    // Allocate the blocks now, so writing into the mapping never finds the disk full
+#if defined(__linux__)
+    if (posix_fallocate(fd, 0, (off_t)size) != 0) {
+        return -1;
+    }
+#else
+    if (ftruncate(fd, (off_t)size) != 0) {
+        return -1;
+    }
+#endif
+
+    void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        return -1;
+    }
+    // Written once, front to back
+    madvise(address, size, MADV_SEQUENTIAL);
+    map->address = (unsigned char *)address;
+    map->size = size;
+    map->file = file;
+    return 0;
+}
+
+int platform_file_map_sync(PlatformFileMap_T *map, size_t offset, size_t length, bool release) {
+    if (!map->address || offset >= map->size) {
+        return -1;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % page;
+    size_t end = offset + length;
+    if (end > map->size) {
+        end = map->size;
+    }
+    int result = msync(map->address + start, end - start, MS_ASYNC);
+    if (release) {
+        // Only whole pages, so the one the cursor is in stays put
+        size_t release_end = end - end % page;
+        if (release_end > start) {
+            madvise(map->address + start, release_end - start, MADV_DONTNEED);
+        }
+    }
+    return result;
+}
+
+int platform_file_unmap(PlatformFileMap_T *map, size_t length) {
+    if (!map->address) {
+        return -1;
+    }
+    int result = munmap(map->address, map->size);
+    if (platform_file_truncate(map->file, length) != 0) {
+        result = -1;
+    }
+    map->address = NULL;
+    map->size = 0;
+    return result;
+}
+
+bool platform_file_lock(FILE *file) {
+    // flock rather than fcntl, whose locks one close of any descriptor for the file drops
+    return flock(fileno(file), LOCK_EX | LOCK_NB) == 0;
+}
+
+int platform_file_truncate(FILE *file, size_t length) {
+    return ftruncate(fileno(file), (off_t)length) == 0 ? 0 : -1;
+}
+
+#endif // _WIN32
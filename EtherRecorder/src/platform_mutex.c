@@ -3,7 +3,9 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <errno.h>
 #include <pthread.h>
+#include <time.h>
 #endif
 
 /*
@@ -33,6 +35,8 @@ STATIC_ASSERT(sizeof(CRITICAL_SECTION) <= PLATFORM_MUTEX_STORAGE_SIZE,
               CRITICAL_SECTION_storage_size_too_small);
 STATIC_ASSERT(sizeof(CONDITION_VARIABLE) <= PLATFORM_COND_STORAGE_SIZE,
               CONDITION_VARIABLE_storage_size_too_small);
+STATIC_ASSERT(sizeof(HANDLE) <= PLATFORM_EVENT_STORAGE_SIZE,
+              HANDLE_storage_size_too_small);
 
 /*
  * Helper functions to obtain pointers to the underlying Windows objects.
@@ -45,6 +49,10 @@ static CONDITION_VARIABLE *win_cond(PlatformCondition_T *cond) {
     return (CONDITION_VARIABLE *)cond->opaque;
 }
 
+static HANDLE *win_event(PlatformEvent_T *event) {
+    return (HANDLE *)event->opaque;
+}
+
 int platform_mutex_init(PlatformMutex_T *mutex) {
     if (!mutex)
         return -1;
@@ -102,6 +110,35 @@ int platform_cond_destroy(PlatformCondition_T *cond) {
     return (cond ? 0 : -1);
 }
 
+int platform_event_init(PlatformEvent_T *event) {
+    if (!event)
+        return -1;
+    *win_event(event) = CreateEvent(NULL, FALSE, FALSE, NULL); // Auto-reset, initially clear
+    return *win_event(event) ? 0 : -1;
+}
+
+int platform_event_signal(PlatformEvent_T *event) {
+    if (!event)
+        return -1;
+    return SetEvent(*win_event(event)) ? 0 : -1;
+}
+
+int platform_event_wait(PlatformEvent_T *event, unsigned int timeout_ms) {
+    if (!event)
+        return -1;
+    switch (WaitForSingleObject(*win_event(event), timeout_ms)) {
+    case WAIT_OBJECT_0: return 0;
+    case WAIT_TIMEOUT:  return 1;
+    default:            return -1;
+    }
+}
+
+int platform_event_destroy(PlatformEvent_T *event) {
+    if (!event)
+        return -1;
+    return CloseHandle(*win_event(event)) ? 0 : -1;
+}
+
 #else // !_WIN32
 /* ---------------------- POSIX Implementation ---------------------- */
 
@@ -111,6 +148,16 @@ _Static_assert(sizeof(pthread_mutex_t) <= PLATFORM_MUTEX_STORAGE_SIZE,
 _Static_assert(sizeof(pthread_cond_t) <= PLATFORM_COND_STORAGE_SIZE,
                "PLATFORM_COND_STORAGE_SIZE is too small for pthread_cond_t");
 
+/* An event is a flag guarded by a mutex, with a condition to wait on. */
+typedef struct PosixEvent {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int signalled;
+} PosixEvent;
+
+_Static_assert(sizeof(PosixEvent) <= PLATFORM_EVENT_STORAGE_SIZE,
+               "PLATFORM_EVENT_STORAGE_SIZE is too small for PosixEvent");
+
 /*
  * Helper functions to obtain pointers to the underlying POSIX objects.
  */
@@ -122,6 +169,10 @@ static pthread_cond_t *posix_cond(PlatformCondition_T *cond) {
     return (pthread_cond_t *)cond->opaque;
 }
 
+static PosixEvent *posix_event(PlatformEvent_T *event) {
+    return (PosixEvent *)event->opaque;
+}
+
 int platform_mutex_init(PlatformMutex_T *mutex) {
     if (!mutex)
         return -1;
@@ -170,4 +221,61 @@ int platform_cond_destroy(PlatformCondition_T *cond) {
     return pthread_cond_destroy(posix_cond(cond));
 }
 
+int platform_event_init(PlatformEvent_T *event) {
+    if (!event)
+        return -1;
+    PosixEvent *e = posix_event(event);
+    e->signalled = 0;
+    if (pthread_mutex_init(&e->mutex, NULL) != 0)
+        return -1;
+    return pthread_cond_init(&e->cond, NULL) == 0 ? 0 : -1;
+}
+
+int platform_event_signal(PlatformEvent_T *event) {
+    if (!event)
+        return -1;
+    PosixEvent *e = posix_event(event);
+    pthread_mutex_lock(&e->mutex);
+    e->signalled = 1;
+    pthread_cond_signal(&e->cond);
+    pthread_mutex_unlock(&e->mutex);
+    return 0;
+}
+
+int platform_event_wait(PlatformEvent_T *event, unsigned int timeout_ms) {
+    if (!event)
+        return -1;
+    PosixEvent *e = posix_event(event);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    int result = 0;
+    pthread_mutex_lock(&e->mutex);
+    while (!e->signalled && result == 0) {
+        result = pthread_cond_timedwait(&e->cond, &e->mutex, &deadline);
+    }
+    int signalled = e->signalled;
+    e->signalled = 0;
+    pthread_mutex_unlock(&e->mutex);
+
+    if (signalled)
+        return 0;
+    return (result == ETIMEDOUT) ? 1 : -1;
+}
+
+int platform_event_destroy(PlatformEvent_T *event) {
+    if (!event)
+        return -1;
+    PosixEvent *e = posix_event(event);
+    pthread_cond_destroy(&e->cond);
+    return pthread_mutex_destroy(&e->mutex);
+}
+
 #endif // _WIN32
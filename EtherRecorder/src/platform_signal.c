@@ -0,0 +1,186 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // sigaction and sigaltstack under a strict -std
+#endif
+
+#include "platform_signal.h"
+
+#include <signal.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else // !_WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "platform_threads.h"
+#endif // _WIN32
+
+static volatile PlatformFatalHandler_T fatal_handler = NULL;
+
+/**
+ * @brief Runs the handler the first time only, in case it faults itself.
+ */
+static void run_fatal_handler(int signal) {
+    PlatformFatalHandler_T handler = fatal_handler;
+    fatal_handler = NULL;
+    if (handler) {
+        handler(signal);
+    }
+}
+
+#ifdef _WIN32
+
+static LONG WINAPI fatal_exception_filter(EXCEPTION_POINTERS *exception) {
+    run_fatal_handler((int)exception->ExceptionRecord->ExceptionCode);
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void fatal_abort(int signal) {
+    run_fatal_handler(signal);
+}
+
+bool platform_fatal_handler_install(PlatformFatalHandler_T handler) {
+    fatal_handler = handler;
+    platform_fatal_thread_init();
+    SetUnhandledExceptionFilter(fatal_exception_filter);
+    return signal(SIGABRT, fatal_abort) != SIG_ERR;
+}
+
+bool platform_fatal_thread_init(void) {
+    // A stack overflow leaves little to run on; this reserves some for the filter
+    ULONG guarantee = 64 * 1024;
+    return SetThreadStackGuarantee(&guarantee) != 0;
+}
+
+void platform_fatal_thread_exit(void) {
+    // The reserve goes with the thread's stack
+}
+
+int platform_fatal_open(const char *name) {
+    return _open(name, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+bool platform_fatal_write(int fd, const void *data, size_t length) {
+    const char *bytes = (const char *)data;
+    while (length > 0) {
+        unsigned int chunk = (length > 0x40000000) ? 0x40000000 : (unsigned int)length;
+        int written = _write(fd, bytes, chunk);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+void platform_fatal_close(int fd) {
+    _close(fd);
+}
+
+int platform_fatal_fileno(FILE *stream) {
+    return _fileno(stream);
+}
+
+long platform_process_id(void) {
+    return (long)GetCurrentProcessId();
+}
+
+#else // !_WIN32
+
+#define FATAL_STACK_SIZE (64 * 1024)
+
+static THREAD_LOCAL void *fatal_stack = NULL;
+
+static void fatal_signal(int signal) {
+    run_fatal_handler(signal);
+    // SA_RESETHAND has restored the default action, which this now takes
+    raise(signal);
+}
+
+bool platform_fatal_handler_install(PlatformFatalHandler_T handler) {
+    static const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    fatal_handler = handler;
+    platform_fatal_thread_init();
+
+    // SA_ONSTACK is ignored on a thread without an alternate stack
+    struct sigaction action;
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = fatal_signal;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    bool installed = true;
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        installed = sigaction(signals[i], &action, NULL) == 0 && installed;
+    }
+    return installed;
+}
+
+bool platform_fatal_thread_init(void) {
+    if (fatal_stack) {
+        return true;
+    }
+    // An alternate stack so that a stack overflow can still be handled; each thread needs its own
+    stack_t stack;
+    stack.ss_sp = malloc(FATAL_STACK_SIZE);
+    stack.ss_size = FATAL_STACK_SIZE;
+    stack.ss_flags = 0;
+    if (!stack.ss_sp || sigaltstack(&stack, NULL) != 0) {
+        free(stack.ss_sp);
+        return false;
+    }
+    fatal_stack = stack.ss_sp;
+    return true;
+}
+
+void platform_fatal_thread_exit(void) {
+    if (!fatal_stack) {
+        return;
+    }
+    stack_t stack;
+    stack.ss_sp = NULL;
+    stack.ss_size = 0;
+    stack.ss_flags = SS_DISABLE;
+    if (sigaltstack(&stack, NULL) == 0) {
+        free(fatal_stack);
+        fatal_stack = NULL;
+    }
+}
+
+int platform_fatal_open(const char *name) {
+    return open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+bool platform_fatal_write(int fd, const void *data, size_t length) {
+    const char *bytes = (const char *)data;
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+void platform_fatal_close(int fd) {
+    close(fd);
+}
+
+int platform_fatal_fileno(FILE *stream) {
+    return fileno(stream);
+}
+
+long platform_process_id(void) {
+    return (long)getpid();
+}
+
+#endif // _WIN32
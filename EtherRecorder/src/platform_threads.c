@@ -1,5 +1,13 @@
 #include "platform_threads.h"
 
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #ifdef _WIN32
 typedef struct ThreadWrapper_T{
     ThreadFunc_T func;
@@ -28,6 +36,14 @@ int platform_thread_join(PlatformThread_T thread, void **retval) {
     return (WaitForSingleObject(thread, INFINITE) == WAIT_OBJECT_0) ? 0 : -1;
 }
 
+int platform_thread_set_low_priority(void) {
+    // Background mode also lowers the thread's I/O and memory priority
+    if (SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN)) {
+        return 0;
+    }
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST) ? 0 : -1;
+}
+
 #else //!_WIN32
 
 int platform_thread_create(PlatformThread_T *thread, ThreadFunc_T func, void *arg) {
@@ -38,4 +54,15 @@ int platform_thread_join(PlatformThread_T thread, void **retval) {
     return pthread_join(thread, retval);
 }
 
+int platform_thread_set_low_priority(void) {
+#if defined(__APPLE__)
+    return pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#elif defined(__linux__)
+    // Linux applies nice values per thread, addressed by thread id
+    return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#else
+    return -1;
+#endif
+}
+
 #endif // _WIN32
@@ -21,6 +21,7 @@
     #include <libgen.h>
     #include <limits.h>
     #include <strings.h>
+    #include <dirent.h>
 #endif // _WIN32
 
 #ifdef _WIN32
@@ -165,6 +166,39 @@ int create_directories(const char* path) {
     return (platform_mkdir(tmp) != 0 && errno != EEXIST) ? -1 : 0;
 }
 
+int platform_list_directory(const char* directory, PlatformDirectoryFunc_T callback, void* context) {
+    const char* path = (directory && *directory) ? directory : ".";
+#ifdef _WIN32
+    char pattern[MAX_PATH];
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA(pattern, &find_data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    do {
+        if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            callback(find_data.cFileName, context);
+        }
+    } while (FindNextFileA(find, &find_data));
+    FindClose(find);
+#else // !_WIN32
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+    struct dirent* dir_entry;
+    while ((dir_entry = readdir(dir)) != NULL) {
+        if (dir_entry->d_type == DT_REG || dir_entry->d_type == DT_UNKNOWN) {
+            callback(dir_entry->d_name, context);
+        }
+    }
+    closedir(dir);
+#endif // _WIN32
+    return 0;
+}
+
 #ifdef _WIN32
 void DisableQuickEditMode() {
     HANDLE hInput;
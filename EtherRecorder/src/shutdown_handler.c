@@ -1,5 +1,6 @@
 #include "shutdown_handler.h"
 #include "logger.h"
+#include "thread_log_queue.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -54,6 +55,7 @@ void signal_shutdown(void) {
     if (shutdown_event) {
         SetEvent(shutdown_event);
     }
+    thread_log_queue_ring(); // Don't leave the logger parked through the shutdown
 }
 
 /**
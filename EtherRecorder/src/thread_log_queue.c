@@ -0,0 +1,516 @@
+#include "thread_log_queue.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "log_metrics.h"
+#include "platform_atomic.h"
+#include "platform_mutex.h"
+#include "platform_threads.h"
+
+typedef enum ThreadLogQueueState {
+    THREAD_LOG_QUEUE_FREE,    // Drained and available for reuse
+    THREAD_LOG_QUEUE_ACTIVE,  // Owned by a running thread
+    THREAD_LOG_QUEUE_RETIRED  // Owner has exited, waiting to be drained
+} ThreadLogQueueState;
+
+/**
+ * @brief A record in a per-thread ring: a small header followed by a log entry
+ * truncated just after its message terminator.
+ */
+typedef struct ThreadLogRecord_T {
+    uint32_t size;       // Bytes from this header to the next record, a multiple of 8
+    uint32_t is_padding; // Filler up to the end of the ring, no entry follows
+    LogEntry_T entry;
+} ThreadLogRecord_T;
+
+#define RECORD_ALIGN(n) (((n) + 7) & ~(size_t)7)
+#define RECORD_HEADER_SIZE offsetof(ThreadLogRecord_T, entry)
+// Worst case a producer needs contiguously: a full-length message
+#define RECORD_MAX_SIZE RECORD_ALIGN(sizeof(ThreadLogRecord_T))
+
+/**
+ * @brief A per-thread byte ring. head and tail are byte positions that only ever
+ * increase; head is written only by the owning thread, tail only by the logger
+ * thread, and each sits on its own cache line.
+ */
+typedef struct ThreadLogQueue_T {
+    PlatformAtomic64_T head;
+    char head_padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+    PlatformAtomic64_T tail;
+    char tail_padding[PLATFORM_CACHE_LINE_SIZE - sizeof(PlatformAtomic64_T)];
+    int64_t cached_tail;       // Producer's last view of tail, saves re-reading the logger's line
+    int64_t reserved;          // Producer only: position of the record being formatted
+    PlatformAtomic64_T state;  // ThreadLogQueueState
+    uint64_t data[THREAD_LOG_QUEUE_BYTES / sizeof(uint64_t)]; // uint64_t keeps records 8-byte aligned
+} ThreadLogQueue_T;
+
+// Queues are allocated on first use and never freed, only recycled. Slots hold
+// the queue pointer, zero until the allocating thread has published it.
+static PlatformAtomic64_T thread_log_queues[MAX_THREAD_LOG_QUEUES];
+static PlatformAtomic64_T thread_log_queue_count; // Slots reserved, may overshoot the table
+
+// Set while the logger thread is parked. Whichever producer first clears it
+// rings the doorbell, so there is one wakeup per idle period, not per entry.
+static PlatformAtomic64_T logger_parked;
+static PlatformEvent_T logger_doorbell;
+static bool logger_doorbell_ready = false; // Logger thread only
+
+static THREAD_LOCAL ThreadLogQueue_T *this_thread_log_queue = NULL;
+// Shared queue position this thread must see consumed before using its own queue again
+static THREAD_LOCAL int64_t this_thread_spilled_until = 0;
+
+/**
+ * @brief Returns the record at a byte position in a queue.
+ */
+static ThreadLogRecord_T *record_at(ThreadLogQueue_T *queue, int64_t position) {
+    return (ThreadLogRecord_T *)((unsigned char *)queue->data + (position & THREAD_LOG_QUEUE_MASK));
+}
+
+/**
+ * @brief Returns the queue in a slot, or NULL if it is not yet published.
+ */
+static ThreadLogQueue_T *thread_log_queue_at(int64_t slot) {
+    return (ThreadLogQueue_T *)(intptr_t)platform_atomic_load_64(&thread_log_queues[slot]);
+}
+
+/**
+ * @brief Returns the number of slots that may hold a queue.
+ */
+static int64_t thread_log_queue_slots_in_use(void) {
+    int64_t count = platform_atomic_load_64(&thread_log_queue_count);
+    return (count < MAX_THREAD_LOG_QUEUES) ? count : MAX_THREAD_LOG_QUEUES;
+}
+
+/**
+ * @copydoc thread_log_queue_attach
+ */
+bool thread_log_queue_attach(void) {
+    if (this_thread_log_queue) {
+        return true;
+    }
+
+    int64_t count = thread_log_queue_slots_in_use();
+
+    // Prefer recycling a queue left behind by a thread that has exited
+    for (int64_t i = 0; i < count; i++) {
+        ThreadLogQueue_T *queue = thread_log_queue_at(i);
+        int64_t expected = THREAD_LOG_QUEUE_FREE;
+        if (queue && platform_atomic_cas_64(&queue->state, &expected, THREAD_LOG_QUEUE_ACTIVE)) {
+            queue->cached_tail = platform_atomic_load_64(&queue->tail);
+            this_thread_log_queue = queue;
+            return true;
+        }
+    }
+
+    // This can run before the logger (and logging_mutex) is initialised, so
+    // slots are reserved with an atomic increment rather than under a lock.
+    int64_t slot = platform_atomic_fetch_add_64(&thread_log_queue_count, 1);
+    if (slot >= MAX_THREAD_LOG_QUEUES) {
+        return false;
+    }
+
+    ThreadLogQueue_T *queue = (ThreadLogQueue_T *)malloc(sizeof(ThreadLogQueue_T));
+    if (!queue) {
+        return false; // The slot stays empty, which the logger skips
+    }
+    platform_atomic_init_64(&queue->head, 0);
+    platform_atomic_init_64(&queue->tail, 0);
+    platform_atomic_init_64(&queue->state, THREAD_LOG_QUEUE_ACTIVE);
+    queue->cached_tail = 0;
+    queue->reserved = 0;
+
+    // Release the initialised queue to the logger
+    platform_atomic_store_64(&thread_log_queues[slot], (int64_t)(intptr_t)queue);
+
+    this_thread_log_queue = queue;
+    return true;
+}
+
+/**
+ * @copydoc thread_log_queue_detach
+ */
+void thread_log_queue_detach(void) {
+    if (!this_thread_log_queue) {
+        return;
+    }
+    // The logger frees it for reuse once everything pushed so far is published
+    platform_atomic_store_64(&this_thread_log_queue->state, THREAD_LOG_QUEUE_RETIRED);
+    this_thread_log_queue = NULL;
+}
+
+/**
+ * @brief Checks there are @p needed free bytes after @p head, refreshing the tail if not.
+ */
+static bool has_space(ThreadLogQueue_T *queue, int64_t head, int64_t needed) {
+    if (head + needed - queue->cached_tail <= THREAD_LOG_QUEUE_BYTES) {
+        return true;
+    }
+    // Looks full from our cached view, check where the logger really is
+    queue->cached_tail = platform_atomic_load_64(&queue->tail);
+    return head + needed - queue->cached_tail <= THREAD_LOG_QUEUE_BYTES;
+}
+
+/**
+ * @copydoc thread_log_queue_spilling
+ */
+bool thread_log_queue_spilling(LogQueue_T *shared_queue) {
+    if (this_thread_spilled_until == 0) {
+        return false;
+    }
+    if (platform_atomic_load_64(&shared_queue->tail) < this_thread_spilled_until) {
+        return true;
+    }
+    this_thread_spilled_until = 0;
+    return false;
+}
+
+/**
+ * @copydoc thread_log_queue_spilled
+ */
+void thread_log_queue_spilled(LogQueue_T *shared_queue) {
+    // The head is at or beyond our entry, which is all the ordering needs
+    this_thread_spilled_until = platform_atomic_load_64(&shared_queue->head);
+}
+
+/**
+ * @copydoc thread_log_queue_reserve
+ */
+LogEntry_T *thread_log_queue_reserve(void) {
+    ThreadLogQueue_T *queue = this_thread_log_queue;
+    if (!queue) {
+        return NULL;
+    }
+
+    int64_t head = platform_atomic_load_relaxed_64(&queue->head);
+    int64_t contiguous = THREAD_LOG_QUEUE_BYTES - (head & THREAD_LOG_QUEUE_MASK);
+
+    if (contiguous < (int64_t)RECORD_MAX_SIZE) {
+        // Not enough room before the end: pad to the end and start at the beginning
+        if (!has_space(queue, head, contiguous + RECORD_MAX_SIZE)) {
+            return NULL;
+        }
+        ThreadLogRecord_T *padding = record_at(queue, head);
+        padding->size = (uint32_t)contiguous;
+        padding->is_padding = 1;
+        head += contiguous; // Published together with the record at commit
+    } else if (!has_space(queue, head, RECORD_MAX_SIZE)) {
+        return NULL;
+    }
+
+    queue->reserved = head;
+    ThreadLogRecord_T *record = record_at(queue, head);
+    record->is_padding = 0;
+    return &record->entry;
+}
+
+/**
+ * @brief Signals the logger if it has parked. The caller must have published with
+ * full ordering first, which pairs with the fence in thread_log_queue_wait: either
+ * the logger sees what was just published, or this sees that it has parked.
+ */
+static void wake_parked_logger(void) {
+    if (platform_atomic_load_seq_cst_64(&logger_parked) &&
+        platform_atomic_exchange_64(&logger_parked, 0)) {
+        platform_event_signal(&logger_doorbell);
+    }
+}
+
+/**
+ * @copydoc thread_log_queue_commit
+ */
+void thread_log_queue_commit(LogEntry_T *entry) {
+    ThreadLogQueue_T *queue = this_thread_log_queue;
+    ThreadLogRecord_T *record = record_at(queue, queue->reserved);
+
+    record->size = (uint32_t)RECORD_ALIGN(RECORD_HEADER_SIZE + LOG_ENTRY_SIZE(entry));
+    // An exchange rather than a release store, so that the check of logger_parked
+    // cannot come before it; on this, the hot path, it is cheaper than a separate fence
+    platform_atomic_exchange_64(&queue->head, queue->reserved + record->size);
+    wake_parked_logger();
+}
+
+/**
+ * @copydoc thread_log_queue_ring
+ */
+void thread_log_queue_ring(void) {
+    // Orders whatever was just published before the check, as commit's exchange does
+    platform_atomic_fence();
+    wake_parked_logger();
+}
+
+/**
+ * @brief Checks whether anything has been published that the logger has not yet taken.
+ */
+static bool has_pending_entries(LogQueue_T *shared_queue, LogSpill_T *spill) {
+    if (spill && log_spill_pending(spill) > 0) {
+        return true;
+    }
+
+    LogQueueStats_T shared_stats;
+    log_queue_get_stats(shared_queue, &shared_stats);
+    if (shared_stats.enqueued != shared_stats.dequeued) {
+        return true;
+    }
+
+    int64_t count = thread_log_queue_slots_in_use();
+    for (int64_t i = 0; i < count; i++) {
+        ThreadLogQueue_T *queue = thread_log_queue_at(i);
+        if (queue && platform_atomic_load_64(&queue->head) != platform_atomic_load_relaxed_64(&queue->tail)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @copydoc thread_log_queue_wait
+ */
+void thread_log_queue_wait(LogQueue_T *shared_queue, LogSpill_T *spill, unsigned int timeout_ms) {
+    if (!logger_doorbell_ready) {
+        // Producers only signal after seeing logger_parked, which is set below
+        platform_event_init(&logger_doorbell);
+        logger_doorbell_ready = true;
+    }
+
+    platform_atomic_exchange_64(&logger_parked, 1);
+    platform_atomic_fence();
+
+    // Anything published before a producer could have seen the flag is caught here
+    if (has_pending_entries(shared_queue, spill)) {
+        if (!platform_atomic_exchange_64(&logger_parked, 0)) {
+            // A producer cleared it and is about to ring, absorb the signal
+            platform_event_wait(&logger_doorbell, timeout_ms);
+        }
+        return;
+    }
+
+    if (platform_event_wait(&logger_doorbell, timeout_ms) != 0) {
+        platform_atomic_exchange_64(&logger_parked, 0); // Timed out, nobody rang
+    }
+}
+
+/**
+ * @brief Returns the entry at @p *tail, stepping over padding, or NULL if there is none before @p head.
+ */
+static const LogEntry_T *peek_entry(ThreadLogQueue_T *queue, int64_t *tail, int64_t head) {
+    while (*tail != head) {
+        ThreadLogRecord_T *record = record_at(queue, *tail);
+        if (!record->is_padding) {
+            return &record->entry;
+        }
+        *tail += record->size;
+    }
+    return NULL;
+}
+
+/**
+ * @copydoc thread_log_queue_drain
+ */
+size_t thread_log_queue_drain(LogQueue_T *shared_queue, LogSpill_T *spill, LogPublishFunc_T publish) {
+    ThreadLogQueue_T *queues[MAX_THREAD_LOG_QUEUES];
+    const LogEntry_T *next[MAX_THREAD_LOG_QUEUES];
+    int64_t heads[MAX_THREAD_LOG_QUEUES];
+    int64_t tails[MAX_THREAD_LOG_QUEUES];
+    int64_t states[MAX_THREAD_LOG_QUEUES];
+    int64_t count = thread_log_queue_slots_in_use();
+    size_t published = 0;
+
+    // Bound the overflow buffer, then the shared queue, before snapshotting the
+    // per-thread queues. A thread goes back to an earlier of these only once
+    // what it put in a later one has been published, so everything it logged
+    // before an entry counted here is inside the later bounds and merges first.
+    size_t spill_remaining = spill ? log_spill_pending(spill) : 0;
+
+    LogQueueStats_T shared_stats;
+    log_queue_get_stats(shared_queue, &shared_stats);
+    uint64_t shared_remaining = shared_stats.enqueued - shared_stats.dequeued;
+
+    // Snapshot how far each producer had got; the state is read first so a
+    // retired queue's final entries are guaranteed to be inside the snapshot.
+    for (int64_t i = 0; i < count; i++) {
+        ThreadLogQueue_T *queue = queues[i] = thread_log_queue_at(i);
+        next[i] = NULL;
+        if (!queue) {
+            states[i] = THREAD_LOG_QUEUE_FREE;
+            heads[i] = tails[i] = 0;
+            continue;
+        }
+        states[i] = platform_atomic_load_64(&queue->state);
+        heads[i] = platform_atomic_load_64(&queue->head);
+        tails[i] = platform_atomic_load_relaxed_64(&queue->tail);
+        next[i] = peek_entry(queue, &tails[i], heads[i]);
+    }
+
+    int64_t fullest = 0;
+    for (int64_t i = 0; i < count; i++) {
+        if (heads[i] - tails[i] > fullest) {
+            fullest = heads[i] - tails[i];
+        }
+    }
+    log_metrics_record_depths(shared_remaining, (uint64_t)fullest, spill_remaining);
+
+    for (;;) {
+        // K-way merge: pick the oldest head across all queues
+        const LogEntry_T *oldest = shared_remaining ? log_queue_peek(shared_queue) : NULL;
+        int64_t oldest_queue = -1;
+
+        const LogEntry_T *spilled = spill_remaining ? log_spill_peek(spill) : NULL;
+        if (spilled && (!oldest || spilled->timestamp.QuadPart < oldest->timestamp.QuadPart)) {
+            oldest = spilled;
+            oldest_queue = -2;
+        }
+
+        for (int64_t i = 0; i < count; i++) {
+            if (next[i] && (!oldest || next[i]->timestamp.QuadPart < oldest->timestamp.QuadPart)) {
+                oldest = next[i];
+                oldest_queue = i;
+            }
+        }
+
+        if (!oldest) {
+            break;
+        }
+
+        // Published in place, the record is only released afterwards
+        publish(oldest);
+        published++;
+
+        if (oldest_queue == -2) {
+            log_spill_consume(spill);
+            spill_remaining--;
+        } else if (oldest_queue < 0) {
+            log_queue_consume(shared_queue);
+            shared_remaining--;
+        } else {
+            ThreadLogQueue_T *queue = queues[oldest_queue];
+            tails[oldest_queue] += record_at(queue, tails[oldest_queue])->size;
+            next[oldest_queue] = peek_entry(queue, &tails[oldest_queue], heads[oldest_queue]);
+            platform_atomic_store_64(&queue->tail, tails[oldest_queue]);
+        }
+    }
+
+    for (int64_t i = 0; i < count; i++) {
+        if (!queues[i]) {
+            continue;
+        }
+        // Releases any trailing padding stepped over by peek_entry
+        platform_atomic_store_64(&queues[i]->tail, tails[i]);
+        // Recycle queues whose owners have gone and which are now empty
+        if (states[i] == THREAD_LOG_QUEUE_RETIRED && tails[i] == heads[i]) {
+            platform_atomic_store_64(&queues[i]->state, THREAD_LOG_QUEUE_FREE);
+        }
+    }
+
+    return published;
+}
+
+/**
+ * @brief Returns the entry at @p *position in a queue being walked, stepping
+ * over padding, or NULL if there is none before @p head. Stops at a record
+ * whose size makes no sense, as one the crash tore might.
+ */
+static const LogEntry_T *walk_entry(ThreadLogQueue_T *queue, int64_t *position, int64_t head) {
+    while (*position < head) {
+        ThreadLogRecord_T *record = record_at(queue, *position);
+        if (record->size < RECORD_HEADER_SIZE || record->size > RECORD_MAX_SIZE || record->size > head - *position) {
+            *position = head;
+            return NULL;
+        }
+        if (!record->is_padding) {
+            return &record->entry;
+        }
+        *position += record->size;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the entry at @p *position in the shared queue, skipping
+ * slots a producer has not published, or NULL if there is none before @p head.
+ */
+static const LogEntry_T *walk_shared_entry(LogQueue_T *queue, int64_t *position, int64_t head) {
+    for (; *position < head; (*position)++) {
+        LogQueueSlot_T *slot = &queue->slots[*position & LOG_QUEUE_MASK];
+        if (platform_atomic_load_64(&slot->sequence) == *position + 1) {
+            return &slot->entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @copydoc thread_log_queue_walk
+ */
+size_t thread_log_queue_walk(LogQueue_T *shared_queue, LogSpill_T *spill, LogPublishFunc_T visit) {
+    ThreadLogQueue_T *queues[MAX_THREAD_LOG_QUEUES];
+    const LogEntry_T *next[MAX_THREAD_LOG_QUEUES];
+    int64_t heads[MAX_THREAD_LOG_QUEUES];
+    int64_t positions[MAX_THREAD_LOG_QUEUES];
+    int64_t count = thread_log_queue_slots_in_use();
+    size_t visited = 0;
+
+    // Nothing is consumed, so the bounds are private copies of the positions
+    int64_t shared_position = platform_atomic_load_64(&shared_queue->tail);
+    int64_t shared_head = platform_atomic_load_64(&shared_queue->head);
+    if (shared_head - shared_position > LOG_QUEUE_SIZE) {
+        shared_position = shared_head - LOG_QUEUE_SIZE;
+    }
+    const LogEntry_T *shared_next = walk_shared_entry(shared_queue, &shared_position, shared_head);
+
+    int64_t spill_position = 0;
+    int64_t spill_head = 0;
+    if (spill && spill->entries) {
+        spill_position = platform_atomic_load_64(&spill->tail);
+        spill_head = platform_atomic_load_64(&spill->head);
+    }
+
+    for (int64_t i = 0; i < count; i++) {
+        ThreadLogQueue_T *queue = queues[i] = thread_log_queue_at(i);
+        heads[i] = positions[i] = 0;
+        next[i] = NULL;
+        if (queue) {
+            heads[i] = platform_atomic_load_64(&queue->head);
+            positions[i] = platform_atomic_load_64(&queue->tail);
+            next[i] = walk_entry(queue, &positions[i], heads[i]);
+        }
+    }
+
+    for (;;) {
+        const LogEntry_T *oldest = shared_next;
+        int64_t oldest_queue = -1;
+
+        const LogEntry_T *spilled = (spill_position < spill_head) ? &spill->entries[spill_position % spill->capacity] : NULL;
+        if (spilled && (!oldest || spilled->timestamp.QuadPart < oldest->timestamp.QuadPart)) {
+            oldest = spilled;
+            oldest_queue = -2;
+        }
+
+        for (int64_t i = 0; i < count; i++) {
+            if (next[i] && (!oldest || next[i]->timestamp.QuadPart < oldest->timestamp.QuadPart)) {
+                oldest = next[i];
+                oldest_queue = i;
+            }
+        }
+
+        if (!oldest) {
+            break;
+        }
+
+        visit(oldest);
+        visited++;
+
+        if (oldest_queue == -2) {
+            spill_position++;
+        } else if (oldest_queue < 0) {
+            shared_position++;
+            shared_next = walk_shared_entry(shared_queue, &shared_position, shared_head);
+        } else {
+            ThreadLogQueue_T *queue = queues[oldest_queue];
+            positions[oldest_queue] += record_at(queue, positions[oldest_queue])->size;
+            next[oldest_queue] = walk_entry(queue, &positions[oldest_queue], heads[oldest_queue]);
+        }
+    }
+
+    return visited;
+}
@@ -0,0 +1,385 @@
+/**
+ * @file bench_logger.c
+ * @brief Drives the whole logging stack and reports what it costs.
+ *
+ * The logger is set up from a generated config and its thread is started
+ * the way the application starts it, through start_threads with every other
+ * application thread suppressed, so entries are drained and written by
+ * logger_thread_function itself. Producer threads then call _logger_log as
+ * fast as they can, with a message of a set size at levels drawn from a mix,
+ * timing each call.
+ *
+ * The target is a directory, for the logger's files, or "null", which sends
+ * every entry to the console and the console to /dev/null, so only rendering
+ * and the logger's own work are measured. Point -d at a tmpfs (/dev/shm on
+ * Linux) and at a real disk to compare the two.
+ *
+ * One JSON object is printed per run: ns per call, the p50, p99 and p99.9 of
+ * the time a call took to queue its entry, the rate logger_thread_function
+ * drained them at, the publish lag and the drops.
+ *
+ * Usage: bench-logger [-t threads] [-n calls_per_thread] [-s message_bytes]
+ *                     [-m level:weight,...] [-l log_level] [-d directory|null]
+ *                     [-o key=value]...
+ * -o adds a [logger] setting, e.g. -o file_backend=mmap -o log_file_format=binary.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_config.h"
+#include "app_thread.h"
+#include "log_level.h"
+#include "log_metrics.h"
+#include "logger.h"
+#include "platform_atomic.h"
+#include "platform_threads.h"
+#include "platform_utils.h"
+#include "shutdown_handler.h"
+#include "thread_log_queue.h"
+
+#define MAX_THREADS 64
+#define MAX_SETTINGS 32
+#define MIX_SIZE 1024            // Levels are taken from a table this long, in turn
+#define DRAIN_TIMEOUT_NS 60000000000LL
+#define TIMER_CALIBRATION 10000
+
+extern volatile bool logger_ready;
+extern bool wait_for_all_threads_to_complete(int time_ms);
+
+typedef struct BenchOptions_T {
+    int threads;
+    long calls;
+    int message_bytes;
+    const char *mix;
+    const char *log_level;
+    const char *directory;
+    const char *settings[MAX_SETTINGS];
+    int setting_count;
+} BenchOptions_T;
+
+typedef struct BenchThread_T {
+    PlatformThread_T thread;
+    char label[32];
+    long calls;
+    uint32_t *samples;           // ns per call
+    long long elapsed_ns;
+} BenchThread_T;
+
+static BenchOptions_T g_options = { 1, 200000, 100, "debug:40,info:50,warn:9,error:1", "DEBUG", "bench_logs", { NULL }, 0 };
+static LogLevel g_mix[MIX_SIZE];
+static char g_payload[LOG_MSG_BUFFER_SIZE];
+static PlatformAtomic64_T g_started;
+static volatile bool g_go = false;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t count, double fraction) {
+    size_t index = (size_t)(fraction * (double)count);
+    return count ? sorted[(index < count) ? index : count - 1] : 0;
+}
+
+/**
+ * @brief Fills the level table from "level:weight,...", spreading each level through it.
+ * @return false if the mix cannot be read.
+ */
+static bool parse_mix(const char *mix) {
+    LogLevel levels[LOG_FATAL + 1];
+    long weights[LOG_FATAL + 1];
+    long total = 0;
+    int count = 0;
+
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", mix);
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        char *colon = strchr(item, ':');
+        if (!colon || count == LOG_FATAL + 1) {
+            return false;
+        }
+        *colon = '\0';
+        levels[count] = log_level_from_string(item, (LogLevel)(LOG_FATAL + 1));
+        weights[count] = atol(colon + 1);
+        if (levels[count] == (LogLevel)(LOG_FATAL + 1) || weights[count] <= 0) {
+            return false;
+        }
+        total += weights[count++];
+    }
+    if (!total) {
+        return false;
+    }
+
+    // Each slot takes the level furthest behind its share, so levels are interleaved, not in runs
+    long given[LOG_FATAL + 1] = { 0 };
+    for (int slot = 0; slot < MIX_SIZE; slot++) {
+        int best = 0;
+        double best_lag = -1.0;
+        for (int i = 0; i < count; i++) {
+            double lag = (double)weights[i] * (slot + 1) / (double)total - (double)given[i];
+            if (lag > best_lag) {
+                best_lag = lag;
+                best = i;
+            }
+        }
+        g_mix[slot] = levels[best];
+        given[best]++;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the config the logger is set up from: the -o settings first, as
+ * the first of a key is the one read, then the bench's own.
+ * @return false if it cannot be written.
+ */
+static bool write_config(const char *file_name, bool null_target) {
+    FILE *file = fopen(file_name, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "[logger]\n");
+    for (int i = 0; i < g_options.setting_count; i++) {
+        fprintf(file, "%s\n", g_options.settings[i]);
+    }
+    fprintf(file, "log_level=%s\n", g_options.log_level);
+    fprintf(file, "log_destination=%s\n", null_target ? "screen" : "file");
+    fprintf(file, "log_file_path=%s\n", null_target ? "/tmp" : g_options.directory);
+    fprintf(file, "log_file_name=bench_logger.log\n");
+    fprintf(file, "purge_logs_on_restart=true\n");
+    fprintf(file, "console_queue_bytes=0\n"); // The logger thread writes the console itself, dropping nothing
+    fprintf(file, "ansi_colours=false\n");
+    fprintf(file, "collapse_repeats=false\n");
+    fprintf(file, "compress_segments=false\n");
+    fprintf(file, "flight_recorder=false\n");
+    fprintf(file, "[debug]\n");
+    fprintf(file, "suppress_threads=CLIENT,COMMAND_INTERFACE,CLIENT.SEND,CLIENT.RECEIVE\n");
+    return fclose(file) == 0;
+}
+
+/**
+ * @brief A producer: waits for the others, then logs its calls, timing each.
+ */
+static void *producer_thread_function(void *arg) {
+    BenchThread_T *bench = (BenchThread_T *)arg;
+    init_thread_timestamp_system();
+    set_thread_label(bench->label);
+
+    platform_atomic_fetch_add_64(&g_started, 1);
+    while (!g_go) {
+        platform_cpu_relax();
+    }
+
+    long long began = now_ns();
+    for (long i = 0; i < bench->calls; i++) {
+        long long before = now_ns();
+        _logger_log(g_mix[i & (MIX_SIZE - 1)], "%s %ld", g_payload, i);
+        long long took = now_ns() - before;
+        bench->samples[i] = (took > UINT32_MAX) ? UINT32_MAX : (uint32_t)took;
+    }
+    bench->elapsed_ns = now_ns() - began;
+
+    // As app_thread does, so what is queued is drained before the queue is reused
+    thread_log_queue_detach();
+    log_level_unregister_thread();
+    return NULL;
+}
+
+/**
+ * @brief The cost of reading the clock, which every sample includes.
+ */
+static long long timer_overhead_ns(void) {
+    static uint32_t samples[TIMER_CALIBRATION];
+    for (int i = 0; i < TIMER_CALIBRATION; i++) {
+        long long before = now_ns();
+        samples[i] = (uint32_t)(now_ns() - before);
+    }
+    qsort(samples, TIMER_CALIBRATION, sizeof(samples[0]), compare_uint32);
+    return samples[TIMER_CALIBRATION / 2];
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-t threads] [-n calls_per_thread] [-s message_bytes] [-m level:weight,...]\n"
+                    "       [-l log_level] [-d directory|null] [-o key=value]...\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "-t") == 0) g_options.threads = atoi(value);
+        else if (strcmp(argv[i], "-n") == 0) g_options.calls = atol(value);
+        else if (strcmp(argv[i], "-s") == 0) g_options.message_bytes = atoi(value);
+        else if (strcmp(argv[i], "-m") == 0) g_options.mix = value;
+        else if (strcmp(argv[i], "-l") == 0) g_options.log_level = value;
+        else if (strcmp(argv[i], "-d") == 0) g_options.directory = value;
+        else if (strcmp(argv[i], "-o") == 0 && g_options.setting_count < MAX_SETTINGS) g_options.settings[g_options.setting_count++] = value;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (g_options.threads < 1 || g_options.threads > MAX_THREADS || g_options.calls < 1 ||
+        g_options.message_bytes < 1 || g_options.message_bytes > LOG_MSG_BUFFER_SIZE - 32) {
+        fprintf(stderr, "bench-logger: threads must be 1 to %d, calls above 0, message_bytes 1 to %d\n",
+            MAX_THREADS, LOG_MSG_BUFFER_SIZE - 32);
+        return 2;
+    }
+    if (!parse_mix(g_options.mix)) {
+        fprintf(stderr, "bench-logger: cannot read the level mix %s\n", g_options.mix);
+        return 2;
+    }
+    memset(g_payload, 'x', (size_t)g_options.message_bytes);
+
+    bool null_target = (strcmp(g_options.directory, "null") == 0);
+    char config_name[512];
+    if (null_target) {
+        snprintf(config_name, sizeof(config_name), "/tmp/bench_logger.ini");
+    } else {
+        create_directories(g_options.directory);
+        snprintf(config_name, sizeof(config_name), "%s/bench_logger.ini", g_options.directory);
+    }
+    char result[LOG_MSG_BUFFER_SIZE];
+    if (!write_config(config_name, null_target) || !load_config(config_name, result)) {
+        fprintf(stderr, "bench-logger: cannot write or read %s\n", config_name);
+        return 1;
+    }
+    remove(config_name);
+
+    // Calls that get past the level, which the logger thread should drain
+    LogLevel threshold = log_level_from_string(g_options.log_level, LOG_DEBUG);
+    uint64_t expected = 0;
+    for (long i = 0; i < g_options.calls; i++) {
+        expected += (g_mix[i & (MIX_SIZE - 1)] >= threshold);
+    }
+    expected *= (uint64_t)g_options.threads;
+
+    static BenchThread_T threads[MAX_THREADS];
+    for (int i = 0; i < g_options.threads; i++) {
+        snprintf(threads[i].label, sizeof(threads[i].label), "BENCH.%d", i + 1);
+        threads[i].calls = g_options.calls;
+        threads[i].samples = (uint32_t *)malloc((size_t)g_options.calls * sizeof(uint32_t));
+        if (!threads[i].samples) {
+            fprintf(stderr, "bench-logger: out of memory for samples\n");
+            return 1;
+        }
+    }
+    long long timer_ns = timer_overhead_ns();
+
+    // Set up as main does, then start the logger thread alone
+    init_thread_timestamp_system();
+    set_thread_label("MAIN");
+    if (null_target && !freopen("/dev/null", "w", stderr)) {
+        fprintf(stderr, "bench-logger: cannot send the console to /dev/null\n");
+        return 1;
+    }
+    if (!init_logger_from_config(result)) {
+        fprintf(stderr, "bench-logger: %s\n", result);
+        return 1;
+    }
+    start_threads();
+    while (!logger_ready) {
+        sleep_ms(1);
+    }
+
+    platform_atomic_init_64(&g_started, 0);
+    for (int i = 0; i < g_options.threads; i++) {
+        platform_thread_create(&threads[i].thread, producer_thread_function, &threads[i]);
+    }
+    while (platform_atomic_load_64(&g_started) < g_options.threads) {
+        sleep_ms(1);
+    }
+
+    LogMetrics_T before, after;
+    log_metrics_get(&before);
+    uint64_t dropped_before = logger_get_dropped();
+    long long began = now_ns();
+    g_go = true;
+    for (int i = 0; i < g_options.threads; i++) {
+        platform_thread_join(threads[i].thread, NULL);
+    }
+    long long produced_ns = now_ns() - began;
+
+    // Drained once every call that got past the level is published or dropped
+    uint64_t drained, dropped;
+    long long drained_ns;
+    bool complete;
+    for (;;) {
+        log_metrics_get(&after);
+        drained = after.publish_lag_count - before.publish_lag_count;
+        dropped = logger_get_dropped() - dropped_before;
+        drained_ns = now_ns() - began;
+        complete = (drained + dropped >= expected);
+        if (complete || drained_ns > DRAIN_TIMEOUT_NS) {
+            break;
+        }
+        sleep_ms(1);
+    }
+
+    signal_shutdown();
+    wait_for_all_threads_to_complete(10000);
+    logger_close();
+    free_config();
+
+    // Every call's time, all threads together
+    size_t count = (size_t)g_options.threads * (size_t)g_options.calls;
+    uint32_t *samples = (uint32_t *)malloc(count * sizeof(uint32_t));
+    long long elapsed_total = 0;
+    for (int i = 0; i < g_options.threads; i++) {
+        if (samples) {
+            memcpy(samples + (size_t)i * (size_t)g_options.calls, threads[i].samples, (size_t)g_options.calls * sizeof(uint32_t));
+        }
+        elapsed_total += threads[i].elapsed_ns;
+        free(threads[i].samples);
+    }
+    if (!samples) {
+        fprintf(stdout, "{\"error\":\"out of memory for samples\"}\n");
+        return 1;
+    }
+    qsort(samples, count, sizeof(samples[0]), compare_uint32);
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    uint64_t lag_buckets[LOG_METRICS_BUCKETS];
+    for (int b = 0; b < LOG_METRICS_BUCKETS; b++) {
+        lag_buckets[b] = after.publish_lag[b] - before.publish_lag[b];
+    }
+    double ns_per_tick = 1e9 / (double)frequency.QuadPart;
+
+    printf("{\"target\":\"%s\",\"threads\":%d,\"calls_per_thread\":%ld,\"message_bytes\":%d,"
+           "\"mix\":\"%s\",\"log_level\":\"%s\",\"settings\":\"",
+        g_options.directory, g_options.threads, g_options.calls, g_options.message_bytes,
+        g_options.mix, g_options.log_level);
+    for (int i = 0; i < g_options.setting_count; i++) {
+        printf("%s%s", i ? " " : "", g_options.settings[i]);
+    }
+    printf("\",\"calls\":%llu,\"logged\":%llu,\"ns_per_call\":%.1f,\"timer_ns\":%lld,"
+           "\"enqueue_p50_ns\":%u,\"enqueue_p99_ns\":%u,\"enqueue_p999_ns\":%u,\"enqueue_max_ns\":%u,"
+           "\"produce_s\":%.6f,\"calls_per_s\":%.0f,\"drained\":%llu,\"drain_s\":%.6f,\"drained_per_s\":%.0f,"
+           "\"publish_lag_p50_ns\":%.0f,\"publish_lag_p99_ns\":%.0f,\"dropped\":%llu,\"complete\":%s}\n",
+        (unsigned long long)count, (unsigned long long)expected,
+        (double)elapsed_total / (double)count, timer_ns,
+        percentile(samples, count, 0.50), percentile(samples, count, 0.99),
+        percentile(samples, count, 0.999), samples[count - 1],
+        produced_ns / 1e9, (double)count * 1e9 / (double)produced_ns,
+        (unsigned long long)drained, drained_ns / 1e9, (double)drained * 1e9 / (double)drained_ns,
+        (double)log_metrics_percentile(lag_buckets, drained, 0.50) * ns_per_tick,
+        (double)log_metrics_percentile(lag_buckets, drained, 0.99) * ns_per_tick,
+        (unsigned long long)dropped, complete ? "true" : "false");
+    free(samples);
+    return complete ? 0 : 1;
+}
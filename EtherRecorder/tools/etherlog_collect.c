@@ -0,0 +1,259 @@
+/**
+ * @file etherlog_collect.c
+ * @brief Receives the lines sent by the logger's network sink and writes them out.
+ *
+ * Listens for UDP datagrams and TCP connections on the same port. Each
+ * datagram holds whole lines; a TCP stream is split on newlines, so a line
+ * cut across two reads is only written once it is complete. Lines are
+ * written as they arrive, in arrival order across senders; configure
+ * log_network_source on each sender to tell them apart.
+ *
+ * Usage: etherlog-collect [-p port] [-o file] [-n lines] [-s seconds]
+ *   -n and -s exit after that many lines or seconds; counts go to stderr.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 64
+#define DATAGRAM_MAX 65536
+#define CLIENT_BUFFER_SIZE 65536 // Longest TCP line kept whole, longer ones are written in pieces
+
+typedef struct CollectClient_T {
+    int fd;
+    size_t used;
+    char buffer[CLIENT_BUFFER_SIZE];
+} CollectClient_T;
+
+typedef struct CollectStats_T {
+    unsigned long long lines;
+    unsigned long long bytes;
+    unsigned long long datagrams;
+    unsigned long long connections;
+} CollectStats_T;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int signal) {
+    (void)signal;
+    stop_requested = 1;
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Opens a socket bound to the port on every interface.
+ * @return The socket, or -1.
+ */
+static int open_listener(int type, int port) {
+    int fd = socket(AF_INET, type, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        (type == SOCK_STREAM && listen(fd, 16) != 0)) {
+        close(fd);
+        return -1;
+    }
+    if (type == SOCK_DGRAM) {
+        int size = 4 * 1024 * 1024; // Room for bursts while a line is being written
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    return fd;
+}
+
+/**
+ * @brief Writes the whole lines at the start of a buffer and counts them.
+ * @return Bytes written, up to and including the last newline.
+ */
+static size_t write_lines(FILE *out, const char *data, size_t length, CollectStats_T *stats) {
+    size_t written = 0;
+    for (const char *line = data; line < data + length;) {
+        const char *newline = memchr(line, '\n', (size_t)(data + length - line));
+        if (!newline) {
+            break;
+        }
+        line = newline + 1;
+        written = (size_t)(line - data);
+        stats->lines++;
+    }
+    fwrite(data, 1, written, out);
+    stats->bytes += written;
+    return written;
+}
+
+/**
+ * @brief Reads what a TCP client has sent.
+ * @return 0 while the connection is open, -1 once it has closed.
+ */
+static int read_client(CollectClient_T *client, FILE *out, CollectStats_T *stats) {
+    ssize_t got = recv(client->fd, client->buffer + client->used, sizeof(client->buffer) - client->used, 0);
+    if (got <= 0) {
+        if (got < 0 && errno == EINTR) {
+            return 0;
+        }
+        if (client->used) {
+            // The sender went away part way through a line; keep what there is
+            fwrite(client->buffer, 1, client->used, out);
+            fputc('\n', out);
+            stats->lines++;
+            stats->bytes += client->used;
+        }
+        close(client->fd);
+        client->fd = -1;
+        client->used = 0;
+        return -1;
+    }
+    client->used += (size_t)got;
+    size_t written = write_lines(out, client->buffer, client->used, stats);
+    if (written == 0 && client->used == sizeof(client->buffer)) {
+        written = client->used; // One line longer than the buffer, written as it comes
+        fwrite(client->buffer, 1, written, out);
+        stats->bytes += written;
+    }
+    memmove(client->buffer, client->buffer + written, client->used - written);
+    client->used -= written;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int port = 7020;
+    const char *output_name = NULL;
+    unsigned long long max_lines = 0;
+    int seconds = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) {
+            fprintf(stderr, "Usage: %s [-p port] [-o file] [-n lines] [-s seconds]\n", argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "-p") == 0) port = atoi(value);
+        else if (strcmp(argv[i], "-o") == 0) output_name = value;
+        else if (strcmp(argv[i], "-n") == 0) max_lines = strtoull(value, NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0) seconds = atoi(value);
+        else {
+            fprintf(stderr, "Usage: %s [-p port] [-o file] [-n lines] [-s seconds]\n", argv[0]);
+            return 2;
+        }
+        i++;
+    }
+
+    FILE *out = output_name ? fopen(output_name, "ab") : stdout;
+    if (!out) {
+        fprintf(stderr, "etherlog-collect: cannot open %s\n", output_name);
+        return 1;
+    }
+    int udp = open_listener(SOCK_DGRAM, port);
+    int tcp = open_listener(SOCK_STREAM, port);
+    if (udp < 0 || tcp < 0) {
+        fprintf(stderr, "etherlog-collect: cannot listen on port %d: %s\n", port, strerror(errno));
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "etherlog-collect: listening on UDP and TCP port %d\n", port);
+
+    static CollectClient_T clients[MAX_CLIENTS];
+    static char datagram[DATAGRAM_MAX];
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+    CollectStats_T stats = { 0 };
+    long long deadline = seconds > 0 ? now_ms() + (long long)seconds * 1000 : 0;
+
+    while (!stop_requested && (!max_lines || stats.lines < max_lines) && (!deadline || now_ms() < deadline)) {
+        struct pollfd fds[MAX_CLIENTS + 2];
+        int owners[MAX_CLIENTS + 2];
+        int count = 0;
+        fds[count] = (struct pollfd){ udp, POLLIN, 0 };
+        owners[count++] = -1;
+        fds[count] = (struct pollfd){ tcp, POLLIN, 0 };
+        owners[count++] = -2;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                fds[count] = (struct pollfd){ clients[i].fd, POLLIN, 0 };
+                owners[count++] = i;
+            }
+        }
+
+        int ready = poll(fds, (nfds_t)count, 200);
+        if (ready <= 0) {
+            fflush(out);
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            if (owners[i] == -1) {
+                ssize_t got = recv(udp, datagram, sizeof(datagram), 0);
+                if (got > 0) {
+                    stats.datagrams++;
+                    size_t written = write_lines(out, datagram, (size_t)got, &stats);
+                    if (written < (size_t)got) {
+                        // The sender cuts long lines short, so the newline may be gone
+                        fwrite(datagram + written, 1, (size_t)got - written, out);
+                        fputc('\n', out);
+                        stats.lines++;
+                        stats.bytes += (size_t)got - written;
+                    }
+                }
+            } else if (owners[i] == -2) {
+                int fd = accept(tcp, NULL, NULL);
+                if (fd < 0) {
+                    continue;
+                }
+                int slot = 0;
+                while (slot < MAX_CLIENTS && clients[slot].fd >= 0) {
+                    slot++;
+                }
+                if (slot == MAX_CLIENTS) {
+                    close(fd);
+                    continue;
+                }
+                clients[slot].fd = fd;
+                clients[slot].used = 0;
+                stats.connections++;
+            } else {
+                read_client(&clients[owners[i]], out, &stats);
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            close(clients[i].fd);
+        }
+    }
+    close(udp);
+    close(tcp);
+    fflush(out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    fprintf(stderr, "etherlog-collect: %llu lines, %llu bytes, %llu datagrams, %llu connections\n",
+        stats.lines, stats.bytes, stats.datagrams, stats.connections);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file etherlog_decode.c
+ * @brief Turns binary log files back into the logger's text layout.
+ *
+ * Compressed segments (.elz) are expanded first, so this also serves to read
+ * compressed text logs, which are passed through as they are.
+ *
+ * Usage: etherlog-decode <file>... (writes to stdout, "-" reads stdin)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_binary.h"
+#include "log_codec.h"
+#include "log_format.h"
+
+/**
+ * @brief Matches log_level_to_string in the logger, so output lines compare equal.
+ */
+static const char *level_to_string(LogLevel level) {
+    switch (level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return  "INFO ";
+        case LOG_WARN: return  "WARN ";
+        case LOG_ERROR: return "ERROR";
+        case LOG_FATAL: return "FATAL";
+        default: return "UNKNN";
+    }
+}
+
+/**
+ * @brief Prints one entry the way publish_log_entry does, without colours.
+ */
+static void print_entry(const LogBinaryReader_T *reader, uint64_t index, const LogEntry_T *entry) {
+    const LogBinaryHeader_T *header = &reader->header;
+    int64_t elapsed_ticks = entry->timestamp.QuadPart - header->qpc_reference;
+    int64_t elapsed_seconds = elapsed_ticks / header->qpc_frequency;
+
+    time_t rawtime = (time_t)((header->filetime_reference / 10000000ULL) - 11644473600ULL);
+    rawtime += elapsed_seconds;
+
+    struct tm timeinfo;
+#ifdef _WIN32
+    localtime_s(&timeinfo, &rawtime);
+#else
+    localtime_r(&rawtime, &timeinfo);
+#endif
+
+    char time_buffer[64];
+    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+    int64_t nanoseconds = (elapsed_ticks % header->qpc_frequency) *
+        (1000000000 / header->qpc_frequency);
+
+    int fractional_width = 0;
+    for (uint32_t granularity = header->timestamp_granularity; granularity >= 10; granularity /= 10) {
+        fractional_width++;
+    }
+
+    char text[LOG_MSG_BUFFER_SIZE];
+    const char *message = entry->message;
+    if (entry->format) {
+        log_format_render(entry, text, sizeof(text));
+        message = text;
+    }
+
+    if (fractional_width > 0) {
+        int64_t divisor = 1000000000 / (int64_t)header->timestamp_granularity;
+        printf("%0*llu %s.%0*lld %s: [%s] %s\n",
+            (int)header->index_width, (unsigned long long)index,
+            time_buffer,
+            fractional_width, (long long)(nanoseconds / divisor),
+            level_to_string(entry->level),
+            log_binary_reader_label(reader, entry->label_id),
+            message);
+    } else {
+        printf("%0*llu %s %s: [%s] %s\n",
+            (int)header->index_width, (unsigned long long)index,
+            time_buffer,
+            level_to_string(entry->level),
+            log_binary_reader_label(reader, entry->label_id),
+            message);
+    }
+}
+
+/**
+ * @brief Expands a compressed file into a temporary one.
+ * @return The temporary file, rewound, or NULL on failure.
+ */
+static FILE *expand_file(FILE *file, const char *file_name) {
+    LogCodecReader_T codec;
+    if (!log_codec_reader_open(&codec, file)) {
+        fprintf(stderr, "etherlog-decode: %s is not a valid compressed log\n", file_name);
+        return NULL;
+    }
+    FILE *expanded = tmpfile();
+    if (!expanded) {
+        fprintf(stderr, "etherlog-decode: cannot create a temporary file for %s\n", file_name);
+        log_codec_reader_close(&codec);
+        return NULL;
+    }
+
+    static char buffer[LOG_CODEC_BLOCK_SIZE];
+    uint64_t offset = 0;
+    long length;
+    while ((length = log_codec_read(&codec, offset, buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, (size_t)length, expanded);
+        offset += (uint64_t)length;
+    }
+    log_codec_reader_close(&codec);
+    if (length < 0 || offset != codec.raw_size) {
+        fprintf(stderr, "etherlog-decode: %s is corrupt at offset %llu of the original\n",
+                file_name, (unsigned long long)offset);
+        fclose(expanded);
+        return NULL;
+    }
+    rewind(expanded);
+    return expanded;
+}
+
+/**
+ * @brief Copies a text log to stdout as it is.
+ */
+static int copy_text(FILE *file) {
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        fwrite(buffer, 1, length, stdout);
+    }
+    return ferror(file) ? 1 : 0;
+}
+
+/**
+ * @brief Decodes one file to stdout.
+ * @return 0 on success, 1 if the file could not be read to the end.
+ */
+static int decode_file(const char *file_name) {
+    FILE *file = (strcmp(file_name, "-") == 0) ? stdin : fopen(file_name, "rb");
+    if (!file) {
+        fprintf(stderr, "etherlog-decode: cannot open %s\n", file_name);
+        return 1;
+    }
+
+    if (file != stdin && log_codec_is_compressed(file)) {
+        FILE *expanded = expand_file(file, file_name);
+        fclose(file);
+        if (!expanded) {
+            return 1;
+        }
+        file = expanded;
+
+        int first = fgetc(file);
+        rewind(file);
+        if (first != LOG_BINARY_RECORD_HEADER) {
+            int text_result = copy_text(file); // A compressed text segment
+            fclose(file);
+            return text_result;
+        }
+    }
+
+    static LogBinaryReader_T reader; // Large, keep it off the stack
+    static LogEntry_T entry;
+    uint64_t index;
+    int result;
+
+    log_binary_reader_init(&reader, file);
+    while ((result = log_binary_read_entry(&reader, &index, &entry)) > 0) {
+        print_entry(&reader, index, &entry);
+    }
+    if (result < 0) {
+        fprintf(stderr, "etherlog-decode: %s is corrupt or from an incompatible platform at offset %ld\n",
+                file_name, ftell(file));
+    }
+    log_binary_reader_close(&reader);
+
+    if (file != stdin) {
+        fclose(file);
+    }
+    return (result < 0) ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file>...\n", argv[0]);
+        return 2;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        status |= decode_file(argv[i]);
+    }
+    return status;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file etherlog_salvage.c
+ * @brief Prints what a flight recorder held: the last calls of each thread, oldest first.
+ *
+ * Reads the recorder file itself, a crash copy written by the fatal signal
+ * handler, or one saved at the next start. Records torn by the crash are
+ * skipped. It must be run on the kind of platform that wrote the file, as the
+ * captured arguments are in the writer's byte order and sizes.
+ *
+ * Usage: etherlog-salvage <file>... (writes to stdout)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_binary.h"
+#include "log_flight.h"
+#include "log_format.h"
+
+/**
+ * @brief One complete record found in the file.
+ */
+typedef struct SalvagedRecord_T {
+    const LogFlightRecord_T *record;
+    uint32_t region;
+} SalvagedRecord_T;
+
+/**
+ * @brief Matches log_level_to_string in the logger, with the levels it leaves out.
+ */
+static const char *level_to_string(LogLevel level) {
+    switch (level) {
+        case LOG_TRACE: return "TRACE";
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return  "INFO ";
+        case LOG_NOTICE: return "NOTIC";
+        case LOG_WARN: return  "WARN ";
+        case LOG_ERROR: return "ERROR";
+        case LOG_CRITICAL: return "CRIT ";
+        case LOG_FATAL: return "FATAL";
+        default: return "UNKNN";
+    }
+}
+
+static const char *state_to_string(int64_t state) {
+    switch (state) {
+        case LOG_FLIGHT_RUNNING: return "still running, or died without its handler running";
+        case LOG_FLIGHT_CRASHED: return "crashed";
+        case LOG_FLIGHT_CLOSED: return "closed normally";
+        default: return "unknown";
+    }
+}
+
+static int compare_records(const void *a, const void *b) {
+    const LogFlightRecord_T *x = ((const SalvagedRecord_T *)a)->record;
+    const LogFlightRecord_T *y = ((const SalvagedRecord_T *)b)->record;
+    if (x->timestamp != y->timestamp) {
+        return (x->timestamp > y->timestamp) - (x->timestamp < y->timestamp);
+    }
+    return (x->sequence > y->sequence) - (x->sequence < y->sequence);
+}
+
+/**
+ * @brief Prints one record in the logger's text layout, the region standing in for the index.
+ */
+static void print_record(const LogFlightHeader_T *header, const SalvagedRecord_T *salvaged) {
+    const LogFlightRecord_T *record = salvaged->record;
+    const LogBinaryHeader_T *clock = &header->clock;
+    int64_t elapsed_ticks = record->timestamp - clock->qpc_reference;
+    int64_t elapsed_seconds = elapsed_ticks / clock->qpc_frequency;
+    int64_t remainder_ticks = elapsed_ticks % clock->qpc_frequency;
+    if (remainder_ticks < 0) {
+        remainder_ticks += clock->qpc_frequency; // Recorded before the reference was taken
+        elapsed_seconds--;
+    }
+
+    time_t rawtime = (time_t)((clock->filetime_reference / 10000000ULL) - 11644473600ULL);
+    rawtime += elapsed_seconds;
+    struct tm timeinfo;
+#ifdef _WIN32
+    localtime_s(&timeinfo, &rawtime);
+#else
+    localtime_r(&rawtime, &timeinfo);
+#endif
+    char time_buffer[64];
+    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    long long nanoseconds = (long long)(remainder_ticks * (1000000000 / clock->qpc_frequency));
+
+    static LogEntry_T entry; // Large, keep it off the stack
+    char text[LOG_MSG_BUFFER_SIZE];
+    const char *message = record->data;
+    if (record->deferred) {
+        size_t captured = (size_t)record->data_length - record->format_length - 1;
+        entry.format = record->data;
+        entry.message_length = (uint32_t)captured;
+        memcpy(entry.message, record->data + record->format_length + 1, captured);
+        entry.message[captured] = '\0';
+        if (record->data[record->format_length] == '\0' && log_format_validate(&entry)) {
+            log_format_render(&entry, text, sizeof(text));
+            message = text;
+        } else {
+            message = "(captured arguments unreadable)";
+        }
+    }
+
+    const char *label = header->labels[record->label_id % LOG_LABEL_MAX];
+    printf("%02u %s.%09lld %s: [%s] %s\n",
+        salvaged->region, time_buffer, nanoseconds,
+        level_to_string((LogLevel)record->level),
+        *label ? label : "UNKNOWN",
+        message);
+}
+
+/**
+ * @brief Checks the header describes a file this build can read.
+ */
+static bool check_header(const LogFlightHeader_T *header, size_t file_size, const char *file_name) {
+    LogBinaryHeader_T local;
+    memset(&local, 0, sizeof(local));
+    log_binary_init_header(&local);
+
+    if (memcmp(header->magic, LOG_FLIGHT_MAGIC, sizeof(header->magic)) != 0) {
+        fprintf(stderr, "etherlog-salvage: %s is not a flight recorder\n", file_name);
+        return false;
+    }
+    if (header->version != LOG_FLIGHT_VERSION || header->record_size != sizeof(LogFlightRecord_T) ||
+        header->regions != LOG_FLIGHT_REGIONS || header->slots == 0 ||
+        header->clock.long_size != local.long_size || header->clock.pointer_size != local.pointer_size ||
+        header->clock.long_double_size != local.long_double_size || header->clock.qpc_frequency <= 0) {
+        fprintf(stderr, "etherlog-salvage: %s is from an incompatible version or platform\n", file_name);
+        return false;
+    }
+    if (header->total_size != LOG_FLIGHT_REGIONS_OFFSET + LOG_FLIGHT_REGIONS * LOG_FLIGHT_REGION_SIZE(header->slots) ||
+        header->total_size > file_size) {
+        fprintf(stderr, "etherlog-salvage: %s is truncated\n", file_name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Prints one recorder file.
+ * @return 0 on success, 1 if it could not be read.
+ */
+static int salvage_file(const char *file_name) {
+    FILE *file = fopen(file_name, "rb");
+    if (!file) {
+        fprintf(stderr, "etherlog-salvage: cannot open %s\n", file_name);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+
+    unsigned char *data = (file_size >= (long)sizeof(LogFlightHeader_T)) ? (unsigned char *)malloc((size_t)file_size) : NULL;
+    bool read = data && fread(data, 1, (size_t)file_size, file) == (size_t)file_size;
+    fclose(file);
+    if (!read) {
+        fprintf(stderr, "etherlog-salvage: cannot read %s\n", file_name);
+        free(data);
+        return 1;
+    }
+
+    const LogFlightHeader_T *header = (const LogFlightHeader_T *)data;
+    if (!check_header(header, (size_t)file_size, file_name)) {
+        free(data);
+        return 1;
+    }
+
+    uint32_t slots = header->slots;
+    SalvagedRecord_T *found = (SalvagedRecord_T *)malloc((size_t)LOG_FLIGHT_REGIONS * slots * sizeof(SalvagedRecord_T));
+    if (!found) {
+        free(data);
+        return 1;
+    }
+    size_t count = 0;
+    size_t torn = 0;
+    for (uint32_t region = 0; region < LOG_FLIGHT_REGIONS; region++) {
+        const LogFlightRegion_T *ring = (const LogFlightRegion_T *)(data + LOG_FLIGHT_REGIONS_OFFSET +
+            (size_t)region * LOG_FLIGHT_REGION_SIZE(slots));
+        const LogFlightRecord_T *records = (const LogFlightRecord_T *)(ring + 1);
+        for (uint32_t slot = 0; slot < slots; slot++) {
+            const LogFlightRecord_T *record = &records[slot];
+            int64_t sequence = record->sequence;
+            if (sequence <= 0) {
+                torn += (ring->head > (int64_t)slot) ? 1 : 0; // Started but never finished
+                continue;
+            }
+            bool sound = (uint64_t)(sequence - 1) % slots == slot &&
+                record->data_length < sizeof(record->data) &&
+                (!record->deferred || record->format_length < record->data_length);
+            if (!sound) {
+                torn++;
+                continue;
+            }
+            found[count].record = record;
+            found[count].region = region;
+            count++;
+        }
+    }
+    qsort(found, count, sizeof(found[0]), compare_records);
+
+    printf("# %s: process %lld, %s", file_name, (long long)header->process_id, state_to_string(header->state));
+    if (header->state == LOG_FLIGHT_CRASHED) {
+        printf(" on signal %lld", (long long)header->signal);
+    }
+    printf(", %zu records", count);
+    if (torn > 0) {
+        printf(", %zu torn", torn);
+    }
+    printf("\n");
+    for (size_t i = 0; i < count; i++) {
+        print_record(header, &found[i]);
+    }
+
+    free(found);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file>...\n", argv[0]);
+        return 2;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        status |= salvage_file(argv[i]);
+    }
+    return status;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file log_file_bench.c
+ * @brief Compares the logger's file backends under a sustained line rate.
+ *
+ * Lines are produced at a fixed rate, spread across several files the way
+ * per-thread log files are, and written through the logger's own LogWriter_T
+ * with the same flush cycle as the logger thread: every millisecond the lines
+ * due are written, then each file is flushed and, for io_uring, the batch is
+ * submitted in one call. What is measured is the time the writing thread is
+ * busy, which is what the logger thread would have left over for draining.
+ *
+ * Usage: log-file-bench [-f files] [-r lines_per_second] [-s seconds] [-b flush_bytes] [-d directory]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "log_writer.h"
+#include "platform_aio.h"
+
+#define MAX_FILES 64
+#define LINE_SIZE 128
+#define TICK_NS 1000000LL // One flush cycle
+
+typedef enum BenchBackend {
+    BENCH_STDIO,
+    BENCH_MMAP,
+    BENCH_IO_URING
+} BenchBackend;
+
+static const char *backend_names[] = { "stdio", "mmap", "io_uring" };
+
+typedef struct BenchOptions_T {
+    int files;
+    long rate;
+    int seconds;
+    size_t flush_bytes;
+    const char *directory;
+} BenchOptions_T;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Runs one backend and prints its results.
+ * @return 0 on success, 1 if the backend could not be set up.
+ */
+static int run_backend(BenchBackend backend, const BenchOptions_T *options) {
+    static LogWriter_T writers[MAX_FILES];
+    static FILE *files[MAX_FILES];
+    PlatformAio_T aio = { .ring_fd = -1 };
+    size_t segment_size = (size_t)options->rate * LINE_SIZE * (size_t)options->seconds / (size_t)options->files + LINE_SIZE;
+
+    if (backend == BENCH_IO_URING && platform_aio_init(&aio, 256) != 0) {
+        printf("%-9s unavailable on this system\n", backend_names[backend]);
+        return 1;
+    }
+
+    for (int i = 0; i < options->files; i++) {
+        char name[512];
+        snprintf(name, sizeof(name), "%s/bench_%s_%02d.log", options->directory, backend_names[backend], i);
+        files[i] = fopen(name, (backend == BENCH_MMAP) ? "w+" : "w");
+        if (!files[i]) {
+            fprintf(stderr, "log-file-bench: cannot create %s\n", name);
+            return 1;
+        }
+        setvbuf(files[i], NULL, _IONBF, 0);
+        log_writer_init(&writers[i], files[i], options->flush_bytes);
+        if (backend == BENCH_MMAP && !log_writer_map(&writers[i], files[i], segment_size + LOG_WRITER_MAP_SLACK)) {
+            fprintf(stderr, "log-file-bench: cannot map %s\n", name);
+            return 1;
+        }
+        if (backend == BENCH_IO_URING && !log_writer_set_async(&writers[i], &aio)) {
+            fprintf(stderr, "log-file-bench: cannot write %s asynchronously\n", name);
+            return 1;
+        }
+    }
+
+    long long ticks = (long long)options->seconds * 1000000000LL / TICK_NS;
+    long long *busy = (long long *)calloc((size_t)ticks, sizeof(long long));
+    if (!busy) {
+        return 1;
+    }
+
+    long long produced = 0;
+    long long busy_total = 0;
+    long long behind_ticks = 0; // Cycles that took longer than the cycle itself
+    uint64_t bytes = 0;
+    long long start = now_ns();
+
+    for (long long tick = 0; tick < ticks; tick++) {
+        long long due = (long long)((double)options->rate * (double)(tick + 1) * TICK_NS / 1e9);
+        long long began = now_ns();
+
+        for (; produced < due; produced++) {
+            char line[LINE_SIZE];
+            int length = snprintf(line, sizeof(line),
+                "%012lld 2026-01-01 12:00:00.000000000 INFO : [BENCH%02d] Sustained load line %lld of the benchmark run\n",
+                produced, (int)(produced % options->files), produced);
+            log_writer_write(&writers[produced % options->files], line, (size_t)length);
+            bytes += (uint64_t)length;
+        }
+        for (int i = 0; i < options->files; i++) {
+            log_writer_flush(&writers[i]);
+        }
+        if (backend == BENCH_IO_URING) {
+            log_writer_submit(&aio);
+        }
+
+        long long ended = now_ns();
+        busy[tick] = ended - began;
+        busy_total += busy[tick];
+        if (busy[tick] > TICK_NS) {
+            behind_ticks++;
+        }
+
+        // Sleep out the rest of the cycle
+        long long next = start + (tick + 1) * TICK_NS;
+        if (next > ended) {
+            struct timespec pause = { 0, (long)(next - ended) };
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    long long settle_start = now_ns();
+    for (int i = 0; i < options->files; i++) {
+        log_writer_free(&writers[i]);
+        fclose(files[i]);
+    }
+    platform_aio_close(&aio, log_writer_complete);
+    long long elapsed = now_ns() - start;
+    long long settle = now_ns() - settle_start;
+
+    qsort(busy, (size_t)ticks, sizeof(long long), compare_long_long);
+    printf("%-9s %10.0f lines/s %8.1f MB/s  busy %5.1f%%  %6.1f ns/line  cycle p50 %7.1f us  p99 %7.1f us  max %8.1f us  over %lld  close %6.1f ms\n",
+        backend_names[backend],
+        produced / (elapsed / 1e9),
+        bytes / (elapsed / 1e9) / 1e6,
+        100.0 * busy_total / (double)(ticks * TICK_NS),
+        (double)busy_total / (double)(produced ? produced : 1),
+        busy[ticks / 2] / 1e3,
+        busy[ticks * 99 / 100] / 1e3,
+        busy[ticks - 1] / 1e3,
+        behind_ticks,
+        settle / 1e6);
+    free(busy);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    BenchOptions_T options = { 4, 500000, 5, 64 * 1024, "bench_logs" };
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) {
+            fprintf(stderr, "Usage: %s [-f files] [-r lines_per_second] [-s seconds] [-b flush_bytes] [-d directory]\n", argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "-f") == 0) options.files = atoi(value);
+        else if (strcmp(argv[i], "-r") == 0) options.rate = atol(value);
+        else if (strcmp(argv[i], "-s") == 0) options.seconds = atoi(value);
+        else if (strcmp(argv[i], "-b") == 0) options.flush_bytes = (size_t)atol(value);
+        else if (strcmp(argv[i], "-d") == 0) options.directory = value;
+        else {
+            fprintf(stderr, "Usage: %s [-f files] [-r lines_per_second] [-s seconds] [-b flush_bytes] [-d directory]\n", argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (options.files < 1 || options.files > MAX_FILES || options.rate < 1 || options.seconds < 1) {
+        fprintf(stderr, "log-file-bench: files must be 1 to %d, rate and seconds above 0\n", MAX_FILES);
+        return 2;
+    }
+    mkdir(options.directory, 0755);
+
+    printf("%d files, %ld lines/s for %d s, %zu byte buffers, in %s\n",
+        options.files, options.rate, options.seconds, options.flush_bytes, options.directory);
+    int status = 0;
+    status |= run_backend(BENCH_STDIO, &options);
+    status |= run_backend(BENCH_MMAP, &options);
+    run_backend(BENCH_IO_URING, &options); // Not having it is not a failure
+    return status;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file receive_bench.c
+ * @brief Measures what the receive path's DEBUG logging costs once it is off.
+ *
+ * The command interface states dump every buffered byte at DEBUG and the marker
+ * search logs each search, so with the runtime level at INFO each of those is
+ * still a call into _logger_log and a level check. This runs the same logging
+ * shape over a stream of framed messages: the per-byte dump of
+ * process_wait_for_start, its marker check, and find_marker_in_buffer. Built
+ * with -DLOG_COMPILE_MIN_LEVEL=LOG_INFO the DEBUG calls compile to nothing;
+ * `make receive-bench` builds it both ways so the two can be compared. -f
+ * opens a flight recorder, receive-bench.flight in the current directory,
+ * recording calls at or above the level given, to show what it adds.
+ *
+ * Usage: receive-bench [-m messages] [-p payload_bytes] [-l runtime_level] [-f flight_level]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common_socket.h"
+#include "log_flight.h"
+#include "log_level.h"
+#include "logger.h"
+
+#define BENCH_STRINGIFY(x) #x
+#define BENCH_LEVEL_NAME(x) BENCH_STRINGIFY(x)
+
+extern long long receive_bench_logged; // Calls that got past the level check
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief The logging of process_wait_for_start: every byte, then the marker.
+ * @return true if @p buffer starts with the start marker.
+ */
+static bool wait_for_start(const unsigned char *buffer, size_t length) {
+    logger_log(LOG_DEBUG, "top of process_wait_for_start length = %zu", length);
+    if (length < 4) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        char ch = (char)buffer[i];
+        if (ch >= 0x20 && ch <= 0x7E) {
+            logger_log(LOG_DEBUG, "<- [%04zu]: %c", i, ch);
+        }
+        else {
+            logger_log(LOG_DEBUG, "<- [%04zu]: 0x%02X", i, (unsigned char)ch);
+        }
+    }
+
+    unsigned int expected_marker = START_MARKER;
+    if (memcmp(buffer, &expected_marker, 4) != 0) {
+        logger_log(LOG_DEBUG, "Invalid Start Marker");
+        return false;
+    }
+    logger_log(LOG_DEBUG, "Valid Start Marker [%x]", START_MARKER);
+    return true;
+}
+
+/**
+ * @brief find_marker_in_buffer, logging included.
+ */
+static int find_marker(const unsigned char *buffer, int buffer_length, unsigned int marker) {
+    logger_log(LOG_DEBUG, "Searching for %s marker 0x%X in buffer of length %d",
+        (marker == START_MARKER) ? "START_MARKER" : "END_MARKER", marker, buffer_length);
+    for (int i = 0; i <= buffer_length - 4; i++) {
+        unsigned int candidate;
+        memcpy(&candidate, buffer + i, sizeof(candidate));
+        if (candidate == marker) {
+            logger_log(LOG_DEBUG, "Found marker at index %d", i);
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    long messages = 200000;
+    int payload = 64;
+    LogLevel runtime_level = LOG_INFO;
+    int flight_level = LOG_FLIGHT_OFF;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (value && strcmp(argv[i], "-m") == 0) messages = atol(value);
+        else if (value && strcmp(argv[i], "-p") == 0) payload = atoi(value);
+        else if (value && strcmp(argv[i], "-l") == 0) runtime_level = (LogLevel)atoi(value);
+        else if (value && strcmp(argv[i], "-f") == 0) flight_level = atoi(value);
+        else {
+            fprintf(stderr, "Usage: %s [-m messages] [-p payload_bytes] [-l runtime_level] [-f flight_level]\n", argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (messages < 1 || payload < 0 || payload > 60000) {
+        fprintf(stderr, "receive-bench: messages must be above 0, payload 0 to 60000\n");
+        return 2;
+    }
+    log_level_set_global(runtime_level);
+    LogBinaryHeader_T clock = { 0 }; // Nothing reads the recording back
+    if (flight_level < LOG_FLIGHT_OFF &&
+        !log_flight_open("receive-bench.flight", "receive-bench.flight.crash", LOG_FLIGHT_DEFAULT_SLOTS, (LogLevel)flight_level, &clock)) {
+        fprintf(stderr, "receive-bench: could not open the flight recorder\n");
+        return 1;
+    }
+
+    // One frame: start marker, length, payload, end marker
+    size_t frame_length = 12 + (size_t)payload;
+    unsigned char *frame = (unsigned char *)malloc(frame_length);
+    if (!frame) {
+        return 1;
+    }
+    unsigned int marker = START_MARKER;
+    unsigned int length = (unsigned int)payload;
+    memcpy(frame, &marker, 4);
+    memcpy(frame + 4, &length, 4);
+    for (int i = 0; i < payload; i++) {
+        frame[8 + i] = (unsigned char)(i * 7);
+    }
+    marker = END_MARKER;
+    memcpy(frame + 8 + payload, &marker, 4);
+
+    long long found = 0;
+    long long start = now_ns();
+    for (long m = 0; m < messages; m++) {
+        found += wait_for_start(frame, frame_length);
+        found += find_marker(frame, (int)frame_length, END_MARKER);
+    }
+    long long elapsed = now_ns() - start;
+
+    printf("LOG_COMPILE_MIN_LEVEL=%-9s runtime level %d flight level %d: %ld messages of %zu bytes  %8.2f ns/byte  %9.1f ns/message  %10.0f messages/s  logged %lld  (check %lld)\n",
+        BENCH_LEVEL_NAME(LOG_COMPILE_MIN_LEVEL), (int)runtime_level, flight_level, messages, frame_length,
+        (double)elapsed / ((double)messages * (double)frame_length),
+        (double)elapsed / (double)messages,
+        messages / (elapsed / 1e9),
+        receive_bench_logged, found);
+    free(frame);
+    log_flight_close();
+    return 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file receive_bench_logger.c
+ * @brief The part of _logger_log that runs for a call below the level, for receive-bench.
+ *
+ * Kept in its own file, as logger.c is, so the compiler sees an opaque call at
+ * every logger_log just as it does in the application. The flight recorder
+ * and level checks are the ones in _logger_log, the recorder only recording
+ * once receive-bench -f has opened it; calls that pass the level check are
+ * formatted and counted rather than queued.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "log_flight.h"
+#include "log_label.h"
+#include "log_level.h"
+#include "logger.h"
+
+long long receive_bench_logged = 0;
+
+bool g_trace_all = false;
+
+void _logger_log(LogLevel level, const char *format, ...) {
+    if ((int)level >= log_flight_level) {
+        va_list flight_args;
+        va_start(flight_args, format);
+        log_flight_record(level, LOG_LABEL_UNKNOWN, format, flight_args);
+        va_end(flight_args);
+    }
+    int thread_level = (int)platform_atomic_load_relaxed_64(&log_level_this_thread);
+    if ((int)level < thread_level) {
+        return;
+    }
+    if (thread_level == LOG_LEVEL_UNSET && (int)level < (int)platform_atomic_load_relaxed_64(&log_level_global)) {
+        return;
+    }
+
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    receive_bench_logged++;
+}
@@ -25,6 +25,15 @@ endif
 CFLAGS_DEBUG = $(CFLAGS_COMMON) -g -O0
 CFLAGS_RELEASE = $(CFLAGS_COMMON) -O3
 
+# Compile-time log level: calls below it are removed from the release build,
+# e.g. make release LOG_COMPILE_MIN_LEVEL=LOG_INFO. release_stripped builds a
+# separate release with LOG_STRIP_LEVEL, leaving the full release alone.
+ifdef LOG_COMPILE_MIN_LEVEL
+    CFLAGS_RELEASE += -DLOG_COMPILE_MIN_LEVEL=$(LOG_COMPILE_MIN_LEVEL)
+endif
+LOG_STRIP_LEVEL ?= LOG_INFO
+CFLAGS_STRIPPED = $(CFLAGS_COMMON) -O3 -DLOG_COMPILE_MIN_LEVEL=$(LOG_STRIP_LEVEL)
+
 # Verbose mode (default off, enable with V=1)
 V ?= 0
 ifeq ($(V),1)
@@ -41,6 +50,8 @@ DEBUG_DIR = $(BUILD_DIR)/Debug
 RELEASE_DIR = $(BUILD_DIR)/Release
 DEBUG_BIN = $(BIN_DIR)/Debug
 RELEASE_BIN = $(BIN_DIR)/Release
+STRIPPED_DIR = $(BUILD_DIR)/ReleaseStripped
+STRIPPED_BIN = $(BIN_DIR)/ReleaseStripped
 
 # Source and Object Files
 SRC_DIR = $(PROJECT_NAME)/src
@@ -48,10 +59,38 @@ INC_DIR = $(PROJECT_NAME)/inc
 SRCS = $(wildcard $(SRC_DIR)/*.c)
 OBJS_DEBUG = $(patsubst $(SRC_DIR)/%.c, $(DEBUG_DIR)/%.o, $(SRCS))
 OBJS_RELEASE = $(patsubst $(SRC_DIR)/%.c, $(RELEASE_DIR)/%.o, $(SRCS))
+OBJS_STRIPPED = $(patsubst $(SRC_DIR)/%.c, $(STRIPPED_DIR)/%.o, $(SRCS))
 
 # Target Executables
 TARGET_DEBUG = $(DEBUG_BIN)/EtherRecorder
 TARGET_RELEASE = $(RELEASE_BIN)/EtherRecorder
+TARGET_STRIPPED = $(STRIPPED_BIN)/EtherRecorder
+
+# Offline tools, built from the tools directory plus the logger sources they share
+TOOLS_DIR = $(PROJECT_NAME)/tools
+DECODE_SRCS = $(TOOLS_DIR)/etherlog_decode.c $(SRC_DIR)/log_binary.c $(SRC_DIR)/log_codec.c $(SRC_DIR)/log_format.c $(SRC_DIR)/log_label.c $(SRC_DIR)/log_writer.c $(SRC_DIR)/platform_aio.c $(SRC_DIR)/platform_mmap.c $(SRC_DIR)/platform_signal.c
+TARGET_DECODE = $(RELEASE_BIN)/etherlog-decode
+SALVAGE_SRCS = $(TOOLS_DIR)/etherlog_salvage.c $(SRC_DIR)/log_binary.c $(SRC_DIR)/log_format.c $(SRC_DIR)/log_label.c $(SRC_DIR)/log_writer.c $(SRC_DIR)/platform_aio.c $(SRC_DIR)/platform_mmap.c $(SRC_DIR)/platform_signal.c
+TARGET_SALVAGE = $(RELEASE_BIN)/etherlog-salvage
+COLLECT_SRCS = $(TOOLS_DIR)/etherlog_collect.c
+TARGET_COLLECT = $(RELEASE_BIN)/etherlog-collect
+FILE_BENCH_SRCS = $(TOOLS_DIR)/log_file_bench.c $(SRC_DIR)/log_writer.c $(SRC_DIR)/platform_aio.c $(SRC_DIR)/platform_mmap.c $(SRC_DIR)/platform_signal.c
+TARGET_FILE_BENCH = $(RELEASE_BIN)/log-file-bench
+RECEIVE_BENCH_SRCS = $(TOOLS_DIR)/receive_bench.c $(TOOLS_DIR)/receive_bench_logger.c $(SRC_DIR)/log_level.c $(SRC_DIR)/log_label.c $(SRC_DIR)/log_flight.c $(SRC_DIR)/log_format.c $(SRC_DIR)/platform_mmap.c $(SRC_DIR)/platform_signal.c $(SRC_DIR)/platform_utils.c
+TARGET_RECEIVE_BENCH = $(RELEASE_BIN)/receive-bench
+TARGET_RECEIVE_BENCH_STRIPPED = $(RELEASE_BIN)/receive-bench-stripped
+# The application less main.c; filtering on .c also leaves out the pieces of a file name with a space in it
+BENCH_LOGGER_SRCS = $(TOOLS_DIR)/bench_logger.c $(filter-out $(SRC_DIR)/main.c, $(filter $(SRC_DIR)/%.c, $(SRCS)))
+TARGET_BENCH_LOGGER = $(RELEASE_BIN)/bench-logger
+
+# Where run_bench_logger writes: a tmpfs and a real disk, as well as /dev/null
+ifeq ($(UNAME_S), Darwin)
+    BENCH_TMPFS ?= /tmp/bench_logs
+else
+    BENCH_TMPFS ?= /dev/shm/bench_logs
+endif
+BENCH_DISK ?= bench_logs
+BENCH_LOGGER_ARGS ?= -t 4 -n 200000 -s 100
 
 # Default target
 all: debug release
@@ -80,11 +119,78 @@ $(RELEASE_DIR)/%.o: $(SRC_DIR)/%.c
 	$(VERBOSE) $(CC) $(CFLAGS_RELEASE) -MMD -MP -c -o $@ $<
 	@echo "[BUILD SUCCESS] Compiled: $< -> $@"
 
+# Release build with logging below LOG_STRIP_LEVEL compiled out
+release_stripped: $(TARGET_STRIPPED)
+
+$(TARGET_STRIPPED): $(OBJS_STRIPPED) | $(STRIPPED_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_STRIPPED) -o $@ $^
+	@echo "[BUILD SUCCESS] Stripped release executable created: $@"
+
+$(STRIPPED_DIR)/%.o: $(SRC_DIR)/%.c
+	@mkdir -p $(dir $@)
+	$(VERBOSE) $(CC) $(CFLAGS_STRIPPED) -MMD -MP -c -o $@ $<
+	@echo "[BUILD SUCCESS] Compiled: $< -> $@"
+
+# Binary log decoder
+etherlog-decode: $(TARGET_DECODE)
+
+$(TARGET_DECODE): $(DECODE_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_RELEASE) -o $@ $(DECODE_SRCS)
+	@echo "[BUILD SUCCESS] Decoder created: $@"
+
+# Flight recorder reader
+etherlog-salvage: $(TARGET_SALVAGE)
+
+$(TARGET_SALVAGE): $(SALVAGE_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_RELEASE) -o $@ $(SALVAGE_SRCS)
+	@echo "[BUILD SUCCESS] Salvage tool created: $@"
+
+# Collector for the network log sink
+etherlog-collect: $(TARGET_COLLECT)
+
+$(TARGET_COLLECT): $(COLLECT_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_RELEASE) -o $@ $(COLLECT_SRCS)
+	@echo "[BUILD SUCCESS] Collector created: $@"
+
+# File backend benchmark (stdio, mmap, io_uring)
+log-file-bench: $(TARGET_FILE_BENCH)
+
+$(TARGET_FILE_BENCH): $(FILE_BENCH_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_RELEASE) -o $@ $(FILE_BENCH_SRCS)
+	@echo "[BUILD SUCCESS] Benchmark created: $@"
+
+# Receive path logging benchmark, built with and without compile-time stripping
+receive-bench: $(TARGET_RECEIVE_BENCH) $(TARGET_RECEIVE_BENCH_STRIPPED)
+
+$(TARGET_RECEIVE_BENCH): $(RECEIVE_BENCH_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_COMMON) -O3 -o $@ $(RECEIVE_BENCH_SRCS)
+	@echo "[BUILD SUCCESS] Benchmark created: $@"
+
+$(TARGET_RECEIVE_BENCH_STRIPPED): $(RECEIVE_BENCH_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_STRIPPED) -o $@ $(RECEIVE_BENCH_SRCS)
+	@echo "[BUILD SUCCESS] Benchmark created: $@"
+
+run_receive_bench: receive-bench
+	$(VERBOSE) $(TARGET_RECEIVE_BENCH)
+	$(VERBOSE) $(TARGET_RECEIVE_BENCH_STRIPPED)
+
+# Whole logging stack benchmark, logger thread included; one JSON line per run
+bench_logger: $(TARGET_BENCH_LOGGER)
+
+$(TARGET_BENCH_LOGGER): $(BENCH_LOGGER_SRCS) | $(RELEASE_BIN)
+	$(VERBOSE) $(CC) $(CFLAGS_RELEASE) -o $@ $(BENCH_LOGGER_SRCS)
+	@echo "[BUILD SUCCESS] Benchmark created: $@"
+
+run_bench_logger: bench_logger
+	$(VERBOSE) $(TARGET_BENCH_LOGGER) $(BENCH_LOGGER_ARGS) -d null
+	$(VERBOSE) $(TARGET_BENCH_LOGGER) $(BENCH_LOGGER_ARGS) -d $(BENCH_TMPFS)
+	$(VERBOSE) $(TARGET_BENCH_LOGGER) $(BENCH_LOGGER_ARGS) -d $(BENCH_DISK)
+
 # Include dependencies
--include $(OBJS_DEBUG:.o=.d) $(OBJS_RELEASE:.o=.d)
+-include $(OBJS_DEBUG:.o=.d) $(OBJS_RELEASE:.o=.d) $(OBJS_STRIPPED:.o=.d)
 
 # Create Binary Directories
-$(DEBUG_BIN) $(RELEASE_BIN):
+$(DEBUG_BIN) $(RELEASE_BIN) $(STRIPPED_BIN):
 	@mkdir -p $@
 
 # Clean targets
@@ -103,7 +209,12 @@ clean_release:
 	rm -rf $(RELEASE_DIR) $(RELEASE_BIN)
 	@echo "Clean release complete."
 
-clean_all: clean_debug clean_release
+clean_release_stripped:
+	@echo "Cleaning stripped release build..."
+	rm -rf $(STRIPPED_DIR) $(STRIPPED_BIN)
+	@echo "Clean stripped release complete."
+
+clean_all: clean_debug clean_release clean_release_stripped
 
 # Run targets
 run_debug: debug
@@ -121,11 +232,20 @@ install: release
 help:
 	@echo "Available targets:"
 	@echo "  make debug       - Compile debug build"
-	@echo "  make release     - Compile release build"
+	@echo "  make release     - Compile release build (LOG_COMPILE_MIN_LEVEL=LOG_INFO to strip lower levels)"
+	@echo "  make release_stripped - Compile release build with levels below LOG_STRIP_LEVEL (LOG_INFO) compiled out"
 	@echo "  make clean       - Remove all build artifacts"
 	@echo "  make run_debug   - Run debug build"
 	@echo "  make run_release - Run release build"
 	@echo "  make install     - Install release binary to /usr/local/bin"
+	@echo "  make etherlog-decode - Build the binary log file decoder"
+	@echo "  make etherlog-salvage - Build the flight recorder reader"
+	@echo "  make etherlog-collect - Build the collector for logs sent over UDP or TCP"
+	@echo "  make log-file-bench - Build the log file backend benchmark"
+	@echo "  make receive-bench - Build the receive path logging benchmark, with and without stripping"
+	@echo "  make run_receive_bench - Build and run both receive path benchmarks"
+	@echo "  make bench_logger - Build the whole logging stack benchmark"
+	@echo "  make run_bench_logger - Run it against /dev/null, BENCH_TMPFS and BENCH_DISK (BENCH_LOGGER_ARGS)"
 	@echo "  make V=1 ...     - Enable verbose mode"
 
-.PHONY: all debug release clean clean_debug clean_release clean_all run_debug run_release install help
+.PHONY: all debug release release_stripped etherlog-decode etherlog-salvage etherlog-collect log-file-bench receive-bench run_receive_bench bench_logger run_bench_logger clean clean_debug clean_release clean_release_stripped clean_all run_debug run_release install help